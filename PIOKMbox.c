@@ -23,6 +23,9 @@
 #include "init_state_machine.h"
 #include "state_management.h"
 #include "kmbox_serial_handler.h"
+#include "kmbox_interface.h"
+#include "trace.h"
+#include "debug_stdio.h"
 
 #if PIO_USB_AVAILABLE
 #include "pio_usb.h"
@@ -118,6 +121,11 @@ static void core1_main(void) {
     // Configure host stack with PIO USB configuration
     tuh_configure(USB_HOST_PORT, TUH_CFGID_RPI_PIO_USB_CONFIGURATION, &pio_cfg);
     
+    // Boot interfaces start in TinyUSB's default boot protocol, so keyboards
+    // send the 8-byte boot report they are parsed as. Mice whose report
+    // descriptor compiles are switched to report protocol at mount
+    // (tuh_hid_mount_cb) for 16-bit axes and extra buttons.
+    
     // Initialize host stack on core1
     tuh_init(USB_HOST_PORT);
     
@@ -175,7 +183,12 @@ static bool initialize_system(void) {
     printf("System clock set successfully to %d kHz\n", CPU_FREQ);
     
     // Configure UART0 for debug output with non-blocking operation
-    uart_set_fifo_enabled(uart0, true);  // Enable FIFO for better performance
+    uart_set_fifo_enabled(DEBUG_UART, true);  // Enable FIFO for better performance
+
+    // Queue debug output for DMA so printf never waits on the UART
+    if (!debug_stdio_init()) {
+        printf("WARNING: DMA debug stdio unavailable, output stays blocking\n");
+    }
     
     // Initialize KMBox serial handler on UART1
     kmbox_serial_init();
@@ -201,6 +214,8 @@ static bool initialize_usb_device(void) {
     
     if (device_init_success) {
         usb_device_mark_initialized();
+        // SOF timing for the synchronized mouse report submission
+        tud_sof_cb_enable(HID_SOF_SYNC_ENABLED);
         printf("USB Device: Initialization complete\n");
     }
     
@@ -291,6 +306,44 @@ static void report_watchdog_status(uint32_t current_time, uint32_t* watchdog_sta
            watchdog_status.core1_heartbeat_count);
     printf("Hardware updates: %lu\n", watchdog_status.hardware_updates);
     printf("Timeout warnings: %lu\n", watchdog_status.timeout_warnings);
+
+    kmbox_interface_stats_t if_stats;
+    kmbox_interface_get_stats(&if_stats);
+    printf("KMBox UART: rx %lu, ring overflows %lu, overruns %lu, framing errors %lu, tx dropped %lu\n",
+           if_stats.bytes_received, if_stats.rx_overflows, if_stats.overruns,
+           if_stats.framing_errors, if_stats.tx_dropped);
+
+    host_report_queue_stats_t q_stats;
+    hid_host_get_queue_stats(&q_stats);
+    printf("Host report queue: %lu processed, %lu dropped, depth %lu (max %lu), latency avg %lu us max %lu us\n",
+           q_stats.popped, q_stats.dropped, q_stats.depth, q_stats.high_water,
+           q_stats.popped ? q_stats.total_latency_us / q_stats.popped : 0UL,
+           q_stats.max_latency_us);
+
+    mouse_coalesce_stats_t m_stats;
+    usb_hid_get_mouse_coalesce_stats(&m_stats);
+    printf("Mouse reports: %lu sent, %lu host reports merged, %lu dropped\n",
+           m_stats.reports_sent, m_stats.merged, m_stats.dropped);
+
+    hid_sof_stats_t sof_stats;
+    usb_hid_get_sof_stats(&sof_stats);
+    const uint32_t sof_reports = sof_stats.synced_reports + sof_stats.unsynced_reports;
+    printf("SOF sync: %lu frames, %lu synced / %lu unsynced reports, wait avg %lu us max %lu us (send-ahead %u us)\n",
+           sof_stats.frames, sof_stats.synced_reports, sof_stats.unsynced_reports,
+           sof_reports ? sof_stats.total_wait_us / sof_reports : 0UL,
+           sof_stats.max_wait_us, usb_hid_get_sof_send_ahead_us());
+
+    hid_arbiter_stats_t ep_stats;
+    usb_hid_get_arbiter_stats(&ep_stats);
+    const uint32_t ep_reports = ep_stats.mouse_sent + ep_stats.keyboard_sent + ep_stats.consumer_sent;
+    printf("HID endpoint: %lu reports in %lu frames (%lu%%): mouse %lu, keyboard %lu, consumer %lu, %lu replaced\n",
+           ep_reports, ep_stats.frames,
+           ep_stats.frames ? (uint32_t)((uint64_t)ep_reports * 100u / ep_stats.frames) : 0UL,
+           ep_stats.mouse_sent, ep_stats.keyboard_sent, ep_stats.consumer_sent, ep_stats.replaced);
+    kmbox_serial_print_stats();
+
+    printf("Trace: %lu records dropped, debug output: %lu bytes dropped\n",
+           (unsigned long)trace_get_dropped(), (unsigned long)debug_stdio_get_dropped());
     printf("=======================\n");
 }
 
@@ -320,13 +373,19 @@ static void main_application_loop(void) {
     while (true) {
         // TinyUSB device task - highest priority
         tud_task();
-        hid_device_task();
         
-        // KMBox serial task - high priority for responsiveness
-        kmbox_serial_task();
+        // Get time once per loop iteration: microseconds for the HID and
+        // kmbox timing, milliseconds for the housekeeping intervals below
+        const uint64_t now_us = time_us_64();
+        const uint32_t current_time = (uint32_t)(now_us / 1000);
+        
+        hid_device_task(now_us);
+
+        // Merge reports queued by the host stack on core1
+        hid_host_task(now_us);
         
-        // Get time once per loop iteration
-        const uint32_t current_time = to_ms_since_boot(get_absolute_time());
+        // KMBox serial task - high priority for responsiveness
+        kmbox_serial_task(now_us);
         
         // Combine time checks to reduce function call overhead
         const uint32_t time_since_watchdog = current_time - state->last_watchdog_time;
@@ -344,6 +403,7 @@ static void main_application_loop(void) {
         if (time_since_visual >= visual_interval) {
             led_blinking_task();
             neopixel_status_task();
+            trace_task();
             state->last_visual_time = current_time;
         }
         
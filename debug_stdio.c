@@ -0,0 +1,199 @@
+/*
+ * Non-blocking Debug stdio for PIOKMbox
+ */
+
+#include "debug_stdio.h"
+#include "defines.h"
+#include "pico/stdlib.h"
+#include "pico/stdio/driver.h"
+#include "pico/stdio_uart.h"
+#include "hardware/uart.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include <string.h>
+
+#define DEBUG_STDIO_RING_MASK (DEBUG_STDIO_RING_SIZE - 1)
+_Static_assert((DEBUG_STDIO_RING_SIZE & DEBUG_STDIO_RING_MASK) == 0,
+               "DEBUG_STDIO_RING_SIZE must be a power of two");
+
+// One ring per core. head is advanced only by the owning core (with its
+// interrupts masked), tail only by debug_stdio_kick() under g_lock.
+typedef struct {
+    char buffer[DEBUG_STDIO_RING_SIZE];
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile uint32_t dropped;
+} debug_ring_t;
+
+static debug_ring_t g_rings[NUM_CORES];
+static spin_lock_t* g_lock = NULL;
+static int g_dma_chan = -1;
+static volatile int g_dma_ring = -1;    // Ring the active transfer reads from
+static uint32_t g_dma_count = 0;        // Bytes in the active transfer
+static uint32_t g_last_ring = 0;
+
+// Retire a finished transfer and start the next one. Runs on either core and
+// from the DMA IRQ; the spin lock makes it the single consumer of both rings.
+static void debug_stdio_kick(void)
+{
+    uint32_t irq_state = spin_lock_blocking(g_lock);
+
+    if (g_dma_ring >= 0 && !dma_channel_is_busy(g_dma_chan)) {
+        g_rings[g_dma_ring].tail += g_dma_count;
+        g_dma_ring = -1;
+    }
+
+    if (g_dma_ring < 0) {
+        // Stay on the last ring while it has data so output from the two
+        // cores is interleaved in as few places as possible
+        for (uint32_t i = 0; i < NUM_CORES; i++) {
+            uint32_t index = (g_last_ring + i) % NUM_CORES;
+            debug_ring_t* ring = &g_rings[index];
+            uint32_t tail = ring->tail;
+            uint32_t pending = ring->head - tail;
+            if (pending == 0) {
+                continue;
+            }
+            __dmb(); // Read the data only after observing the index
+
+            uint32_t offset = tail & DEBUG_STDIO_RING_MASK;
+            uint32_t count = DEBUG_STDIO_RING_SIZE - offset;
+            if (count > pending) {
+                count = pending;
+            }
+            g_dma_ring = (int)index;
+            g_dma_count = count;
+            g_last_ring = index;
+            dma_channel_transfer_from_buffer_now(g_dma_chan, &ring->buffer[offset], count);
+            break;
+        }
+    }
+
+    spin_unlock(g_lock, irq_state);
+}
+
+static void debug_stdio_dma_irq_handler(void)
+{
+    if (g_dma_chan >= 0 && dma_channel_get_irq1_status(g_dma_chan)) {
+        dma_channel_acknowledge_irq1(g_dma_chan);
+        debug_stdio_kick();
+    }
+}
+
+static void debug_stdio_out_chars(const char* buf, int length)
+{
+    uint32_t core = get_core_num();
+    debug_ring_t* ring = &g_rings[core];
+    uint32_t len = (uint32_t)length;
+
+    uint32_t irq_state = save_and_disable_interrupts();
+    uint32_t head = ring->head;
+    if (len > DEBUG_STDIO_RING_SIZE - (head - ring->tail)) {
+        // Drop the whole chunk rather than emit a torn line
+        ring->dropped += len;
+        restore_interrupts(irq_state);
+        return;
+    }
+
+    uint32_t offset = head & DEBUG_STDIO_RING_MASK;
+    uint32_t first = DEBUG_STDIO_RING_SIZE - offset;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(&ring->buffer[offset], buf, first);
+    memcpy(ring->buffer, buf + first, len - first);
+    __dmb(); // Publish the data before the index
+    ring->head = head + len;
+    restore_interrupts(irq_state);
+
+    debug_stdio_kick();
+}
+
+static int debug_stdio_in_chars(char* buf, int length)
+{
+    int count = 0;
+    while (count < length && uart_is_readable(DEBUG_UART)) {
+        buf[count++] = (char)uart_getc(DEBUG_UART);
+    }
+    return count ? count : PICO_ERROR_NO_DATA;
+}
+
+static stdio_driver_t g_debug_stdio_driver = {
+    .out_chars = debug_stdio_out_chars,
+    .out_flush = debug_stdio_kick,
+    .in_chars = debug_stdio_in_chars,
+#if PICO_STDIO_ENABLE_CRLF_SUPPORT
+    .crlf_enabled = PICO_STDIO_DEFAULT_CRLF
+#endif
+};
+
+bool debug_stdio_init(void)
+{
+    if (g_dma_chan >= 0) {
+        return true;
+    }
+
+    int lock_num = spin_lock_claim_unused(false);
+    if (lock_num < 0) {
+        return false;
+    }
+    g_lock = spin_lock_init((uint)lock_num);
+
+    g_dma_chan = dma_claim_unused_channel(false);
+    if (g_dma_chan < 0) {
+        spin_lock_unclaim((uint)lock_num);
+        return false;
+    }
+
+    dma_channel_config c = dma_channel_get_default_config(g_dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, uart_get_dreq(DEBUG_UART, true));
+
+    dma_channel_configure(
+        g_dma_chan,
+        &c,
+        &uart_get_hw(DEBUG_UART)->dr,
+        NULL,
+        0,
+        false
+    );
+
+    dma_channel_set_irq1_enabled(g_dma_chan, true);
+    irq_add_shared_handler(DMA_IRQ_1, debug_stdio_dma_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_1, true);
+
+    // The SDK driver has already set up the pins and baud rate; from here on
+    // output is queued instead of written byte by byte
+    stdio_set_driver_enabled(&stdio_uart, false);
+    stdio_set_driver_enabled(&g_debug_stdio_driver, true);
+    return true;
+}
+
+void debug_stdio_flush(void)
+{
+    if (g_dma_chan < 0) {
+        return;
+    }
+
+    // Poll instead of waiting for the IRQ, which may be masked on this path
+    do {
+        tight_loop_contents();
+        debug_stdio_kick();
+    } while (g_dma_ring >= 0);
+
+    while (uart_get_hw(DEBUG_UART)->fr & UART_UARTFR_BUSY_BITS) {
+        tight_loop_contents();
+    }
+}
+
+uint32_t debug_stdio_get_dropped(void)
+{
+    uint32_t dropped = 0;
+    for (uint32_t core = 0; core < NUM_CORES; core++) {
+        dropped += g_rings[core].dropped;
+    }
+    return dropped;
+}
@@ -0,0 +1,27 @@
+/*
+ * Non-blocking Debug stdio for PIOKMbox
+ *
+ * Replaces the SDK's blocking UART stdio driver on the debug UART. printf()
+ * output is copied into a RAM ring owned by the calling core and sent by
+ * DMA, so logging from core0's main loop or core1's host loop never waits
+ * on the wire. When a ring is full the output is dropped and counted.
+ */
+
+#ifndef DEBUG_STDIO_H
+#define DEBUG_STDIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Take over stdio from the SDK UART driver. Call after stdio_init_all()
+// (which sets up the debug UART pins and baud rate).
+bool debug_stdio_init(void);
+
+// Block until everything queued has left the UART. Only for fatal paths
+// such as a forced reset; safe with interrupts disabled.
+void debug_stdio_flush(void);
+
+// Bytes discarded because a ring was full
+uint32_t debug_stdio_get_dropped(void);
+
+#endif // DEBUG_STDIO_H
@@ -40,6 +40,11 @@
 #define KMBOX_UART_RX_PIN       (6u)     // GPIO5 for UART1 RX
 #define KMBOX_UART_BAUDRATE     115200   // Standard baud rate for KMBox
 #define KMBOX_UART_FIFO_SIZE    32       // UART FIFO size for buffering
+#define KMBOX_BAUD_CONFIRM_MS   1000     // Revert km.baud() if no command arrives in time
+
+// Debug UART (stdio), sent by DMA from a RAM ring per core
+#define DEBUG_UART              uart0    // GPIO0/1, set up by stdio_init_all()
+#define DEBUG_STDIO_RING_SIZE   2048     // Bytes per core (power of two)
 
 // USB port configuration
 #define USB_DEVICE_PORT         0       // On-board USB controller port (device mode)
@@ -76,9 +81,10 @@
 #define BUTTON_HOLD_TRIGGER_MS          3000    // Hold time for USB reset
 #define BUTTON_DEBOUNCE_MS              10      // Button polling interval
 #define USB_RESET_COOLDOWN_MS           2000    // Post-reset cooldown
+#define USB_REENUM_DISCONNECT_MS        500     // Time off the bus when re-enumerating (host must see the disconnect)
 
 // Main loop task timing
-#define HID_DEVICE_TASK_INTERVAL_MS     8       // 8ms = ~125 FPS for ultra-smooth operation
+#define HID_DEVICE_TASK_INTERVAL_MS     8       // Button sampling and remote wakeup interval
 #define WATCHDOG_TASK_INTERVAL_MS       100     // Watchdog update frequency
 #define WATCHDOG_INIT_DELAY_MS          8       // HID device task frequency
 #define VISUAL_TASK_INTERVAL_MS         50      // LED/neopixel update frequency
@@ -155,9 +161,9 @@
 #define CONFIG_TOTAL_LEN                (TUD_CONFIG_DESC_LEN + TUD_HID_DESC_LEN)
 #define EPNUM_HID                       HID_ENDPOINT_ADDRESS
 
-// HID report descriptor length is always patched at runtime to match the
-// constructed runtime HID report descriptor which mirrors the attached host
-// mouse. No compile-time static length is used.
+// The HID report descriptor length in the configuration descriptor is
+// patched at runtime to match the runtime HID report descriptor, whose mouse
+// report is 8-bit or 16-bit (see USB_MOUSE_WIDE_REPORTS).
 
 //--------------------------------------------------------------------+
 // HID CONFIGURATION
@@ -167,6 +173,24 @@
 #define HID_ENDPOINT_ADDRESS            0x81    // HID IN endpoint address (device mode)
 #define HID_POLLING_INTERVAL_MS         1       // HID polling interval in ms
 
+// Start-of-frame synchronized mouse reports. Merged movement is submitted
+// HID_SOF_SEND_AHEAD_US before the next frame starts rather than as soon as
+// it arrives, so the report the host picks up in that frame carries the
+// newest input and the input-to-host delay no longer depends on where in the
+// frame it arrived. When the last SOF seen is a frame or more old (suspend,
+// not yet configured, or a tud_task() pass that has not delivered the next
+// SOF yet) reports are submitted immediately.
+#ifndef HID_SOF_SYNC_ENABLED
+#define HID_SOF_SYNC_ENABLED            1
+#endif
+#define HID_SOF_SEND_AHEAD_US           200     // Default submit lead before the next SOF (us)
+#define USB_FRAME_US                    1000    // Full-speed frame length
+
+// Reports are sent only on change, by priority: mouse > keyboard > consumer.
+// A keyboard or consumer report waits for a pending mouse report at most
+// this long, so continuous mouse movement cannot starve it.
+#define HID_ARBITER_MAX_DEFER_US        2000
+
 // USB endpoint allocation to prevent conflicts
 // Device stack (controller 0) uses endpoints 0x00-0x8F
 // Host stack (controller 1) has separate endpoint space
@@ -177,6 +201,10 @@
 #define HID_KEYBOARD_KEYCODE_COUNT      6       // Number of simultaneous keycodes supported
 #define HID_CONSUMER_CONTROL_SIZE       2       // Consumer control report size in bytes
 
+// Host reports are parsed on core1 and handed to core0 through a lock-free
+// single-producer/single-consumer queue (power of two)
+#define HOST_REPORT_QUEUE_SIZE          32      // Queue slots
+
 // Activity tracking
 #define KEYBOARD_ACTIVITY_THROTTLE      50      // Trigger keyboard activity flash every 50 reports
 #define MOUSE_ACTIVITY_THROTTLE         100     // Trigger mouse activity flash every 100 reports
@@ -194,6 +222,16 @@
 // Mouse button masks
 #define MOUSE_BUTTON_NONE               0x00    // No mouse buttons pressed
 
+// Device mouse report format. The wide report carries 16-bit X/Y, wheel and
+// pan so high-DPI movement is not split across reports; switching formats
+// re-enumerates the device.
+#define USB_MOUSE_WIDE_NEVER            0       // Always the 8-bit boot layout
+#define USB_MOUSE_WIDE_AUTO             1       // Wide when the attached mouse has axes wider than 8 bits or more than 8 buttons
+#define USB_MOUSE_WIDE_ALWAYS           2       // Always the wide layout
+#ifndef USB_MOUSE_WIDE_REPORTS
+#define USB_MOUSE_WIDE_REPORTS          USB_MOUSE_WIDE_AUTO
+#endif
+
 //--------------------------------------------------------------------+
 // SERIAL STRING CONFIGURATION
 //--------------------------------------------------------------------+
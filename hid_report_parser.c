@@ -0,0 +1,487 @@
+/*
+ * HID Report Descriptor Parser for PIOKMbox
+ */
+
+#include "hid_report_parser.h"
+#include <string.h>
+
+// Item types and tags (HID 1.11, section 6.2.2)
+#define HID_ITEM_TYPE_MAIN              0
+#define HID_ITEM_TYPE_GLOBAL            1
+#define HID_ITEM_TYPE_LOCAL             2
+#define HID_ITEM_LONG                   0xFE
+
+#define HID_MAIN_INPUT                  0x8
+#define HID_MAIN_COLLECTION             0xA
+#define HID_MAIN_END_COLLECTION         0xC
+
+#define HID_GLOBAL_USAGE_PAGE           0x0
+#define HID_GLOBAL_LOGICAL_MIN          0x1
+#define HID_GLOBAL_LOGICAL_MAX          0x2
+#define HID_GLOBAL_REPORT_SIZE          0x7
+#define HID_GLOBAL_REPORT_ID            0x8
+#define HID_GLOBAL_REPORT_COUNT         0x9
+#define HID_GLOBAL_PUSH                 0xA
+#define HID_GLOBAL_POP                  0xB
+
+#define HID_LOCAL_USAGE                 0x0
+#define HID_LOCAL_USAGE_MIN             0x1
+#define HID_LOCAL_USAGE_MAX             0x2
+
+#define HID_INPUT_CONSTANT              0x01
+#define HID_INPUT_VARIABLE              0x02
+#define HID_INPUT_RELATIVE              0x04
+
+#define HID_COLLECTION_APPLICATION      0x01
+
+// Usages as (page << 16) | id
+#define HID_USAGE(page, id)             (((uint32_t)(page) << 16) | (id))
+#define HID_PAGE_BUTTON                 0x09
+#define HID_USAGE_MOUSE                 HID_USAGE(0x01, 0x02)
+#define HID_USAGE_X                     HID_USAGE(0x01, 0x30)
+#define HID_USAGE_Y                     HID_USAGE(0x01, 0x31)
+#define HID_USAGE_WHEEL                 HID_USAGE(0x01, 0x38)
+#define HID_USAGE_AC_PAN                HID_USAGE(0x0C, 0x238)
+
+#define HID_PARSER_MAX_IDS              16      // Report IDs whose input offsets are tracked
+#define HID_PARSER_MAX_REPORT_BITS      0xFFFF
+
+typedef struct {
+    uint16_t usage_page;
+    int32_t logical_min;
+    int32_t logical_max;
+    uint32_t logical_max_unsigned;
+    uint32_t report_size;
+    uint32_t report_count;
+    uint8_t report_id;
+} hid_globals_t;
+
+typedef struct {
+    hid_globals_t globals;
+    hid_globals_t stack[HID_PARSER_STACK_DEPTH];
+    uint8_t stack_depth;
+
+    // Local items of the next main item. Usages given with a 1 or 2 byte
+    // item have page 0 here and take the usage page in effect at the main item.
+    uint32_t usages[HID_PARSER_MAX_USAGES];
+    uint8_t usage_count;
+    uint32_t usage_min;
+    uint32_t usage_max;
+    bool has_usage_range;
+
+    uint8_t collection_depth;
+    bool in_mouse_application;
+
+    // Input bits seen so far for each report ID
+    uint8_t ids[HID_PARSER_MAX_IDS];
+    uint32_t id_bits[HID_PARSER_MAX_IDS];
+    uint8_t id_count;
+
+    hid_mouse_layout_t* layout;
+} hid_parser_t;
+
+static uint32_t resolve_usage(const hid_parser_t* p, uint32_t usage)
+{
+    return (usage >> 16) ? usage : HID_USAGE(p->globals.usage_page, usage);
+}
+
+// Usage of the index-th field of a variable main item
+static uint32_t field_usage(const hid_parser_t* p, uint32_t index)
+{
+    if (p->usage_count > 0) {
+        // Extra fields repeat the last usage
+        uint32_t i = (index < p->usage_count) ? index : (uint32_t)(p->usage_count - 1);
+        return resolve_usage(p, p->usages[i]);
+    }
+    if (p->has_usage_range) {
+        uint32_t min = resolve_usage(p, p->usage_min);
+        uint32_t max = resolve_usage(p, p->usage_max);
+        return (min + index <= max) ? min + index : max;
+    }
+    return 0;
+}
+
+static void clear_locals(hid_parser_t* p)
+{
+    p->usage_count = 0;
+    p->has_usage_range = false;
+}
+
+static uint32_t* report_bits_for_id(hid_parser_t* p, uint8_t report_id)
+{
+    for (uint8_t i = 0; i < p->id_count; i++) {
+        if (p->ids[i] == report_id) {
+            return &p->id_bits[i];
+        }
+    }
+    if (p->id_count >= HID_PARSER_MAX_IDS) {
+        return NULL;
+    }
+    p->ids[p->id_count] = report_id;
+    p->id_bits[p->id_count] = 0;
+    return &p->id_bits[p->id_count++];
+}
+
+static hid_mouse_plan_t* plan_for_id(hid_parser_t* p, uint8_t report_id)
+{
+    hid_mouse_layout_t* layout = p->layout;
+    for (uint8_t i = 0; i < layout->count; i++) {
+        if (layout->plans[i].report_id == report_id) {
+            return &layout->plans[i];
+        }
+    }
+    if (layout->count >= HID_PARSER_MAX_REPORTS) {
+        return NULL;
+    }
+    hid_mouse_plan_t* plan = &layout->plans[layout->count++];
+    memset(plan, 0, sizeof(*plan));
+    plan->report_id = report_id;
+    return plan;
+}
+
+static void set_field(const hid_parser_t* p, hid_field_t* field, uint32_t bit_offset, uint8_t flags)
+{
+    field->bit_offset = (uint16_t)bit_offset;
+    field->bit_size = (uint8_t)p->globals.report_size;
+    field->is_signed = p->globals.logical_min < 0;
+    field->is_relative = (flags & HID_INPUT_RELATIVE) != 0;
+    field->logical_min = p->globals.logical_min;
+    field->logical_max = field->is_signed ? p->globals.logical_max
+                                          : (int32_t)p->globals.logical_max_unsigned;
+}
+
+static bool add_input(hid_parser_t* p, uint8_t flags)
+{
+    uint32_t* bits = report_bits_for_id(p, p->globals.report_id);
+    if (bits == NULL) {
+        return false;
+    }
+
+    const uint32_t size = p->globals.report_size;
+    const uint32_t count = p->globals.report_count;
+    const uint32_t base = *bits;
+    if ((uint64_t)size * count > HID_PARSER_MAX_REPORT_BITS - base) {
+        return false;
+    }
+    *bits = base + size * count;
+
+    // Padding, arrays and anything outside the mouse collection only take space
+    if ((flags & HID_INPUT_CONSTANT) || !(flags & HID_INPUT_VARIABLE) ||
+        !p->in_mouse_application || size == 0 || size > 32) {
+        return true;
+    }
+
+    hid_mouse_plan_t* plan = NULL;
+    for (uint32_t i = 0; i < count; i++) {
+        const uint32_t usage = field_usage(p, i);
+        const uint32_t offset = base + i * size;
+        const bool is_button = (usage >> 16) == HID_PAGE_BUTTON && size == 1 &&
+                               (usage & 0xFFFF) >= 1 && (usage & 0xFFFF) <= 16;
+
+        if (!is_button && usage != HID_USAGE_X && usage != HID_USAGE_Y &&
+            usage != HID_USAGE_WHEEL && usage != HID_USAGE_AC_PAN) {
+            continue;
+        }
+        if (plan == NULL && (plan = plan_for_id(p, p->globals.report_id)) == NULL) {
+            return true;
+        }
+
+        if (is_button) {
+            // Buttons are taken as one bitmap starting at button 1
+            const uint8_t button = (uint8_t)(usage & 0xFFFF);
+            if (button == 1) {
+                set_field(p, &plan->buttons, offset, flags);
+            }
+            if (button > plan->button_count) {
+                plan->button_count = button;
+            }
+            continue;
+        }
+
+        hid_field_t* field = (usage == HID_USAGE_X)     ? &plan->x :
+                             (usage == HID_USAGE_Y)     ? &plan->y :
+                             (usage == HID_USAGE_WHEEL) ? &plan->wheel : &plan->pan;
+        if (field->bit_size == 0) {
+            set_field(p, field, offset, flags);
+        }
+    }
+    return true;
+}
+
+static bool parse_main(hid_parser_t* p, uint8_t tag, uint32_t data)
+{
+    switch (tag) {
+    case HID_MAIN_INPUT:
+        if (!add_input(p, (uint8_t)data)) {
+            return false;
+        }
+        break;
+
+    case HID_MAIN_COLLECTION:
+        if (p->collection_depth == 0 && data == HID_COLLECTION_APPLICATION) {
+            p->in_mouse_application = field_usage(p, 0) == HID_USAGE_MOUSE;
+        }
+        if (p->collection_depth == UINT8_MAX) {
+            return false;
+        }
+        p->collection_depth++;
+        break;
+
+    case HID_MAIN_END_COLLECTION:
+        if (p->collection_depth == 0) {
+            return false;
+        }
+        if (--p->collection_depth == 0) {
+            p->in_mouse_application = false;
+        }
+        break;
+
+    default:
+        // Output and Feature reports do not move input offsets
+        break;
+    }
+
+    clear_locals(p);
+    return true;
+}
+
+static bool parse_global(hid_parser_t* p, uint8_t tag, uint32_t data, int32_t sdata)
+{
+    hid_globals_t* g = &p->globals;
+
+    switch (tag) {
+    case HID_GLOBAL_USAGE_PAGE:
+        g->usage_page = (uint16_t)data;
+        break;
+    case HID_GLOBAL_LOGICAL_MIN:
+        g->logical_min = sdata;
+        break;
+    case HID_GLOBAL_LOGICAL_MAX:
+        // Kept both ways: with a non-negative minimum, 0xFF means 255
+        g->logical_max = sdata;
+        g->logical_max_unsigned = data;
+        break;
+    case HID_GLOBAL_REPORT_SIZE:
+        g->report_size = data;
+        break;
+    case HID_GLOBAL_REPORT_ID:
+        if (data == 0 || data > 0xFF) {
+            return false;
+        }
+        g->report_id = (uint8_t)data;
+        p->layout->uses_report_ids = true;
+        break;
+    case HID_GLOBAL_REPORT_COUNT:
+        g->report_count = data;
+        break;
+    case HID_GLOBAL_PUSH:
+        if (p->stack_depth >= HID_PARSER_STACK_DEPTH) {
+            return false;
+        }
+        p->stack[p->stack_depth++] = *g;
+        break;
+    case HID_GLOBAL_POP:
+        if (p->stack_depth == 0) {
+            return false;
+        }
+        *g = p->stack[--p->stack_depth];
+        break;
+    default:
+        // Physical range and units do not affect extraction
+        break;
+    }
+    return true;
+}
+
+static void parse_local(hid_parser_t* p, uint8_t tag, uint32_t data, uint8_t size)
+{
+    // Four-byte usages carry their own page
+    const uint32_t usage = (size == 4) ? data : (data & 0xFFFF);
+
+    switch (tag) {
+    case HID_LOCAL_USAGE:
+        if (p->usage_count < HID_PARSER_MAX_USAGES) {
+            p->usages[p->usage_count++] = usage;
+        }
+        break;
+    case HID_LOCAL_USAGE_MIN:
+        p->usage_min = usage;
+        p->has_usage_range = true;
+        break;
+    case HID_LOCAL_USAGE_MAX:
+        p->usage_max = usage;
+        p->has_usage_range = true;
+        break;
+    default:
+        break;
+    }
+}
+
+bool hid_parser_compile_mouse(const uint8_t *desc, size_t desc_len, hid_mouse_layout_t *layout)
+{
+    if (layout == NULL) {
+        return false;
+    }
+    memset(layout, 0, sizeof(*layout));
+    if (desc == NULL) {
+        return false;
+    }
+
+    hid_parser_t parser;
+    memset(&parser, 0, sizeof(parser));
+    parser.layout = layout;
+
+    const uint8_t* pos = desc;
+    const uint8_t* end = desc + desc_len;
+    bool ok = true;
+
+    while (ok && pos < end) {
+        const uint8_t prefix = *pos++;
+
+        if (prefix == HID_ITEM_LONG) {
+            // Long items are reserved; skip them
+            if (end - pos < 2 || end - pos - 2 < pos[0]) {
+                ok = false;
+                break;
+            }
+            pos += 2 + pos[0];
+            continue;
+        }
+
+        uint8_t size = prefix & 0x03;
+        if (size == 3) {
+            size = 4;
+        }
+        if (end - pos < size) {
+            ok = false;
+            break;
+        }
+
+        uint32_t data = 0;
+        for (uint8_t i = 0; i < size; i++) {
+            data |= (uint32_t)pos[i] << (8 * i);
+        }
+        int32_t sdata = (int32_t)data;
+        if (size == 1) {
+            sdata = (int8_t)data;
+        } else if (size == 2) {
+            sdata = (int16_t)data;
+        }
+        pos += size;
+
+        const uint8_t tag = prefix >> 4;
+        switch ((prefix >> 2) & 0x03) {
+        case HID_ITEM_TYPE_MAIN:
+            ok = parse_main(&parser, tag, data);
+            break;
+        case HID_ITEM_TYPE_GLOBAL:
+            ok = parse_global(&parser, tag, data, sdata);
+            break;
+        case HID_ITEM_TYPE_LOCAL:
+            parse_local(&parser, tag, data, size);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Keep only reports that carry both axes as relative movement; absolute
+    // X/Y (tablets, touch screens, absolute pointers in composite devices)
+    // cannot be forwarded as mouse deltas. An absolute wheel or pan is left
+    // out of an otherwise relative report.
+    uint8_t kept = 0;
+    for (uint8_t i = 0; ok && i < layout->count; i++) {
+        hid_mouse_plan_t* plan = &layout->plans[i];
+        if (plan->x.bit_size == 0 || plan->y.bit_size == 0 ||
+            !plan->x.is_relative || !plan->y.is_relative) {
+            continue;
+        }
+        if (!plan->wheel.is_relative) {
+            memset(&plan->wheel, 0, sizeof(plan->wheel));
+        }
+        if (!plan->pan.is_relative) {
+            memset(&plan->pan, 0, sizeof(plan->pan));
+        }
+        uint32_t* bits = report_bits_for_id(&parser, plan->report_id);
+        plan->report_bits = bits ? (uint16_t)*bits : 0;
+        if (plan->buttons.bit_size != 0) {
+            // Read all buttons with one extraction
+            plan->buttons.bit_size = plan->button_count;
+            plan->buttons.is_signed = false;
+        }
+        layout->plans[kept++] = *plan;
+    }
+    layout->count = kept;
+
+    if (!ok || kept == 0) {
+        memset(layout, 0, sizeof(*layout));
+        return false;
+    }
+    return true;
+}
+
+int32_t hid_parser_extract(const uint8_t *data, uint16_t len, const hid_field_t *field)
+{
+    if (field->bit_size == 0 || (uint32_t)field->bit_offset + field->bit_size > (uint32_t)len * 8) {
+        return 0;
+    }
+
+    // Gather the (at most five) bytes spanning the field, then shift and mask
+    const uint8_t* p = data + (field->bit_offset >> 3);
+    const unsigned shift = field->bit_offset & 7;
+    const unsigned nbytes = (shift + field->bit_size + 7) >> 3;
+    uint64_t raw = 0;
+    for (unsigned i = 0; i < nbytes; i++) {
+        raw |= (uint64_t)p[i] << (8 * i);
+    }
+
+    const uint64_t mask = ((uint64_t)1 << field->bit_size) - 1;
+    uint64_t value = (raw >> shift) & mask;
+    if (field->is_signed && (value >> (field->bit_size - 1)) & 1) {
+        value |= ~mask;
+    }
+    return (int32_t)(uint32_t)value;
+}
+
+bool hid_parser_decode_mouse(const hid_mouse_layout_t *layout, const uint8_t *report, uint16_t len,
+                             hid_mouse_values_t *out)
+{
+    if (layout == NULL || report == NULL || out == NULL || layout->count == 0) {
+        return false;
+    }
+
+    uint8_t report_id = 0;
+    if (layout->uses_report_ids) {
+        if (len < 1) {
+            return false;
+        }
+        report_id = report[0];
+        report++;
+        len--;
+    }
+
+    const hid_mouse_plan_t* plan = NULL;
+    for (uint8_t i = 0; i < layout->count; i++) {
+        if (layout->plans[i].report_id == report_id) {
+            plan = &layout->plans[i];
+            break;
+        }
+    }
+    if (plan == NULL) {
+        return false;
+    }
+
+    // Both axes must be present; trailing fields may be cut short
+    const uint32_t avail = (uint32_t)len * 8;
+    if ((uint32_t)plan->x.bit_offset + plan->x.bit_size > avail ||
+        (uint32_t)plan->y.bit_offset + plan->y.bit_size > avail) {
+        return false;
+    }
+
+    out->buttons = (uint16_t)hid_parser_extract(report, len, &plan->buttons);
+    out->x = hid_parser_extract(report, len, &plan->x);
+    out->y = hid_parser_extract(report, len, &plan->y);
+    out->wheel = hid_parser_extract(report, len, &plan->wheel);
+    out->pan = hid_parser_extract(report, len, &plan->pan);
+    return true;
+}
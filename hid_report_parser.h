@@ -0,0 +1,90 @@
+/*
+ * HID Report Descriptor Parser for PIOKMbox
+ *
+ * Runs once when a mouse is mounted and compiles its report descriptor into
+ * an extraction plan per input report ID: bit offset, size, signedness and
+ * logical range of the buttons, X, Y, wheel and AC pan fields. Decoding a
+ * report is then a table lookup plus a shift and mask per field, whatever
+ * the layout (8/12/16-bit axes, report IDs, vendor padding).
+ *
+ * Plain C without Pico SDK dependencies, so it also builds on the host.
+ */
+
+#ifndef HID_REPORT_PARSER_H
+#define HID_REPORT_PARSER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+//--------------------------------------------------------------------+
+// CONFIGURATION
+//--------------------------------------------------------------------+
+
+#define HID_PARSER_MAX_REPORTS          4       // Mouse input reports kept per interface
+#define HID_PARSER_MAX_USAGES           16      // Local usages per main item
+#define HID_PARSER_STACK_DEPTH          4       // Push/Pop nesting
+
+//--------------------------------------------------------------------+
+// EXTRACTION PLAN
+//--------------------------------------------------------------------+
+
+// Location of one field in a report, counted from the first byte after the
+// report ID. bit_size 0 means the report has no such field.
+typedef struct {
+    uint16_t bit_offset;
+    uint8_t bit_size;           // 1..32
+    bool is_signed;             // Logical minimum below zero
+    bool is_relative;           // Input item Relative flag
+    int32_t logical_min;
+    int32_t logical_max;
+} hid_field_t;
+
+typedef struct {
+    uint8_t report_id;          // 0 when the interface does not use report IDs
+    uint8_t button_count;       // Buttons 1..button_count, one bit each
+    uint16_t report_bits;       // Input report size without the report ID
+    hid_field_t buttons;        // Bit of button 1 (bit_size 1)
+    hid_field_t x;
+    hid_field_t y;
+    hid_field_t wheel;
+    hid_field_t pan;
+} hid_mouse_plan_t;
+
+typedef struct {
+    bool uses_report_ids;
+    uint8_t count;              // Number of valid plans, 0 if no mouse report was found
+    hid_mouse_plan_t plans[HID_PARSER_MAX_REPORTS];
+} hid_mouse_layout_t;
+
+// Decoded mouse report, at the resolution of the device
+typedef struct {
+    uint16_t buttons;           // Bit n = button n + 1
+    int32_t x;
+    int32_t y;
+    int32_t wheel;
+    int32_t pan;
+} hid_mouse_values_t;
+
+//--------------------------------------------------------------------+
+// API
+//--------------------------------------------------------------------+
+
+// Compile a report descriptor. Only input reports inside a Generic Desktop
+// Mouse application collection that carry relative X and Y produce a plan;
+// absolute wheel and pan fields are left out. Returns
+// false for a malformed descriptor or one without a mouse report; layout is
+// left empty in that case.
+bool hid_parser_compile_mouse(const uint8_t *desc, size_t desc_len, hid_mouse_layout_t *layout);
+
+// Decode an input report (including its report ID byte when the layout uses
+// report IDs). Only bytes below len are read. Returns false if the report
+// ID is not a mouse report or the report is shorter than its X/Y fields.
+bool hid_parser_decode_mouse(const hid_mouse_layout_t *layout, const uint8_t *report, uint16_t len,
+                             hid_mouse_values_t *out);
+
+// Extract one field from report data (after the report ID). Returns 0 when
+// the field is absent or lies beyond len.
+int32_t hid_parser_extract(const uint8_t *data, uint16_t len, const hid_field_t *field);
+
+#endif // HID_REPORT_PARSER_H
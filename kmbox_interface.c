@@ -1,10 +1,11 @@
 /*
  * KMBox Interface Implementation
- * 
+ *
  * Consolidated UART and SPI interface implementation
  */
 
 #include "kmbox_interface.h"
+#include "defines.h"
 #include "pico/stdlib.h"
 #include "hardware/uart.h"
 #include "hardware/spi.h"
@@ -15,9 +16,9 @@
 
 // Default configurations
 const kmbox_uart_config_t KMBOX_UART_DEFAULT_CONFIG = {
-    .baudrate = 250000,
-    .tx_pin = 4,
-    .rx_pin = 5,
+    .baudrate = KMBOX_UART_BAUDRATE,
+    .tx_pin = KMBOX_UART_TX_PIN,
+    .rx_pin = KMBOX_UART_RX_PIN,
     .use_dma = true
 };
 
@@ -33,10 +34,14 @@ const kmbox_spi_config_t KMBOX_SPI_DEFAULT_CONFIG = {
 
 // Buffer sizes (must be power of 2)
 #define RX_BUFFER_SIZE 512
-#define TX_BUFFER_SIZE 256
+#define TX_BUFFER_SIZE 512
 #define RX_BUFFER_MASK (RX_BUFFER_SIZE - 1)
 #define TX_BUFFER_MASK (TX_BUFFER_SIZE - 1)
 
+// The RX DMA channel runs with the largest transfer count and is re-armed
+// from the DMA IRQ when it runs out (about every four hours at 3 Mbaud)
+#define RX_DMA_COUNT 0xFFFFFFFFu
+
 // Static assertions for buffer sizes
 _Static_assert((RX_BUFFER_SIZE & (RX_BUFFER_SIZE - 1)) == 0,
                "RX_BUFFER_SIZE must be a power of two");
@@ -54,15 +59,27 @@ typedef struct {
         spi_inst_t* spi;
     } instance;
     
-    // Ring buffers
+    // Ring buffers. The RX ring is written by DMA with address wrapping, so
+    // it must be aligned to its size.
     uint8_t __attribute__((aligned(RX_BUFFER_SIZE))) rx_buffer[RX_BUFFER_SIZE];
-    uint8_t __attribute__((aligned(TX_BUFFER_SIZE))) tx_buffer[TX_BUFFER_SIZE];
-    
-    // Ring buffer indices
-    volatile uint16_t rx_head;
-    volatile uint16_t rx_tail;
-    volatile uint16_t tx_head;
-    volatile uint16_t tx_tail;
+    uint8_t tx_buffer[TX_BUFFER_SIZE];
+    
+    // RX accounting. Totals are free-running byte counts; the ring indices
+    // are derived from them so a lapped ring can be detected.
+    volatile uint32_t rx_dma_base;   // Total at the last DMA re-arm
+    uint32_t rx_total;               // Total received (software fill without DMA)
+    uint32_t rx_consumed;            // Total handed to on_command_received
+    uint16_t rx_scan;                // Next byte to check for a delimiter
+    uint32_t rx_last_total;
+    uint64_t rx_last_activity_us;
+    uint32_t rx_idle_us;
+    volatile bool rx_frame_ready;    // Delimiter seen or SPI CS released
+    
+    // TX ring indices. send() is the only producer and the TX pump the
+    // only consumer, both on the caller's core.
+    uint16_t tx_head;
+    uint16_t tx_tail;
+    uint16_t tx_inflight;            // Bytes handed to the running DMA transfer
     
     // DMA channels
     int dma_rx_chan;
@@ -73,10 +90,9 @@ typedef struct {
     
     // State flags
     bool initialized;
-    bool tx_in_progress;
     
     // SPI-specific state
-    bool cs_active;
+    volatile bool cs_active;
     uint32_t cs_timestamp;
 } kmbox_interface_state_t;
 
@@ -90,11 +106,12 @@ static kmbox_interface_state_t g_interface = {
 // Forward declarations
 static bool init_uart(const kmbox_uart_config_t* config);
 static bool init_spi(const kmbox_spi_config_t* config);
-static void process_uart(void);
-static void process_spi(void);
-static void uart_dma_rx_setup(void);
+static void process_rx(uint64_t now_us);
+static void process_tx(void);
+static void dma_setup(volatile void* data_reg, uint rx_dreq, uint tx_dreq);
 static void spi_cs_callback(uint gpio, uint32_t events);
 static void dma_rx_irq_handler(void);
+static void uart_error_irq_handler(void);
 
 // Initialize the interface
 bool kmbox_interface_init(const kmbox_interface_config_t* config)
@@ -117,11 +134,11 @@ bool kmbox_interface_init(const kmbox_interface_config_t* config)
         case KMBOX_TRANSPORT_UART:
             success = init_uart(&config->config.uart);
             break;
-            
+    
         case KMBOX_TRANSPORT_SPI:
             success = init_spi(&config->config.spi);
             break;
-            
+    
         default:
             return false;
     }
@@ -136,18 +153,16 @@ bool kmbox_interface_init(const kmbox_interface_config_t* config)
 // Initialize UART transport
 static bool init_uart(const kmbox_uart_config_t* config)
 {
-    // Determine UART instance based on pins
-    if (config->tx_pin == 0 && config->rx_pin == 1) {
-        g_interface.instance.uart = uart0;
-    } else if (config->tx_pin == 4 && config->rx_pin == 5) {
-        g_interface.instance.uart = uart1;
-    } else {
+    // Determine UART instance from the TX pin (UART0 on GPIO 0/12/16/28,
+    // UART1 on GPIO 4/8/20/24, in blocks of four)
+    if (config->tx_pin >= NUM_BANK0_GPIOS || config->baudrate == 0) {
         return false;
     }
+    g_interface.instance.uart = uart_get_instance(((config->tx_pin + 4) >> 3) & 1);
     
     // Initialize UART
     uart_init(g_interface.instance.uart, config->baudrate);
-
+    
     // Configure pins
     gpio_set_function(config->tx_pin, GPIO_FUNC_UART);
     gpio_set_function(config->rx_pin, GPIO_FUNC_UART);
@@ -158,28 +173,43 @@ static bool init_uart(const kmbox_uart_config_t* config)
     
     // Setup DMA if enabled
     if (config->use_dma) {
-        uart_dma_rx_setup();
+        dma_setup(&uart_get_hw(g_interface.instance.uart)->dr,
+                  uart_get_dreq(g_interface.instance.uart, false),
+                  uart_get_dreq(g_interface.instance.uart, true));
     }
     
+    // The UART interrupt only counts receive errors, data moves by DMA or
+    // by polling in kmbox_interface_process()
+    int uart_irq = (g_interface.instance.uart == uart0) ? UART0_IRQ : UART1_IRQ;
+    irq_set_exclusive_handler(uart_irq, uart_error_irq_handler);
+    irq_set_enabled(uart_irq, true);
+    uart_get_hw(g_interface.instance.uart)->imsc = UART_UARTIMSC_OEIM_BITS | UART_UARTIMSC_BEIM_BITS |
+                                                   UART_UARTIMSC_PEIM_BITS | UART_UARTIMSC_FEIM_BITS;
+    
+    // Two 10-bit characters of silence mark the end of a burst
+    g_interface.rx_idle_us = (20u * 1000000u) / config->baudrate + 1;
+    
     return true;
 }
 
 // Initialize SPI transport
 static bool init_spi(const kmbox_spi_config_t* config)
 {
-    // Determine SPI instance based on pins
-    if (config->sck_pin == 2 || config->sck_pin == 6) {
-        g_interface.instance.spi = spi0;
-    } else if (config->sck_pin == 10 || config->sck_pin == 14) {
-        g_interface.instance.spi = spi1;
-    } else {
+    // Determine SPI instance from the SCK pin (SPI0 on GPIO 2/6/18/22,
+    // SPI1 on GPIO 10/14/26, in blocks of eight)
+    if (config->sck_pin >= NUM_BANK0_GPIOS) {
         return false;
     }
+    g_interface.instance.spi = spi_get_instance((config->sck_pin >> 3) & 1);
     
     // Initialize SPI
     spi_init(g_interface.instance.spi, config->baudrate);
     spi_set_slave(g_interface.instance.spi, config->is_slave);
     
+    // CPHA=1 lets the master hold CS low across a whole multi-byte transfer;
+    // with CPHA=0 the PL022 needs CS toggled between bytes
+    spi_set_format(g_interface.instance.spi, 8, SPI_CPOL_0, SPI_CPHA_1, SPI_MSB_FIRST);
+    
     // Configure pins
     gpio_set_function(config->sck_pin, GPIO_FUNC_SPI);
     gpio_set_function(config->mosi_pin, GPIO_FUNC_SPI);
@@ -190,8 +220,8 @@ static bool init_spi(const kmbox_spi_config_t* config)
         gpio_init(config->cs_pin);
         gpio_set_dir(config->cs_pin, GPIO_IN);
         gpio_pull_up(config->cs_pin);
-        
-        // Setup CS interrupt
+    
+        // CS edges frame transfers: data is handed over when CS is released
         gpio_set_irq_enabled_with_callback(config->cs_pin,
                                            GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE,
                                            true,
@@ -202,11 +232,22 @@ static bool init_spi(const kmbox_spi_config_t* config)
         gpio_put(config->cs_pin, 1);
     }
     
+    // Setup DMA if enabled
+    if (config->use_dma) {
+        dma_setup(&spi_get_hw(g_interface.instance.spi)->dr,
+                  spi_get_dreq(g_interface.instance.spi, false),
+                  spi_get_dreq(g_interface.instance.spi, true));
+    }
+    
+    // Without CS framing, idle detection falls back to 16 bit times
+    g_interface.rx_idle_us = (16u * 1000000u) / config->baudrate + 1;
+    
     return true;
 }
 
-// Setup UART DMA
-static void uart_dma_rx_setup(void)
+// Setup RX (ring mode, free running) and TX (started per chunk) DMA
+// channels on a transport data register
+static void dma_setup(volatile void* data_reg, uint rx_dreq, uint tx_dreq)
 {
     g_interface.dma_rx_chan = dma_claim_unused_channel(true);
     
@@ -214,32 +255,64 @@ static void uart_dma_rx_setup(void)
     channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
     channel_config_set_read_increment(&c, false);
     channel_config_set_write_increment(&c, true);
-    channel_config_set_dreq(&c, uart_get_dreq(g_interface.instance.uart, false));
+    channel_config_set_dreq(&c, rx_dreq);
     channel_config_set_ring(&c, true, __builtin_ctz(RX_BUFFER_SIZE));
     
     dma_channel_configure(
         g_interface.dma_rx_chan,
         &c,
         g_interface.rx_buffer,
-        &uart_get_hw(g_interface.instance.uart)->dr,
-        0xFFFF,
+        data_reg,
+        RX_DMA_COUNT,
         true
     );
     
     dma_channel_set_irq1_enabled(g_interface.dma_rx_chan, true);
-    irq_set_exclusive_handler(DMA_IRQ_1, dma_rx_irq_handler);
+    irq_add_shared_handler(DMA_IRQ_1, dma_rx_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
     irq_set_enabled(DMA_IRQ_1, true);
+    
+    g_interface.dma_tx_chan = dma_claim_unused_channel(true);
+    
+    c = dma_channel_get_default_config(g_interface.dma_tx_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, tx_dreq);
+    
+    dma_channel_configure(
+        g_interface.dma_tx_chan,
+        &c,
+        data_reg,
+        g_interface.tx_buffer,
+        0,
+        false
+    );
 }
 
-// DMA RX IRQ handler
+// DMA RX IRQ handler: re-arm the free running RX channel
 static void dma_rx_irq_handler(void)
 {
-    if (g_interface.dma_rx_chan >= 0) {
-        dma_hw->ints1 = 1u << g_interface.dma_rx_chan;
-        dma_channel_set_trans_count(g_interface.dma_rx_chan, 0xFFFF, true);
+    if (g_interface.dma_rx_chan >= 0 && dma_channel_get_irq1_status(g_interface.dma_rx_chan)) {
+        dma_channel_acknowledge_irq1(g_interface.dma_rx_chan);
+        g_interface.rx_dma_base += RX_DMA_COUNT;
+        dma_channel_set_trans_count(g_interface.dma_rx_chan, RX_DMA_COUNT, true);
     }
 }
 
+// UART error IRQ handler
+static void uart_error_irq_handler(void)
+{
+    uart_hw_t* hw = uart_get_hw(g_interface.instance.uart);
+    uint32_t mis = hw->mis;
+    
+    if (mis & UART_UARTMIS_OEMIS_BITS) g_interface.stats.overruns++;
+    if (mis & UART_UARTMIS_FEMIS_BITS) g_interface.stats.framing_errors++;
+    if (mis & UART_UARTMIS_BEMIS_BITS) g_interface.stats.break_errors++;
+    if (mis & UART_UARTMIS_PEMIS_BITS) g_interface.stats.parity_errors++;
+    
+    hw->icr = mis;
+}
+
 // SPI CS callback
 static void spi_cs_callback(uint gpio, uint32_t events)
 {
@@ -251,113 +324,174 @@ static void spi_cs_callback(uint gpio, uint32_t events)
         g_interface.cs_active = true;
         g_interface.cs_timestamp = to_ms_since_boot(get_absolute_time());
     } else if (events & GPIO_IRQ_EDGE_RISE) {
+        // End of a CS-framed transfer: wake the receiver
         g_interface.cs_active = false;
+        g_interface.rx_frame_ready = true;
     }
 }
 
 // Process interface tasks
-void kmbox_interface_process(void)
+void kmbox_interface_process(uint64_t now_us)
 {
     if (!g_interface.initialized) {
         return;
     }
     
-    switch (g_interface.config.transport_type) {
-        case KMBOX_TRANSPORT_UART:
-            process_uart();
-            break;
-            
-        case KMBOX_TRANSPORT_SPI:
-            process_spi();
-            break;
-            
-        default:
-            break;
+    process_rx(now_us);
+    process_tx();
+}
+
+// Total number of bytes received since init
+static uint32_t rx_total(void)
+{
+    if (g_interface.dma_rx_chan < 0) {
+        return g_interface.rx_total;
     }
+    
+    uint32_t base, remaining;
+    do {
+        base = g_interface.rx_dma_base;
+        remaining = dma_channel_hw_addr(g_interface.dma_rx_chan)->transfer_count;
+    } while (base != g_interface.rx_dma_base);
+    return base + (RX_DMA_COUNT - remaining);
 }
 
-// Process UART data
-static void process_uart(void)
+// Without DMA: move whatever the FIFO holds into the ring
+static void poll_rx_fifo(void)
 {
-    uint16_t head = g_interface.rx_head;
-    uint16_t tail = g_interface.rx_tail;
-    
-    // Update head from DMA if using DMA
-    if (g_interface.config.config.uart.use_dma && g_interface.dma_rx_chan >= 0) {
-        uint32_t write_addr = dma_channel_hw_addr(g_interface.dma_rx_chan)->write_addr;
-        uint32_t buffer_start = (uint32_t)g_interface.rx_buffer;
-        head = (write_addr - buffer_start) & RX_BUFFER_MASK;
-    } else {
-        // Non-DMA: read from UART FIFO
+    uint16_t head = g_interface.rx_total & RX_BUFFER_MASK;
+    
+    if (g_interface.config.transport_type == KMBOX_TRANSPORT_UART) {
         while (uart_is_readable(g_interface.instance.uart)) {
-            uint16_t next_head = (head + 1) & RX_BUFFER_MASK;
-            if (next_head != tail) {
-                g_interface.rx_buffer[head] = uart_getc(g_interface.instance.uart);
-                head = next_head;
-            } else {
-                uart_getc(g_interface.instance.uart); // Discard
-                g_interface.stats.errors++;
+            g_interface.rx_buffer[head] = (uint8_t)uart_get_hw(g_interface.instance.uart)->dr;
+            head = (head + 1) & RX_BUFFER_MASK;
+            g_interface.rx_total++;
+        }
+    } else {
+        while (spi_is_readable(g_interface.instance.spi)) {
+            g_interface.rx_buffer[head] = (uint8_t)spi_get_hw(g_interface.instance.spi)->dr;
+            head = (head + 1) & RX_BUFFER_MASK;
+            g_interface.rx_total++;
+        }
+    }
+}
+
+// Hand received data to on_command_received once a frame is complete: a
+// line delimiter arrived, SPI CS was released or the line went idle.
+// Partial data is left in the ring so commands reach the parser in one go.
+static void process_rx(uint64_t now_us)
+{
+    if (g_interface.dma_rx_chan < 0) {
+        poll_rx_fifo();
+    }
+    
+    uint32_t total = rx_total();
+    uint32_t pending = total - g_interface.rx_consumed;
+    
+    if (pending > RX_BUFFER_SIZE - 1) {
+        // Unread data was overwritten; resynchronize on the newest bytes
+        uint32_t lost = pending - (RX_BUFFER_SIZE - 1);
+        g_interface.stats.rx_overflows += lost;
+        g_interface.rx_consumed += lost;
+        g_interface.rx_scan = g_interface.rx_consumed & RX_BUFFER_MASK;
+        pending = RX_BUFFER_SIZE - 1;
+    }
+    
+    uint16_t head = total & RX_BUFFER_MASK;
+    
+    if (total != g_interface.rx_last_total) {
+        g_interface.rx_last_total = total;
+        g_interface.rx_last_activity_us = now_us;
+    
+        // Scan only the new bytes for a line delimiter
+        uint16_t scan = g_interface.rx_scan;
+        while (scan != head) {
+            uint8_t ch = g_interface.rx_buffer[scan];
+            scan = (scan + 1) & RX_BUFFER_MASK;
+            if (ch == '\n' || ch == '\r') {
+                g_interface.rx_frame_ready = true;
             }
         }
-        g_interface.rx_head = head;
+        g_interface.rx_scan = scan;
     }
     
-    // Process received data
-    while (tail != head) {
-        uint16_t chunk_size;
-        if (head > tail) {
-            chunk_size = head - tail;
-        } else {
-            chunk_size = RX_BUFFER_SIZE - tail;
+    if (pending == 0) {
+        return;
+    }
+    
+    bool idle = (now_us - g_interface.rx_last_activity_us) >= g_interface.rx_idle_us;
+    if (!g_interface.rx_frame_ready && !idle) {
+        return;
+    }
+    g_interface.rx_frame_ready = false;
+    g_interface.stats.packets_received++;
+    
+    // Deliver as up to two contiguous spans when the data wraps
+    uint16_t tail = g_interface.rx_consumed & RX_BUFFER_MASK;
+    while (pending > 0) {
+        uint16_t chunk_size = RX_BUFFER_SIZE - tail;
+        if (chunk_size > pending) {
+            chunk_size = (uint16_t)pending;
         }
-        
-        if (g_interface.config.on_command_received && chunk_size > 0) {
+    
+        if (g_interface.config.on_command_received) {
             g_interface.config.on_command_received(&g_interface.rx_buffer[tail], chunk_size);
-            g_interface.stats.bytes_received += chunk_size;
         }
-        
+        g_interface.stats.bytes_received += chunk_size;
+    
+        g_interface.rx_consumed += chunk_size;
+        pending -= chunk_size;
         tail = (tail + chunk_size) & RX_BUFFER_MASK;
     }
-    
-    g_interface.rx_tail = tail;
 }
 
-// Process SPI data
-static void process_spi(void)
+// Retire the finished TX transfer and start the next contiguous chunk
+static void process_tx(void)
 {
-    // Process any available SPI data
-    while (spi_is_readable(g_interface.instance.spi)) {
-        uint8_t byte;
-        spi_read_blocking(g_interface.instance.spi, 0xFF, &byte, 1);
-        
-        uint16_t next_head = (g_interface.rx_head + 1) & RX_BUFFER_MASK;
-        if (next_head != g_interface.rx_tail) {
-            g_interface.rx_buffer[g_interface.rx_head] = byte;
-            g_interface.rx_head = next_head;
-            g_interface.stats.bytes_received++;
-        } else {
-            g_interface.stats.errors++;
+    if (g_interface.dma_tx_chan < 0) {
+        // Without DMA: top up the TX FIFO
+        while (g_interface.tx_tail != g_interface.tx_head) {
+            bool writable = (g_interface.config.transport_type == KMBOX_TRANSPORT_UART)
+                ? uart_is_writable(g_interface.instance.uart)
+                : spi_is_writable(g_interface.instance.spi);
+            if (!writable) {
+                break;
+            }
+            uint8_t byte = g_interface.tx_buffer[g_interface.tx_tail];
+            if (g_interface.config.transport_type == KMBOX_TRANSPORT_UART) {
+                uart_get_hw(g_interface.instance.uart)->dr = byte;
+            } else {
+                spi_get_hw(g_interface.instance.spi)->dr = byte;
+            }
+            g_interface.tx_tail = (g_interface.tx_tail + 1) & TX_BUFFER_MASK;
         }
+        return;
     }
     
-    // Process buffered data
-    uint16_t tail = g_interface.rx_tail;
-    uint16_t head = g_interface.rx_head;
+    if (dma_channel_is_busy(g_interface.dma_tx_chan)) {
+        return;
+    }
     
-    if (tail != head && g_interface.config.on_command_received) {
-        uint16_t chunk_size;
-        if (head > tail) {
-            chunk_size = head - tail;
-        } else {
-            chunk_size = RX_BUFFER_SIZE - tail;
-        }
-        
-        g_interface.config.on_command_received(&g_interface.rx_buffer[tail], chunk_size);
-        g_interface.rx_tail = (tail + chunk_size) & RX_BUFFER_MASK;
+    if (g_interface.tx_inflight > 0) {
+        g_interface.tx_tail = (g_interface.tx_tail + g_interface.tx_inflight) & TX_BUFFER_MASK;
+        g_interface.tx_inflight = 0;
+        g_interface.stats.packets_sent++;
+    }
+    
+    uint16_t head = g_interface.tx_head;
+    uint16_t tail = g_interface.tx_tail;
+    if (head == tail) {
+        return;
     }
+    
+    // Send up to the head, or up to the end of the buffer if the data wraps
+    uint16_t count = (head > tail) ? (head - tail) : (TX_BUFFER_SIZE - tail);
+    g_interface.tx_inflight = count;
+    dma_channel_transfer_from_buffer_now(g_interface.dma_tx_chan, &g_interface.tx_buffer[tail], count);
 }
 
-// Send data through the interface
+// Send data through the interface. Never blocks: returns false and counts
+// the data as dropped if it does not fit into the TX ring.
 bool kmbox_interface_send(const uint8_t* data, size_t len)
 {
     if (!g_interface.initialized || !data || len == 0) {
@@ -370,6 +504,7 @@ bool kmbox_interface_send(const uint8_t* data, size_t len)
     uint16_t available = (tail - head - 1) & TX_BUFFER_MASK;
     
     if (available < len) {
+        g_interface.stats.tx_dropped += len;
         g_interface.stats.errors++;
         return false;
     }
@@ -383,12 +518,47 @@ bool kmbox_interface_send(const uint8_t* data, size_t len)
     g_interface.tx_head = head;
     g_interface.stats.bytes_sent += len;
     
-    // Start transmission if not in progress
-    if (!g_interface.tx_in_progress) {
-        // TODO: Implement TX transmission
-        g_interface.tx_in_progress = true;
+    // Start transmission right away if the channel is idle
+    process_tx();
+    
+    return true;
+}
+
+// Check if all queued data has been transmitted
+bool kmbox_interface_tx_idle(void)
+{
+    if (!g_interface.initialized) {
+        return true;
     }
     
+    if (g_interface.tx_head != g_interface.tx_tail ||
+        (g_interface.dma_tx_chan >= 0 && dma_channel_is_busy(g_interface.dma_tx_chan))) {
+        return false;
+    }
+    
+    if (g_interface.config.transport_type == KMBOX_TRANSPORT_UART) {
+        return (uart_get_hw(g_interface.instance.uart)->fr & UART_UARTFR_BUSY_BITS) == 0;
+    }
+    return true;
+}
+
+// Change the UART baud rate
+bool kmbox_interface_set_baudrate(uint32_t baudrate)
+{
+    if (!g_interface.initialized || baudrate == 0 ||
+        g_interface.config.transport_type != KMBOX_TRANSPORT_UART) {
+        return false;
+    }
+    
+    // Retire the finished TX transfer so the ring indices are current
+    process_tx();
+    
+    // uart_set_baudrate() latches the new divisors with an LCR_H write, so
+    // the switch takes effect in one step
+    uint32_t actual = uart_set_baudrate(g_interface.instance.uart, baudrate);
+    g_interface.config.config.uart.baudrate = actual;
+    g_interface.rx_idle_us = (20u * 1000000u) / actual + 1;
+    
     return true;
 }
 
@@ -423,21 +593,29 @@ void kmbox_interface_deinit(void)
     
     // Stop DMA
     if (g_interface.dma_rx_chan >= 0) {
+        dma_channel_set_irq1_enabled(g_interface.dma_rx_chan, false);
         dma_channel_abort(g_interface.dma_rx_chan);
         dma_channel_unclaim(g_interface.dma_rx_chan);
+        irq_remove_handler(DMA_IRQ_1, dma_rx_irq_handler);
+        g_interface.dma_rx_chan = -1;
     }
     
     if (g_interface.dma_tx_chan >= 0) {
         dma_channel_abort(g_interface.dma_tx_chan);
         dma_channel_unclaim(g_interface.dma_tx_chan);
+        g_interface.dma_tx_chan = -1;
     }
     
     // Deinitialize transport
     switch (g_interface.config.transport_type) {
-        case KMBOX_TRANSPORT_UART:
+        case KMBOX_TRANSPORT_UART: {
+            int uart_irq = (g_interface.instance.uart == uart0) ? UART0_IRQ : UART1_IRQ;
+            irq_set_enabled(uart_irq, false);
+            irq_remove_handler(uart_irq, uart_error_irq_handler);
             uart_deinit(g_interface.instance.uart);
             break;
-            
+        }
+    
         case KMBOX_TRANSPORT_SPI:
             if (g_interface.config.config.spi.is_slave) {
                 gpio_set_irq_enabled(g_interface.config.config.spi.cs_pin,
@@ -446,7 +624,7 @@ void kmbox_interface_deinit(void)
             }
             spi_deinit(g_interface.instance.spi);
             break;
-            
+    
         default:
             break;
     }
@@ -458,4 +636,4 @@ void kmbox_interface_deinit(void)
 kmbox_transport_type_t kmbox_interface_get_transport_type(void)
 {
     return g_interface.initialized ? g_interface.config.transport_type : KMBOX_TRANSPORT_NONE;
-}
\ No newline at end of file
+}
@@ -45,7 +45,9 @@ typedef struct {
         kmbox_spi_config_t spi;
     } config;
     
-    // Callback for received commands
+    // Callback for received data. Called from kmbox_interface_process()
+    // once a frame is complete (line delimiter, SPI CS released or line
+    // idle) with up to two contiguous chunks straight from the RX ring.
     void (*on_command_received)(const uint8_t* data, size_t len);
 } kmbox_interface_config_t;
 
@@ -57,17 +59,32 @@ typedef struct {
     uint32_t packets_sent;
     uint32_t errors;
     uint32_t commands_processed;
+    uint32_t rx_overflows;      // Bytes lost because the RX ring was lapped
+    uint32_t tx_dropped;        // Bytes rejected because the TX ring was full
+    uint32_t overruns;          // UART FIFO overrun errors
+    uint32_t framing_errors;
+    uint32_t break_errors;
+    uint32_t parity_errors;
 } kmbox_interface_stats_t;
 
 // Initialize the interface with configuration
 bool kmbox_interface_init(const kmbox_interface_config_t* config);
 
-// Process interface tasks (call periodically)
-void kmbox_interface_process(void);
+// Process interface tasks (call periodically with the loop's time_us_64()
+// sample)
+void kmbox_interface_process(uint64_t now_us);
 
-// Send data through the interface
+// Send data through the interface (queued, transmitted by DMA; never blocks)
 bool kmbox_interface_send(const uint8_t* data, size_t len);
 
+// Check if everything queued has left the wire (TX ring empty, DMA idle
+// and the UART shift register empty)
+bool kmbox_interface_tx_idle(void);
+
+// Change the UART baud rate. Pending RX data is kept; call only once
+// kmbox_interface_tx_idle() so queued output is not garbled.
+bool kmbox_interface_set_baudrate(uint32_t baudrate);
+
 // Check if interface is ready to send
 bool kmbox_interface_is_ready(void);
 
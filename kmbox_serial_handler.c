@@ -6,193 +6,201 @@
 
 #include "kmbox_serial_handler.h"
 #include "lib/kmbox-commands/kmbox_commands.h"
+#include "kmbox_interface.h"
 #include "usb_hid.h"
 #include "led_control.h"
+#include "trace.h"
 #include "pico/stdlib.h"
-#include "hardware/uart.h"
-#include "hardware/irq.h"
+#include "hardware/clocks.h"
 #include <stdio.h>
 
-// Ring buffer for non-blocking UART reception
-// Use power-of-2 size for efficient modulo operation
-#define UART_RX_BUFFER_SIZE 256
-#define UART_RX_BUFFER_MASK (UART_RX_BUFFER_SIZE - 1)
-static volatile uint8_t uart_rx_buffer[UART_RX_BUFFER_SIZE];
-static volatile uint16_t uart_rx_head = 0;
-static volatile uint16_t uart_rx_tail = 0;
-
-// UART RX interrupt handler for high-performance non-blocking reception
-static void on_uart_rx(void) {
-    while (uart_is_readable(KMBOX_UART)) {
-        uint8_t ch = uart_getc(KMBOX_UART);
-        
-        // Calculate next head position using bitwise AND (faster than modulo)
-        uint16_t next_head = (uart_rx_head + 1) & UART_RX_BUFFER_MASK;
-        
-        // Store character if buffer not full
-        if (next_head != uart_rx_tail) {
-            uart_rx_buffer[uart_rx_head] = ch;
-            uart_rx_head = next_head;
-        }
-        // If buffer full, oldest data is discarded
+// Time base (us) for the parser while kmbox_interface_process() delivers data
+static uint64_t g_rx_time_us = 0;
+
+// Injection latency measurement. Only one injection is timed at a time: the
+// clock starts when a command leaves a report pending and stops when the
+// next report goes out.
+static kmbox_latency_stats_t g_latency = {0};
+static uint64_t g_inject_start_us = 0;
+static bool g_inject_timing = false;
+
+// Transport callback: feed received data to the command parser
+static void on_serial_data(const uint8_t *data, size_t len)
+{
+    uint32_t commands = kmbox_get_command_count();
+    kmbox_process_serial_data(data, len, g_rx_time_us);
+
+    if (!g_inject_timing && kmbox_get_command_count() != commands && kmbox_has_pending_report()) {
+        g_inject_start_us = g_rx_time_us;
+        g_inject_timing = true;
     }
 }
 
-// Callback invoked by PIO UART DMA handler. Copies bytes into the ring buffer.
-// When attached, pio UART DMA will write directly into uart_rx_buffer.
-static void pio_rx_to_ringbuffer(const uint8_t *data, size_t len)
+void kmbox_serial_report_sent(uint64_t now_us)
 {
-    for (size_t i = 0; i < len; ++i) {
-        uint8_t ch = data[i];
-        uint16_t next_head = (uart_rx_head + 1) & UART_RX_BUFFER_MASK;
-        if (next_head != uart_rx_tail) {
-            uart_rx_buffer[uart_rx_head] = ch;
-            uart_rx_head = next_head;
-        } else {
-            // Buffer full; drop oldest (same policy as IRQ handler)
-            break;
-        }
+    if (!g_inject_timing) {
+        return;
     }
-}
+    g_inject_timing = false;
 
-// Get character from ring buffer (non-blocking)
-static int uart_rx_getchar(void) {
-    if (uart_rx_head == uart_rx_tail) {
-        return -1; // Buffer empty
+    uint32_t latency_us = (uint32_t)(now_us - g_inject_start_us);
+    uint32_t bucket = 0;
+    while (bucket < KMBOX_LATENCY_BUCKETS - 1 &&
+           latency_us >= ((uint32_t)KMBOX_LATENCY_BUCKET_BASE_US << bucket)) {
+        bucket++;
+    }
+    g_latency.histogram[bucket]++;
+    g_latency.count++;
+    g_latency.total_us += latency_us;
+    if (latency_us > g_latency.max_us) {
+        g_latency.max_us = latency_us;
     }
-    
-    uint8_t ch = uart_rx_buffer[uart_rx_tail];
-    uart_rx_tail = (uart_rx_tail + 1) & UART_RX_BUFFER_MASK;
-    return ch;
 }
 
-// Peek for a full line in the ring buffer and copy it into dst (no terminator).
-// Returns true if a full line was copied; out_len receives the length copied and
-// term_len/term_buf are filled with the terminator bytes (if any).
-static bool ringbuf_peek_line_and_copy(char *dst, size_t dst_size, size_t *out_len, char *term_buf, uint8_t *term_len)
+void kmbox_serial_get_latency_stats(kmbox_latency_stats_t *stats)
 {
-    uint16_t head = uart_rx_head;
-    uint16_t tail = uart_rx_tail;
-    if (head == tail) return false; // empty
-
-    // Scan from tail to head for a terminator
-    uint16_t idx = tail;
-    uint16_t found = UINT16_MAX;
-    while (idx != head) {
-        uint8_t ch = uart_rx_buffer[idx & UART_RX_BUFFER_MASK];
-        if (ch == '\n' || ch == '\r') { found = idx; break; }
-        idx = (idx + 1) & UART_RX_BUFFER_MASK;
+    if (stats != NULL) {
+        *stats = g_latency;
     }
-    if (found == UINT16_MAX) return false; // no full line
-
-    // Determine terminator length (handle \r\n)
-    uint8_t tlen = 1;
-    char tbuf[2] = { (char)uart_rx_buffer[found & UART_RX_BUFFER_MASK], 0 };
-    // if \r and next is \n, consider two-byte terminator
-    if (tbuf[0] == '\r') {
-        uint16_t next = (found + 1) & UART_RX_BUFFER_MASK;
-        if (next != head && uart_rx_buffer[next] == '\n') {
-            tbuf[1] = '\n';
-            tlen = 2;
-        }
+}
+
+void kmbox_serial_print_stats(void)
+{
+    printf("Injection latency: %lu samples, avg %lu us, max %lu us, histogram",
+           (unsigned long)g_latency.count,
+           g_latency.count ? (unsigned long)(g_latency.total_us / g_latency.count) : 0UL,
+           (unsigned long)g_latency.max_us);
+    for (int i = 0; i < KMBOX_LATENCY_BUCKETS - 1; i++) {
+        printf(" <%u:%lu", KMBOX_LATENCY_BUCKET_BASE_US << i, (unsigned long)g_latency.histogram[i]);
     }
+    printf(" more:%lu\n", (unsigned long)g_latency.histogram[KMBOX_LATENCY_BUCKETS - 1]);
 
-    // Compute line length (exclude terminator)
-    size_t line_len = 0;
-    uint16_t scan = tail;
-    while (scan != found) { line_len++; scan = (scan + 1) & UART_RX_BUFFER_MASK; }
+    kmbox_movement_stats_t mv;
+    kmbox_get_movement_stats(&mv);
+    printf("Movement lost: x %lld, y %lld, wheel %lld (emitted x %lld, y %lld, %lu overflows)\n",
+           (long long)mv.lost_x, (long long)mv.lost_y, (long long)mv.lost_wheel,
+           (long long)mv.emitted_x, (long long)mv.emitted_y, (unsigned long)mv.overflows);
+}
 
-    // Truncate if necessary
-    if (line_len >= dst_size) line_len = dst_size - 1;
+// Baud rate switching (km.baud). The acknowledgement goes out at the old
+// rate, the switch happens once TX has drained, and the default rate is
+// restored if no command arrives at the new rate before the deadline.
+static uint32_t g_baud_pending = 0;
+static uint32_t g_baud_current = KMBOX_UART_BAUDRATE;
+static bool g_baud_confirming = false;
+static uint64_t g_baud_confirm_deadline_us = 0;
+static uint32_t g_baud_confirm_count = 0;
 
-    // Copy possibly wrapped data
-    uint16_t first_chunk = UART_RX_BUFFER_SIZE - (tail & UART_RX_BUFFER_MASK);
-    if (first_chunk > line_len) first_chunk = line_len;
-    memcpy(dst, (const void *)&uart_rx_buffer[tail & UART_RX_BUFFER_MASK], first_chunk);
-    if (line_len > first_chunk) {
-        memcpy(dst + first_chunk, (const void *)&uart_rx_buffer[0], line_len - first_chunk);
+static bool on_baud_request(uint32_t baud)
+{
+    // The UART needs at least 16 peripheral clocks per bit
+    if (baud > clock_get_hz(clk_peri) / 16) {
+        return false;
     }
-    dst[line_len] = '\0';
+    g_baud_pending = baud;
+    return true;
+}
 
-    // Advance tail past the line and its terminator
-    uint16_t new_tail = (found + tlen) & UART_RX_BUFFER_MASK;
-    // Update shared tail atomically (single word write is atomic on RP2040)
-    uart_rx_tail = new_tail;
+static void apply_baud_rate(uint32_t baud)
+{
+    kmbox_interface_set_baudrate(baud);
+    g_baud_current = baud;
+    kmbox_commands_set_baud_handler(on_baud_request, baud);
+}
 
-    if (out_len) *out_len = line_len;
-    if (term_len) *term_len = tlen;
-    if (term_buf && tlen > 0) { term_buf[0] = tbuf[0]; if (tlen == 2) term_buf[1] = tbuf[1]; }
-    return true;
+static void baud_task(uint64_t now_us)
+{
+    if (g_baud_pending != 0 && kmbox_interface_tx_idle()) {
+        uint32_t baud = g_baud_pending;
+        g_baud_pending = 0;
+        if (baud != g_baud_current) {
+            apply_baud_rate(baud);
+            printf("KMBox UART switched to %lu baud\n", (unsigned long)baud);
+            if (baud != KMBOX_UART_BAUDRATE) {
+                g_baud_confirming = true;
+                g_baud_confirm_deadline_us = now_us + (uint64_t)KMBOX_BAUD_CONFIRM_MS * 1000u;
+                g_baud_confirm_count = kmbox_get_command_count();
+            } else {
+                g_baud_confirming = false;
+            }
+        }
+        return;
+    }
+
+    if (g_baud_confirming) {
+        if (kmbox_get_command_count() != g_baud_confirm_count) {
+            // The controller is talking at the new rate
+            g_baud_confirming = false;
+        } else if (now_us >= g_baud_confirm_deadline_us) {
+            g_baud_confirming = false;
+            apply_baud_rate(KMBOX_UART_BAUDRATE);
+            printf("KMBox UART: no command at new baud rate, reverted to %d\n", KMBOX_UART_BAUDRATE);
+        }
+    }
+}
+
+// Output hook for the kmbox commands library: queue for DMA transmission
+static void on_serial_output(const char *data, size_t len)
+{
+    kmbox_interface_send((const uint8_t *)data, len);
 }
 
 // Initialize the serial handler
 void kmbox_serial_init(void)
 {
-    bool pio_ok = false;
-    printf("PIO UART disabled via KMBOX_ENABLE_PIO_UART - using hardware UART1 fallback\n");
+    // The command UART is driven by the shared transport layer: DMA ring
+    // reception with idle/line wakeup and a DMA TX queue for responses
+    kmbox_interface_config_t config = {
+        .transport_type = KMBOX_TRANSPORT_UART,
+        .config.uart = KMBOX_UART_DEFAULT_CONFIG,
+        .on_command_received = on_serial_data
+    };
+    if (!kmbox_interface_init(&config)) {
+        printf("KMBox serial handler: UART transport init failed\n");
+        return;
+    }
 
-    uart_init(KMBOX_UART, KMBOX_UART_BAUDRATE);
-    
-    // Set up GPIO pins for UART1
-    gpio_set_function(KMBOX_UART_TX_PIN, GPIO_FUNC_UART);
-    gpio_set_function(KMBOX_UART_RX_PIN, GPIO_FUNC_UART);
-    
-    // Enable UART FIFOs for better performance
-    uart_set_fifo_enabled(KMBOX_UART, true);
-    
-    // Set up UART RX interrupt for non-blocking reception
-    int uart_irq = (KMBOX_UART == uart0) ? UART0_IRQ : UART1_IRQ;
-    irq_set_exclusive_handler(uart_irq, on_uart_rx);
-    irq_set_enabled(uart_irq, true);
-    
-    // Enable UART RX interrupt
-    uart_set_irq_enables(KMBOX_UART, true, false);
-    // Initialize the kmbox commands module
+    // Initialize the kmbox commands module and send its responses back over
+    // the command UART instead of the debug stdio
     kmbox_commands_init();
+    kmbox_commands_set_output(on_serial_output);
+    kmbox_commands_set_baud_handler(on_baud_request, g_baud_current);
+    // km.trace() dumps the event trace on the debug UART for tools/trace_decode
+    kmbox_commands_set_trace_handler(trace_request_dump);
     
     printf("KMBox serial handler initialized on UART1 (TX: GPIO%d, RX: GPIO%d) @ %d baud\n",
            KMBOX_UART_TX_PIN, KMBOX_UART_RX_PIN, KMBOX_UART_BAUDRATE);
 }
 
 // Process any available serial input
-void kmbox_serial_task(void)
+void kmbox_serial_task(uint64_t now_us)
 {
-    // Get current time
-    uint32_t current_time_ms = to_ms_since_boot(get_absolute_time());
-    // Fast path: check for a full line and hand it to parser in one call
-    char linebuf[KMBOX_CMD_BUFFER_SIZE];
-    size_t line_len = 0;
-    char termbuf[2];
-    uint8_t termlen = 0;
-    while (ringbuf_peek_line_and_copy(linebuf, sizeof(linebuf), &line_len, termbuf, &termlen)) {
-        kmbox_process_serial_line(linebuf, line_len, termbuf, termlen, current_time_ms);
-    }
-
-    // Fallback: process any remaining single bytes (partial line building)
-    int c;
-    while ((c = uart_rx_getchar()) != -1) {
-        kmbox_process_serial_char((char)c, current_time_ms);
-    }
+    // Receive and transmit; completed lines and frames are handed to the
+    // parser through on_serial_data()
+    g_rx_time_us = now_us;
+    kmbox_interface_process(now_us);
+    baud_task(now_us);
     
     // Update button states (handles timing for releases)
-    kmbox_update_states(current_time_ms);
+    kmbox_update_states(now_us);
+
+    // Injection scheduler: emit commanded movement and button changes on the
+    // next free HID IN slot instead of waiting for physical mouse traffic to
+    // carry them out. If the endpoint is still busy or the SOF send window
+    // has not opened yet, the report stays pending and goes out on a later
+    // pass, i.e. within one USB frame. This also submits physical input held
+    // for the send window.
+    if (kmbox_has_pending_report()) {
+        kmbox_send_mouse_report(now_us);
+    }
 }
 
 // Send mouse report with kmbox button states
-bool kmbox_send_mouse_report(void)
+bool kmbox_send_mouse_report(uint64_t now_us)
 {
-    // Check if USB is ready
-    if (!tud_hid_ready()) {
-        return false;
-    }
-    
-    // Get the report data from kmbox commands
-    uint8_t buttons;
-    int8_t x, y, wheel, pan;
-    kmbox_get_mouse_report(&buttons, &x, &y, &wheel, &pan);
-    
-    // Send the report using TinyUSB
-    bool success = tud_hid_mouse_report(REPORT_ID_MOUSE, buttons, x, y, wheel, pan);
+    // Goes through the coalescing stage in usb_hid.c, which only drains the
+    // accumulators once the endpoint can take the report
+    bool success = usb_hid_flush_mouse_report(now_us);
     
     if (success) {
         // Trigger rainbow effect periodically when KMBox commands are processed
@@ -204,3 +212,4 @@ bool kmbox_send_mouse_report(void)
     
     return success;
 }
+
@@ -12,10 +12,37 @@
 // Initialize the serial handler
 void kmbox_serial_init(void);
 
-// Process any available serial input (call this in main loop)
-void kmbox_serial_task(void);
+// Process any available serial input (call this in main loop with the
+// loop's time_us_64() sample)
+void kmbox_serial_task(uint64_t now_us);
 
-// Send mouse report with kmbox button states
-bool kmbox_send_mouse_report(void);
+// Send mouse report with kmbox button states. Called by kmbox_serial_task()
+// whenever kmbox_has_pending_report() is set; returns false if the HID
+// endpoint is busy and the report has to wait for the next frame.
+bool kmbox_send_mouse_report(uint64_t now_us);
+
+// Injection latency: time from a km.* command (or binary frame) producing
+// movement or a button change until the first USB report carrying it was
+// accepted by the device stack. Bucket i counts latencies below
+// KMBOX_LATENCY_BUCKET_BASE_US << i; the last bucket counts the rest.
+#define KMBOX_LATENCY_BUCKETS           8
+#define KMBOX_LATENCY_BUCKET_BASE_US    125
+
+typedef struct {
+    uint32_t count;
+    uint64_t total_us;
+    uint32_t max_us;
+    uint32_t histogram[KMBOX_LATENCY_BUCKETS];
+} kmbox_latency_stats_t;
+
+// Call after a report built from kmbox_get_mouse_report() was accepted by
+// tud_hid_mouse_report(), from any path (command injection or passthrough),
+// with the time_us_64() sample the report was sent at
+void kmbox_serial_report_sent(uint64_t now_us);
+
+void kmbox_serial_get_latency_stats(kmbox_latency_stats_t *stats);
+
+// Print the injection latency histogram and movement accounting (status report)
+void kmbox_serial_print_stats(void);
 
 #endif // KMBOX_SERIAL_HANDLER_H
\ No newline at end of file
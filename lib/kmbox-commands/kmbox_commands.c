@@ -4,6 +4,7 @@
  */
 
 #include "kmbox_commands.h"
+#include "kmbox_protocol.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -12,10 +13,15 @@
 // Constants
 //--------------------------------------------------------------------+
 
-#define RELEASE_MIN_TIME_MS 125
-#define RELEASE_MAX_TIME_MS 175
-#define CLICK_PRESS_MIN_TIME_MS 75
-#define CLICK_PRESS_MAX_TIME_MS 125
+#define RELEASE_MIN_TIME_US 125000
+#define RELEASE_MAX_TIME_US 175000
+#define CLICK_PRESS_MIN_TIME_US 75000
+#define CLICK_PRESS_MAX_TIME_US 125000
+
+// Explicit click press durations: km.click(button, ms) and the binary CLICK
+// opcode's optional microsecond argument
+#define CLICK_PRESS_LIMIT_MS 10000
+#define CLICK_PRESS_LIMIT_US (CLICK_PRESS_LIMIT_MS * 1000u)
 
 // Button name strings
 static const char* button_names[KMBOX_BUTTON_COUNT] = {
@@ -26,24 +32,14 @@ static const char* button_names[KMBOX_BUTTON_COUNT] = {
     "side2"
 };
 
-// Button bit masks for HID report - now handled inline for performance
-// 0x01, 0x02, 0x04, 0x08, 0x10 for LEFT, RIGHT, MIDDLE, SIDE1, SIDE2
-
-// Lock button name strings (short form for commands)
-static const char* lock_button_names[KMBOX_BUTTON_COUNT] = {
-    "ml",    // Left button
-    "mr",    // Right button
-    "mm",    // Middle button
-    "ms1",   // Side button 1
-    "ms2"    // Side button 2
-};
-
 //--------------------------------------------------------------------+
 // Static Variables
 //--------------------------------------------------------------------+
 
 static kmbox_state_t g_kmbox_state = {0};
 static kmbox_parser_t g_parser = {0};
+static kmbox_bin_decoder_t g_bin_decoder = {0};
+static kmbox_movement_stats_t g_movement_stats = {0};
 
 //--------------------------------------------------------------------+
 // Random Number Generation
@@ -57,11 +53,12 @@ static uint32_t get_random_release_time(void)
     // Update seed
     g_rand_seed = (g_rand_seed * 1103515245 + 12345) & 0x7FFFFFFF;
     
-    // Generate random value between RELEASE_MIN_TIME_MS and RELEASE_MAX_TIME_MS
-    uint32_t range = RELEASE_MAX_TIME_MS - RELEASE_MIN_TIME_MS + 1;
-    uint32_t random_offset = (g_rand_seed >> 16) % range;
+    // Generate random value between RELEASE_MIN_TIME_US and RELEASE_MAX_TIME_US.
+    // The range needs more than the top 15 bits of the seed.
+    uint32_t range = RELEASE_MAX_TIME_US - RELEASE_MIN_TIME_US + 1;
+    uint32_t random_offset = (g_rand_seed >> 4) % range;
     
-    return RELEASE_MIN_TIME_MS + random_offset;
+    return RELEASE_MIN_TIME_US + random_offset;
 }
 
 static uint32_t get_random_click_press_time(void)
@@ -69,81 +66,99 @@ static uint32_t get_random_click_press_time(void)
     // Update seed
     g_rand_seed = (g_rand_seed * 1103515245 + 12345) & 0x7FFFFFFF;
     
-    // Generate random value between CLICK_PRESS_MIN_TIME_MS and CLICK_PRESS_MAX_TIME_MS
-    uint32_t range = CLICK_PRESS_MAX_TIME_MS - CLICK_PRESS_MIN_TIME_MS + 1;
-    uint32_t random_offset = (g_rand_seed >> 16) % range;
+    // Generate random value between CLICK_PRESS_MIN_TIME_US and CLICK_PRESS_MAX_TIME_US
+    uint32_t range = CLICK_PRESS_MAX_TIME_US - CLICK_PRESS_MIN_TIME_US + 1;
+    uint32_t random_offset = (g_rand_seed >> 4) % range;
     
-    return CLICK_PRESS_MIN_TIME_MS + random_offset;
+    return CLICK_PRESS_MIN_TIME_US + random_offset;
 }
 
 //--------------------------------------------------------------------+
 // Button Management
 //--------------------------------------------------------------------+
 
-static kmbox_button_t parse_button_name(const char* name)
+_Static_assert(KMBOX_MAX_BUTTONS >= KMBOX_BUTTON_COUNT, "KMBOX_MAX_BUTTONS must cover the named buttons");
+
+#define BUTTON_BIT(button) ((kmbox_buttons_t)(1u << (button)))
+
+// Deadline queue: at most one entry per button, kept sorted so expiry only
+// has to look at the head
+
+static void deadline_cancel(unsigned button)
 {
-    for (int i = 0; i < KMBOX_BUTTON_COUNT; i++) {
-        if (strcmp(name, button_names[i]) == 0) {
-            return (kmbox_button_t)i;
+    kmbox_state_t* s = &g_kmbox_state;
+    for (uint8_t i = 0; i < s->deadline_count; i++) {
+        if (s->deadlines[i].button == button) {
+            memmove(&s->deadlines[i], &s->deadlines[i + 1],
+                    (size_t)(s->deadline_count - i - 1) * sizeof(s->deadlines[0]));
+            s->deadline_count--;
+            return;
         }
     }
-    return KMBOX_BUTTON_COUNT; // Invalid button
 }
 
-static kmbox_button_t parse_lock_button_name(const char* name)
+static void deadline_schedule(unsigned button, uint64_t deadline)
 {
-    for (int i = 0; i < KMBOX_BUTTON_COUNT; i++) {
-        if (strcmp(name, lock_button_names[i]) == 0) {
-            return (kmbox_button_t)i;
-        }
+    kmbox_state_t* s = &g_kmbox_state;
+    deadline_cancel(button);
+    
+    uint8_t i = s->deadline_count;
+    while (i > 0 && s->deadlines[i - 1].deadline > deadline) {
+        s->deadlines[i] = s->deadlines[i - 1];
+        i--;
     }
-    return KMBOX_BUTTON_COUNT; // Invalid button
+    s->deadlines[i].deadline = deadline;
+    s->deadlines[i].button = (uint8_t)button;
+    s->deadline_count++;
 }
 
-static void set_button_state(kmbox_button_t button, bool pressed, uint32_t current_time_ms)
+static void set_button_state(kmbox_button_t button, bool pressed, uint64_t current_time_us)
 {
     if (button >= KMBOX_BUTTON_COUNT) {
         return;
     }
     
-    button_state_t* btn_state = &g_kmbox_state.buttons[button];
+    kmbox_state_t* s = &g_kmbox_state;
+    const kmbox_buttons_t bit = BUTTON_BIT(button);
     
     if (pressed) {
-        // Force button press
-        btn_state->is_pressed = true;
-        btn_state->is_forced = true;
-        btn_state->release_time = 0; // Indefinite press
-        btn_state->is_clicking = false; // Cancel any ongoing click
-    } else {
+        // Force button press, indefinitely; cancels any click or pending release
+        s->pressed |= bit;
+        s->forced |= bit;
+        s->clicking &= (kmbox_buttons_t)~bit;
+        s->click_releasing &= (kmbox_buttons_t)~bit;
+        s->release_pending &= (kmbox_buttons_t)~bit;
+        deadline_cancel(button);
+    } else if (s->forced & s->pressed & bit) {
         // Force button release for random duration
-        if (btn_state->is_forced && btn_state->is_pressed) {
-            btn_state->is_pressed = false;
-            btn_state->release_time = current_time_ms + get_random_release_time();
-            btn_state->is_clicking = false; // Cancel any ongoing click
-        }
+        s->pressed &= (kmbox_buttons_t)~bit;
+        s->clicking &= (kmbox_buttons_t)~bit; // Cancel any ongoing click
+        s->click_releasing &= (kmbox_buttons_t)~bit;
+        s->release_pending |= bit;
+        deadline_schedule(button, current_time_us + get_random_release_time());
     }
 }
 
-static void start_button_click(kmbox_button_t button, uint32_t current_time_ms)
+// press_us = 0 picks a random press duration
+static void start_button_click(kmbox_button_t button, uint32_t press_us, uint64_t current_time_us)
 {
     if (button >= KMBOX_BUTTON_COUNT) {
         return;
     }
     
-    button_state_t* btn_state = &g_kmbox_state.buttons[button];
-    
-    // Start click sequence
-    btn_state->is_clicking = true;
-    btn_state->is_pressed = true;
-    btn_state->is_forced = true;
+    kmbox_state_t* s = &g_kmbox_state;
+    const kmbox_buttons_t bit = BUTTON_BIT(button);
     
-    // Calculate click timing
-    uint32_t press_duration = get_random_click_press_time();
-    uint32_t release_duration = get_random_release_time();
+    // Start click sequence: press phase first, the release phase is
+    // scheduled when it ends
+    s->pressed |= bit;
+    s->forced |= bit;
+    s->clicking |= bit;
+    s->click_releasing &= (kmbox_buttons_t)~bit;
+    s->release_pending &= (kmbox_buttons_t)~bit;
     
-    btn_state->click_release_start = current_time_ms + press_duration;
-    btn_state->click_end_time = btn_state->click_release_start + release_duration;
-    btn_state->release_time = 0; // Not used during click
+    deadline_schedule(button, current_time_us + (press_us ? press_us : get_random_click_press_time()));
+    s->click_release_us[button] = get_random_release_time();
 }
 
 static void set_button_lock(kmbox_button_t button, bool locked)
@@ -152,7 +167,15 @@ static void set_button_lock(kmbox_button_t button, bool locked)
         return;
     }
     
-    g_kmbox_state.buttons[button].is_locked = locked;
+    kmbox_state_t* s = &g_kmbox_state;
+    if (locked) {
+        s->locked |= BUTTON_BIT(button);
+    } else {
+        // An unlocked button follows the physical mouse again unless forced
+        s->locked &= (kmbox_buttons_t)~BUTTON_BIT(button);
+        const kmbox_buttons_t hold = s->forced | s->locked;
+        s->pressed = (kmbox_buttons_t)((s->pressed & hold) | (s->physical_buttons & ~hold));
+    }
 }
 
 static bool get_button_lock(kmbox_button_t button)
@@ -161,382 +184,947 @@ static bool get_button_lock(kmbox_button_t button)
         return false;
     }
     
-    return g_kmbox_state.buttons[button].is_locked;
+    return (g_kmbox_state.locked & BUTTON_BIT(button)) != 0;
 }
 
-//--------------------------------------------------------------------+
-// Button State Callback
-//--------------------------------------------------------------------+
-
-static void send_button_state_callback(uint8_t button_state)
+// km.buttons() callback byte: the low eight buttons of the output state
+static inline uint8_t get_button_byte(void)
 {
-    // Send the callback in the format: km.[button_state]\r\n
-    // where button_state is the raw character representing the bitmap
-    printf("km.%c\r\n", button_state);
+    return (uint8_t)g_kmbox_state.pressed;
 }
 
 //--------------------------------------------------------------------+
-// Command Parsing
+// Movement Accumulators
 //--------------------------------------------------------------------+
 
-static void parse_command(const char* cmd, uint32_t current_time_ms)
+// Add to an accumulator, saturating at +/-INT32_MAX (kept symmetric so the
+// drain code can negate any value)
+static int32_t accumulate(int32_t acc, int32_t delta)
 {
-    // Fast path: check command prefix first
-    if (cmd[0] != 'k' || cmd[1] != 'm' || cmd[2] != '.') {
-        return;
+    int64_t sum = (int64_t)acc + delta;
+    if (sum > INT32_MAX) {
+        g_movement_stats.overflows++;
+        return INT32_MAX;
     }
-    
-    // Skip "km." prefix
-    const char* cmd_ptr = cmd + 3;
-    
-    // Expected formats:
-    // button_name(state) - Example: left(1) or side2(0)
-    // click(button_num) - Example: click(0) for left button
-    // buttons() - Get callback state
-    // buttons(state) - Enable (1) or disable (0) callback
-    // move(x, y) - Move mouse by x,y pixels
-    // wheel(amount) - Scroll wheel up (+) or down (-)
-    // lock_mx() - Get X axis lock state
-    // lock_mx(state) - Set X axis lock (1=locked, 0=unlocked)
-    // lock_my() - Get Y axis lock state
-    // lock_my(state) - Set Y axis lock (1=locked, 0=unlocked)
-    
-    // Check if command starts with "km."
-    if (strncmp(cmd, "km.", 3) != 0) {
-        return;
+    if (sum < -INT32_MAX) {
+        g_movement_stats.overflows++;
+        return -INT32_MAX;
+    }
+    return (int32_t)sum;
+}
+
+// Add X/Y movement to a pair of accumulators, respecting the axis locks
+static void add_movement(int32_t* acc_x, int32_t* acc_y, int16_t x, int16_t y)
+{
+    if (!g_kmbox_state.lock_mx) {
+        *acc_x = accumulate(*acc_x, x);
+        g_movement_stats.accepted_x += x;
     }
     
-    // Echo the command back with the original line terminator
-    printf("%s%.*s", cmd, g_parser.terminator_len, g_parser.command_terminator);
+    if (!g_kmbox_state.lock_my) {
+        *acc_y = accumulate(*acc_y, y);
+        g_movement_stats.accepted_y += y;
+    }
+}
+
+// Movement from paced moves, kept apart from physical movement so the drain
+// policy only applies to what was commanded
+static void add_paced_movement(int16_t x, int16_t y)
+{
+    add_movement(&g_kmbox_state.cmd_x_accumulator, &g_kmbox_state.cmd_y_accumulator, x, y);
+}
+
+// Movement from km.move() and the binary MOVE opcodes. In paced mode each
+// command (re)starts a window over which the whole backlog is spread.
+static void add_commanded_movement(int16_t x, int16_t y)
+{
+    add_paced_movement(x, y);
+    if (g_kmbox_state.drain_mode == KMBOX_DRAIN_PACED) {
+        g_kmbox_state.pace_reports_left = g_kmbox_state.drain_param;
+    }
+}
+
+// Largest value one report axis can carry in the selected report format
+static inline int32_t report_axis_max(void)
+{
+    return g_kmbox_state.wide_reports ? KMBOX_WIDE_AXIS_MAX : INT8_MAX;
+}
+
+static inline int32_t report_axis_min(void)
+{
+    return g_kmbox_state.wide_reports ? -KMBOX_WIDE_AXIS_MAX : INT8_MIN;
+}
+
+// Take as much of an accumulator as one report axis can carry; the
+// remainder is carried over to the next report
+static int16_t drain_full(int32_t* acc)
+{
+    int32_t step = *acc;
+    if (step > report_axis_max()) {
+        step = report_axis_max();
+    } else if (step < report_axis_min()) {
+        step = report_axis_min();
+    }
+    *acc -= step;
+    return (int16_t)step;
+}
+
+// Take the share of one X/Y axis that goes into the next report. Physical
+// movement drains as far as the report allows; commanded movement is
+// handed out under the drain policy within the range that is left.
+static int16_t drain_axis(int32_t* cmd, int32_t* phys)
+{
+    const kmbox_state_t* s = &g_kmbox_state;
+    const int16_t physical = drain_full(phys);
+    int32_t step = *cmd;
+    int32_t limit_hi = report_axis_max() - physical;
+    int32_t limit_lo = report_axis_min() - physical;
     
-    // Check if this is a move command
-    if (strncmp(cmd + 3, "move(", 5) == 0) {
-        // Parse move command
-        const char* args_start = cmd + 8; // Skip "km.move("
-        const char* comma_pos = strchr(args_start, ',');
-        if (!comma_pos) {
-            return;
+    if (s->drain_mode == KMBOX_DRAIN_PACED && s->pace_reports_left > 1) {
+        // Round to nearest so the window's reports differ by at most one
+        // count; the last report of the window takes the remainder
+        const int64_t n = s->pace_reports_left;
+        step = (int32_t)((step >= 0) ? ((int64_t)step + n / 2) / n : -((-(int64_t)step + n / 2) / n));
+    } else if (s->drain_mode == KMBOX_DRAIN_CAPPED) {
+        if (limit_hi > s->drain_param) {
+            limit_hi = s->drain_param;
         }
-        
-        // Parse X value
-        char x_str[16];
-        size_t x_len = comma_pos - args_start;
-        if (x_len >= sizeof(x_str)) {
-            return;
+        if (limit_lo < -(int32_t)s->drain_param) {
+            limit_lo = -(int32_t)s->drain_param;
         }
-        strncpy(x_str, args_start, x_len);
-        x_str[x_len] = '\0';
-        
-        // Skip whitespace after comma
-        const char* y_start = comma_pos + 1;
-        while (*y_start == ' ' || *y_start == '\t') {
-            y_start++;
-        }
-        
-        // Find closing parenthesis
-        const char* paren_end = strchr(y_start, ')');
-        if (!paren_end) {
-            return;
-        }
-        
-        // Parse Y value
-        char y_str[16];
-        size_t y_len = paren_end - y_start;
-        if (y_len >= sizeof(y_str)) {
-            return;
-        }
-        strncpy(y_str, y_start, y_len);
-        y_str[y_len] = '\0';
-        
-        // Convert to integers
-        int x_amount = atoi(x_str);
-        int y_amount = atoi(y_str);
-        
-        // Add movement
-        kmbox_add_mouse_movement(x_amount, y_amount);
-        
-        // Send the prompt
-        printf(">>> ");
-        return;
     }
     
-    // Check if this is a wheel command
-    if (strncmp(cmd + 3, "wheel(", 6) == 0) {
-        // Parse wheel command
-        const char* num_start = cmd + 9; // Skip "km.wheel("
-        char* num_end;
-        long wheel_amount = strtol(num_start, &num_end, 10);
-        
-        // Validate closing parenthesis
-        if (*num_end != ')') {
-            return;
-        }
-        
-        // Add wheel movement
-        kmbox_add_wheel_movement((int8_t)wheel_amount);
-        
-        // Send the prompt
-        printf(">>> ");
-        return;
+    if (step > limit_hi) {
+        step = limit_hi;
+    } else if (step < limit_lo) {
+        step = limit_lo;
     }
+    *cmd -= step;
+    return (int16_t)(physical + step);
+}
+
+// Add the part of the paced moves that is due by now. The target for the
+// move in progress is recomputed from its total each time, so truncation
+// never accumulates and the final call delivers the exact remainder.
+static void run_paced_moves(uint64_t current_time_us)
+{
+    kmbox_state_t* s = &g_kmbox_state;
     
-    // Check if this is a lock_mx command
-    if (strncmp(cmd + 3, "lock_mx(", 8) == 0) {
-        // Parse lock_mx command
-        const char* arg_start = cmd + 11; // Skip "km.lock_mx("
-        const char* paren_end = strchr(arg_start, ')');
+    while (s->paced_count > 0 && current_time_us >= s->paced_start_us) {
+        const kmbox_paced_move_t* move = &s->paced_moves[s->paced_head];
+        const uint64_t elapsed = current_time_us - s->paced_start_us;
+        const bool done = elapsed >= move->duration_us;
         
-        if (!paren_end) {
-            return;
+        int16_t due_x = move->x;
+        int16_t due_y = move->y;
+        if (!done) {
+            due_x = (int16_t)((int64_t)move->x * (int64_t)elapsed / move->duration_us);
+            due_y = (int16_t)((int64_t)move->y * (int64_t)elapsed / move->duration_us);
         }
-        
-        // Check if there's an argument
-        size_t arg_len = paren_end - arg_start;
-        if (arg_len == 0) {
-            // No argument - return lock state with result
-            printf("%d\r\n>>> ", g_kmbox_state.lock_mx ? 1 : 0);
-            return;
+        if (due_x != s->paced_sent_x || due_y != s->paced_sent_y) {
+            add_paced_movement((int16_t)(due_x - s->paced_sent_x), (int16_t)(due_y - s->paced_sent_y));
+            s->paced_sent_x = due_x;
+            s->paced_sent_y = due_y;
         }
-        
-        // Extract state value
-        char state_str[8];
-        if (arg_len >= sizeof(state_str)) {
+        if (!done) {
             return;
         }
         
-        strncpy(state_str, arg_start, arg_len);
-        state_str[arg_len] = '\0';
-        
-        // Parse state
-        int state = atoi(state_str);
-        if (state != 0 && state != 1) {
-            return; // Invalid state
+        // The next move starts where this one ended
+        s->paced_start_us += move->duration_us;
+        s->paced_head = (uint8_t)((s->paced_head + 1) % KMBOX_PACED_MOVE_QUEUE);
+        s->paced_count--;
+        s->paced_sent_x = 0;
+        s->paced_sent_y = 0;
+    }
+}
+
+//--------------------------------------------------------------------+
+// Response Output
+//--------------------------------------------------------------------+
+
+// Responses are assembled here and handed to the output hook in one piece
+// per command, so the transport sees a single write instead of several
+// small formatted ones
+#define KMBOX_RESP_BUFFER_SIZE  (KMBOX_CMD_BUFFER_SIZE + 32)
+
+static char g_resp[KMBOX_RESP_BUFFER_SIZE];
+static uint8_t g_resp_len = 0;
+
+static void default_output(const char* data, size_t len)
+{
+    fwrite(data, 1, len, stdout);
+}
+
+static kmbox_output_fn_t g_output = default_output;
+static kmbox_echo_mode_t g_echo_mode = KMBOX_ECHO_FULL;
+
+// Baud rate change hook (NULL if the transport cannot change rate)
+static kmbox_baud_fn_t g_baud_handler = NULL;
+static uint32_t g_baud_rate = 0;
+
+// Event trace dump hook (NULL if the firmware has no trace)
+static kmbox_trace_fn_t g_trace_handler = NULL;
+
+// Commands executed (text and binary), used by transports to confirm a link
+static uint32_t g_command_count = 0;
+
+static void resp_put(const char* data, size_t len)
+{
+    if (len > (size_t)(KMBOX_RESP_BUFFER_SIZE - g_resp_len)) {
+        len = KMBOX_RESP_BUFFER_SIZE - g_resp_len;
+    }
+    memcpy(&g_resp[g_resp_len], data, len);
+    g_resp_len += (uint8_t)len;
+}
+
+static void resp_put_int(int32_t value)
+{
+    char digits[11];
+    uint8_t n = 0;
+    uint32_t v = (value < 0) ? (uint32_t)0 - (uint32_t)value : (uint32_t)value;
+
+    do {
+        digits[sizeof(digits) - 1 - n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v != 0 && n < sizeof(digits) - 1);
+    if (value < 0) {
+        digits[sizeof(digits) - 1 - n++] = '-';
+    }
+    resp_put(&digits[sizeof(digits) - n], n);
+}
+
+static void resp_flush(void)
+{
+    if (g_resp_len > 0) {
+        g_output(g_resp, g_resp_len);
+        g_resp_len = 0;
+    }
+}
+
+// Command accepted without a result value
+static void respond_ok(void)
+{
+    switch (g_echo_mode) {
+    case KMBOX_ECHO_FULL:
+    case KMBOX_ECHO_PROMPT:
+        resp_put(">>> ", 4);
+        break;
+    case KMBOX_ECHO_ACK:
+        resp_put("1\r\n", 3);
+        break;
+    default:
+        break;
+    }
+}
+
+// Command accepted with a result value. Values are sent in every mode,
+// otherwise queries would be useless in silent mode.
+static void respond_value(int32_t value)
+{
+    resp_put_int(value);
+    resp_put("\r\n", 2);
+    if (g_echo_mode == KMBOX_ECHO_FULL || g_echo_mode == KMBOX_ECHO_PROMPT) {
+        resp_put(">>> ", 4);
+    }
+}
+
+// Command understood but refused (paced move queue full, baud rate or
+// drain mode not accepted). Sent in every mode, like values, so a refusal
+// is never taken for success.
+static void respond_error(void)
+{
+    resp_put(KMBOX_RESP_ERROR "\r\n", sizeof(KMBOX_RESP_ERROR) + 1);
+    if (g_echo_mode == KMBOX_ECHO_FULL || g_echo_mode == KMBOX_ECHO_PROMPT) {
+        resp_put(">>> ", 4);
+    }
+}
+
+// Ask the transport to switch rate. The response to the requesting command
+// is still sent at the old rate; the transport switches once it has drained.
+static bool request_baud_rate(uint32_t baud)
+{
+    if (!g_baud_handler || !g_baud_handler(baud)) {
+        return false;
+    }
+    g_baud_rate = baud;
+    return true;
+}
+
+//--------------------------------------------------------------------+
+// Button State Callback
+//--------------------------------------------------------------------+
+
+static void send_button_state_callback(uint8_t button_state)
+{
+    // Send the callback in the format: km.[button_state]\r\n
+    // where button_state is the raw character representing the bitmap
+    const char msg[6] = { 'k', 'm', '.', (char)button_state, '\r', '\n' };
+    g_output(msg, sizeof(msg));
+}
+
+//--------------------------------------------------------------------+
+// Command Table
+//--------------------------------------------------------------------+
+
+// Expected formats (after the "km." prefix):
+// button_name(state) - Example: left(1) or side2(0)
+// click(button_num) - Example: click(0) for left button
+// click(button_num, ms) - Click with an explicit press duration
+// buttons() - Get callback state
+// buttons(state) - Enable (1) or disable (0) callback
+// move(x, y) - Move mouse by x,y pixels
+// move(x, y, ms) - Move by x,y spread evenly over ms milliseconds
+// cancel() - Drop paced moves in progress or queued, returns the count
+// wheel(amount) - Scroll wheel up (+) or down (-)
+// lock_mx() - Get X axis lock state
+// lock_mx(state) - Set X axis lock (1=locked, 0=unlocked)
+// lock_my() - Get Y axis lock state
+// lock_my(state) - Set Y axis lock (1=locked, 0=unlocked)
+// lock_<ml|mr|mm|ms1|ms2>() / (state) - Get/set button lock
+// echo() / echo(mode) - Get/set the response mode (see kmbox_echo_mode_t)
+// baud() / baud(rate) - Get/switch the transport baud rate
+// trace() - Dump the event trace, returns the number of records
+// drain() / drain(mode) / drain(mode, param) - Get/set the movement drain
+//   policy (see kmbox_drain_mode_t)
+
+#define KMBOX_CMD_MAX_ARGS      3
+#define KMBOX_CMD_NAME_MAX      8
+#define KMBOX_CMD_SLOTS         64  // Must be a power of two
+
+// Perfect hash over (length, first char, last char) of the command name.
+// Collision-free for the table below; kmbox_commands_init() verifies this
+// when building the slot table, so extending the table cannot silently
+// shadow an existing command.
+#define KMBOX_CMD_HASH(len, first, last) \
+    (((unsigned)(len) + 2u * (uint8_t)(first) + 3u * (uint8_t)(last)) & (KMBOX_CMD_SLOTS - 1))
+
+// Typed argument descriptors, validated before the handler runs
+typedef enum {
+    KMBOX_ARG_INT16 = 0,  // Signed value clamped to int16_t
+    KMBOX_ARG_STATE,      // 0 or 1, anything else rejects the command
+    KMBOX_ARG_BUTTON,     // Button index below KMBOX_BUTTON_COUNT
+    KMBOX_ARG_ECHO_MODE,  // kmbox_echo_mode_t value
+    KMBOX_ARG_BAUD,       // Baud rate within KMBOX_BAUD_MIN..KMBOX_BAUD_MAX
+    KMBOX_ARG_DURATION_MS, // 1..CLICK_PRESS_LIMIT_MS
+    KMBOX_ARG_DRAIN_MODE, // kmbox_drain_mode_t value
+    KMBOX_ARG_DRAIN_PARAM, // 1..KMBOX_DRAIN_PARAM_MAX, checked against the mode by the handler
+    KMBOX_ARG_MOVE_MS     // 1..KMBOX_PACED_MOVE_MAX_MS
+} kmbox_arg_type_t;
+
+typedef struct kmbox_cmd_desc kmbox_cmd_desc_t;
+
+typedef void (*kmbox_cmd_handler_t)(const kmbox_cmd_desc_t* cmd, const int32_t* args,
+                                    uint8_t argc, uint64_t current_time_us);
+
+struct kmbox_cmd_desc {
+    const char* name;
+    uint8_t name_len;
+    uint8_t param;       // Button index or axis for handlers shared by several commands
+    uint8_t min_args;
+    uint8_t max_args;
+    uint8_t arg_types[KMBOX_CMD_MAX_ARGS];
+    kmbox_cmd_handler_t handler;
+};
+
+static void cmd_move(const kmbox_cmd_desc_t* cmd, const int32_t* args, uint8_t argc, uint64_t current_time_us)
+{
+    (void)cmd;
+    if (argc > 2) {
+        // Paced move; rejected while the queue is full
+        if (kmbox_queue_paced_move((int16_t)args[0], (int16_t)args[1],
+                                   (uint32_t)args[2] * 1000u, current_time_us)) {
+            respond_ok();
+        } else {
+            respond_error();
         }
-        
-        // Set lock state
-        g_kmbox_state.lock_mx = (state == 1);
-        
-        // Send the prompt
-        printf(">>> ");
         return;
     }
-    
-    // Check if this is a lock_my command
-    if (strncmp(cmd + 3, "lock_my(", 8) == 0) {
-        // Parse lock_my command
-        const char* arg_start = cmd + 11; // Skip "km.lock_my("
-        const char* paren_end = strchr(arg_start, ')');
-        
-        if (!paren_end) {
-            return;
+    add_commanded_movement((int16_t)args[0], (int16_t)args[1]);
+    respond_ok();
+}
+
+static void cmd_cancel(const kmbox_cmd_desc_t* cmd, const int32_t* args, uint8_t argc, uint64_t current_time_us)
+{
+    (void)cmd; (void)args; (void)argc; (void)current_time_us;
+    respond_value(kmbox_cancel_paced_moves());
+}
+
+static void cmd_wheel(const kmbox_cmd_desc_t* cmd, const int32_t* args, uint8_t argc, uint64_t current_time_us)
+{
+    (void)cmd; (void)argc; (void)current_time_us;
+    kmbox_add_wheel_movement((int16_t)args[0]);
+    respond_ok();
+}
+
+static void cmd_click(const kmbox_cmd_desc_t* cmd, const int32_t* args, uint8_t argc, uint64_t current_time_us)
+{
+    (void)cmd;
+    uint32_t press_us = (argc > 1) ? (uint32_t)args[1] * 1000u : 0;
+    start_button_click((kmbox_button_t)args[0], press_us, current_time_us);
+    respond_ok();
+}
+
+static void cmd_buttons(const kmbox_cmd_desc_t* cmd, const int32_t* args, uint8_t argc, uint64_t current_time_us)
+{
+    (void)cmd; (void)current_time_us;
+    if (argc == 0) {
+        // No argument - return callback state with result
+        respond_value(g_kmbox_state.button_callback_enabled ? 1 : 0);
+        return;
+    }
+    g_kmbox_state.button_callback_enabled = (args[0] == 1);
+    respond_ok();
+}
+
+static void cmd_lock_axis(const kmbox_cmd_desc_t* cmd, const int32_t* args, uint8_t argc, uint64_t current_time_us)
+{
+    (void)current_time_us;
+    bool* lock = (cmd->param == 0) ? &g_kmbox_state.lock_mx : &g_kmbox_state.lock_my;
+    if (argc == 0) {
+        // No argument - return lock state with result
+        respond_value(*lock ? 1 : 0);
+        return;
+    }
+    *lock = (args[0] == 1);
+    respond_ok();
+}
+
+static void cmd_lock_button(const kmbox_cmd_desc_t* cmd, const int32_t* args, uint8_t argc, uint64_t current_time_us)
+{
+    (void)current_time_us;
+    if (argc == 0) {
+        // No argument - return lock state with result
+        respond_value(get_button_lock((kmbox_button_t)cmd->param) ? 1 : 0);
+        return;
+    }
+    set_button_lock((kmbox_button_t)cmd->param, args[0] == 1);
+    respond_ok();
+}
+
+static void cmd_button(const kmbox_cmd_desc_t* cmd, const int32_t* args, uint8_t argc, uint64_t current_time_us)
+{
+    // An empty argument list releases the button, as the original parser did
+    bool pressed = (argc > 0 && args[0] == 1);
+    set_button_state((kmbox_button_t)cmd->param, pressed, current_time_us);
+
+    // Send result (1 for button press/release commands)
+    respond_value(1);
+}
+
+static void cmd_baud(const kmbox_cmd_desc_t* cmd, const int32_t* args, uint8_t argc, uint64_t current_time_us)
+{
+    (void)cmd; (void)current_time_us;
+    if (argc == 0) {
+        respond_value((int32_t)g_baud_rate);
+        return;
+    }
+    if (request_baud_rate((uint32_t)args[0])) {
+        respond_ok();
+    } else {
+        respond_error();
+    }
+}
+
+static void cmd_trace(const kmbox_cmd_desc_t* cmd, const int32_t* args, uint8_t argc, uint64_t current_time_us)
+{
+    (void)cmd; (void)args; (void)argc; (void)current_time_us;
+    if (g_trace_handler) {
+        respond_value((int32_t)g_trace_handler());
+    } else {
+        respond_error();
+    }
+}
+
+static void cmd_drain(const kmbox_cmd_desc_t* cmd, const int32_t* args, uint8_t argc, uint64_t current_time_us)
+{
+    (void)cmd; (void)current_time_us;
+    if (argc == 0) {
+        respond_value(g_kmbox_state.drain_mode);
+        return;
+    }
+    if (kmbox_set_drain_mode((kmbox_drain_mode_t)args[0], (argc > 1) ? (uint16_t)args[1] : 0)) {
+        respond_ok();
+    } else {
+        respond_error();
+    }
+}
+
+static void cmd_echo(const kmbox_cmd_desc_t* cmd, const int32_t* args, uint8_t argc, uint64_t current_time_us)
+{
+    (void)cmd; (void)current_time_us;
+    if (argc == 0) {
+        respond_value(g_echo_mode);
+        return;
+    }
+    // The new mode already applies to this command's response
+    g_echo_mode = (kmbox_echo_mode_t)args[0];
+    respond_ok();
+}
+
+#define KMBOX_CMD(name, param, min_args, max_args, handler, ...) \
+    { name, sizeof(name) - 1, param, min_args, max_args, { __VA_ARGS__ }, handler }
+
+static const kmbox_cmd_desc_t cmd_table[] = {
+    KMBOX_CMD("move",     0,                   2, 3, cmd_move,        KMBOX_ARG_INT16, KMBOX_ARG_INT16, KMBOX_ARG_MOVE_MS),
+    KMBOX_CMD("wheel",    0,                   1, 1, cmd_wheel,       KMBOX_ARG_INT16),
+    KMBOX_CMD("click",    0,                   1, 2, cmd_click,       KMBOX_ARG_BUTTON, KMBOX_ARG_DURATION_MS),
+    KMBOX_CMD("buttons",  0,                   0, 1, cmd_buttons,     KMBOX_ARG_STATE),
+    KMBOX_CMD("lock_mx",  0,                   0, 1, cmd_lock_axis,   KMBOX_ARG_STATE),
+    KMBOX_CMD("lock_my",  1,                   0, 1, cmd_lock_axis,   KMBOX_ARG_STATE),
+    KMBOX_CMD("lock_ml",  KMBOX_BUTTON_LEFT,   0, 1, cmd_lock_button, KMBOX_ARG_STATE),
+    KMBOX_CMD("lock_mr",  KMBOX_BUTTON_RIGHT,  0, 1, cmd_lock_button, KMBOX_ARG_STATE),
+    KMBOX_CMD("lock_mm",  KMBOX_BUTTON_MIDDLE, 0, 1, cmd_lock_button, KMBOX_ARG_STATE),
+    KMBOX_CMD("lock_ms1", KMBOX_BUTTON_SIDE1,  0, 1, cmd_lock_button, KMBOX_ARG_STATE),
+    KMBOX_CMD("lock_ms2", KMBOX_BUTTON_SIDE2,  0, 1, cmd_lock_button, KMBOX_ARG_STATE),
+    KMBOX_CMD("left",     KMBOX_BUTTON_LEFT,   0, 1, cmd_button,      KMBOX_ARG_STATE),
+    KMBOX_CMD("right",    KMBOX_BUTTON_RIGHT,  0, 1, cmd_button,      KMBOX_ARG_STATE),
+    KMBOX_CMD("middle",   KMBOX_BUTTON_MIDDLE, 0, 1, cmd_button,      KMBOX_ARG_STATE),
+    KMBOX_CMD("side1",    KMBOX_BUTTON_SIDE1,  0, 1, cmd_button,      KMBOX_ARG_STATE),
+    KMBOX_CMD("side2",    KMBOX_BUTTON_SIDE2,  0, 1, cmd_button,      KMBOX_ARG_STATE),
+    KMBOX_CMD("echo",     0,                   0, 1, cmd_echo,        KMBOX_ARG_ECHO_MODE),
+    KMBOX_CMD("baud",     0,                   0, 1, cmd_baud,        KMBOX_ARG_BAUD),
+    KMBOX_CMD("trace",    0,                   0, 0, cmd_trace,       0),
+    KMBOX_CMD("drain",    0,                   0, 2, cmd_drain,       KMBOX_ARG_DRAIN_MODE, KMBOX_ARG_DRAIN_PARAM),
+    KMBOX_CMD("cancel",   0,                   0, 0, cmd_cancel,      0),
+};
+
+#define KMBOX_CMD_COUNT (sizeof(cmd_table) / sizeof(cmd_table[0]))
+
+_Static_assert(KMBOX_CMD_COUNT < 255, "command slot table stores 8-bit indices");
+
+// Hash slot -> command table index + 1 (0 = empty), built by build_cmd_slots()
+static uint8_t g_cmd_slots[KMBOX_CMD_SLOTS];
+
+static bool build_cmd_slots(void)
+{
+    bool ok = true;
+    memset(g_cmd_slots, 0, sizeof(g_cmd_slots));
+
+    for (size_t i = 0; i < KMBOX_CMD_COUNT; i++) {
+        const kmbox_cmd_desc_t* desc = &cmd_table[i];
+        unsigned slot = KMBOX_CMD_HASH(desc->name_len, desc->name[0], desc->name[desc->name_len - 1]);
+        if (g_cmd_slots[slot] != 0) {
+            printf("KMBox: command hash collision: %s vs %s\n",
+                   desc->name, cmd_table[g_cmd_slots[slot] - 1].name);
+            ok = false;
+            continue;
+        }
+        g_cmd_slots[slot] = (uint8_t)(i + 1);
+    }
+
+    return ok;
+}
+
+static const kmbox_cmd_desc_t* lookup_command(const char* name, size_t len)
+{
+    if (len == 0 || len > KMBOX_CMD_NAME_MAX) {
+        return NULL;
+    }
+
+    uint8_t idx = g_cmd_slots[KMBOX_CMD_HASH(len, name[0], name[len - 1])];
+    if (idx == 0) {
+        return NULL;
+    }
+
+    const kmbox_cmd_desc_t* desc = &cmd_table[idx - 1];
+    if (desc->name_len != len || memcmp(desc->name, name, len) != 0) {
+        return NULL;
+    }
+    return desc;
+}
+
+static bool validate_arg(kmbox_arg_type_t type, int32_t* value)
+{
+    switch (type) {
+    case KMBOX_ARG_INT16:
+        if (*value > INT16_MAX) *value = INT16_MAX;
+        else if (*value < INT16_MIN) *value = INT16_MIN;
+        return true;
+    case KMBOX_ARG_STATE:
+        return *value == 0 || *value == 1;
+    case KMBOX_ARG_BUTTON:
+        return *value >= 0 && *value < KMBOX_BUTTON_COUNT;
+    case KMBOX_ARG_ECHO_MODE:
+        return *value >= 0 && *value < KMBOX_ECHO_MODE_COUNT;
+    case KMBOX_ARG_BAUD:
+        return *value >= KMBOX_BAUD_MIN && *value <= KMBOX_BAUD_MAX;
+    case KMBOX_ARG_DURATION_MS:
+        return *value >= 1 && *value <= CLICK_PRESS_LIMIT_MS;
+    case KMBOX_ARG_DRAIN_MODE:
+        return *value >= 0 && *value < KMBOX_DRAIN_MODE_COUNT;
+    case KMBOX_ARG_DRAIN_PARAM:
+        return *value >= 1 && *value <= KMBOX_DRAIN_PARAM_MAX;
+    case KMBOX_ARG_MOVE_MS:
+        return *value >= 1 && *value <= KMBOX_PACED_MOVE_MAX_MS;
+    default:
+        return false;
+    }
+}
+
+//--------------------------------------------------------------------+
+// Command Parsing
+//--------------------------------------------------------------------+
+
+// Streaming command recognizer. Bytes are consumed as they arrive, so the
+// name lookup happens on '(' and each argument is converted and validated
+// as soon as its delimiter is seen. When the line terminator arrives the
+// command is already fully parsed and dispatch is O(1).
+typedef enum {
+    DFA_PREFIX_K = 0,   // Expecting 'k'
+    DFA_PREFIX_M,       // Expecting 'm'
+    DFA_PREFIX_DOT,     // Expecting '.'
+    DFA_NAME,           // Collecting the command name up to '('
+    DFA_ARGS_OPEN,      // After '(': blanks, ')' or the first argument
+    DFA_ARG_BEGIN,      // After ',': blanks or an argument
+    DFA_ARG_SIGN,       // After '+'/'-': first digit required
+    DFA_ARG_DIGITS,     // Inside an argument
+    DFA_ARG_END,        // After an argument and blanks: ',' or ')'
+    DFA_DONE,           // Closing ')' seen, trailing bytes are ignored
+    DFA_REJECT,         // Valid prefix but malformed command (echoed, not run)
+    DFA_IGNORE          // Not a km.* line (neither echoed nor run)
+} cmd_dfa_state_t;
+
+typedef struct {
+    uint8_t state;
+    uint8_t name_len;
+    uint8_t argc;
+    bool negative;
+    const kmbox_cmd_desc_t* desc;
+    char name[KMBOX_CMD_NAME_MAX];
+    int32_t args[KMBOX_CMD_MAX_ARGS];
+} cmd_dfa_t;
+
+static cmd_dfa_t g_dfa;
+
+static inline void cmd_dfa_reset(void)
+{
+    g_dfa.state = DFA_PREFIX_K;
+    g_dfa.name_len = 0;
+    g_dfa.argc = 0;
+    g_dfa.desc = NULL;
+}
+
+static inline bool is_blank(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+static inline bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+// Start a new argument with its first sign or digit character
+static uint8_t cmd_dfa_begin_arg(char c)
+{
+    if (g_dfa.argc >= g_dfa.desc->max_args) {
+        return DFA_REJECT;
+    }
+    g_dfa.args[g_dfa.argc] = 0;
+    g_dfa.negative = (c == '-');
+    if (c == '-' || c == '+') {
+        return DFA_ARG_SIGN;
+    }
+    if (is_digit(c)) {
+        g_dfa.args[g_dfa.argc] = c - '0';
+        return DFA_ARG_DIGITS;
+    }
+    return DFA_REJECT;
+}
+
+// Close the current argument, applying its sign and type check
+static bool cmd_dfa_end_arg(void)
+{
+    int32_t* value = &g_dfa.args[g_dfa.argc];
+    if (g_dfa.negative) {
+        *value = -*value;
+    }
+    if (!validate_arg((kmbox_arg_type_t)g_dfa.desc->arg_types[g_dfa.argc], value)) {
+        return false;
+    }
+    g_dfa.argc++;
+    return true;
+}
+
+static void cmd_dfa_feed(char c)
+{
+    switch (g_dfa.state) {
+    case DFA_PREFIX_K:
+        g_dfa.state = (c == 'k') ? DFA_PREFIX_M : DFA_IGNORE;
+        break;
+
+    case DFA_PREFIX_M:
+        g_dfa.state = (c == 'm') ? DFA_PREFIX_DOT : DFA_IGNORE;
+        break;
+
+    case DFA_PREFIX_DOT:
+        g_dfa.state = (c == '.') ? DFA_NAME : DFA_IGNORE;
+        break;
+
+    case DFA_NAME:
+        if (c == '(') {
+            g_dfa.desc = lookup_command(g_dfa.name, g_dfa.name_len);
+            g_dfa.state = g_dfa.desc ? DFA_ARGS_OPEN : DFA_REJECT;
+        } else if (g_dfa.name_len < KMBOX_CMD_NAME_MAX) {
+            g_dfa.name[g_dfa.name_len++] = c;
+        } else {
+            g_dfa.state = DFA_REJECT;
+        }
+        break;
+
+    case DFA_ARGS_OPEN:
+        if (is_blank(c)) {
+            break;
         }
-        
-        // Check if there's an argument
-        size_t arg_len = paren_end - arg_start;
-        if (arg_len == 0) {
-            // No argument - return lock state with result
-            printf("%d\r\n>>> ", g_kmbox_state.lock_my ? 1 : 0);
-            return;
+        g_dfa.state = (c == ')') ? DFA_DONE : cmd_dfa_begin_arg(c);
+        break;
+
+    case DFA_ARG_BEGIN:
+        if (!is_blank(c)) {
+            g_dfa.state = cmd_dfa_begin_arg(c);
         }
-        
-        // Extract state value
-        char state_str[8];
-        if (arg_len >= sizeof(state_str)) {
-            return;
+        break;
+
+    case DFA_ARG_SIGN:
+        if (is_digit(c)) {
+            g_dfa.args[g_dfa.argc] = c - '0';
+            g_dfa.state = DFA_ARG_DIGITS;
+        } else {
+            g_dfa.state = DFA_REJECT;
         }
-        
-        strncpy(state_str, arg_start, arg_len);
-        state_str[arg_len] = '\0';
-        
-        // Parse state
-        int state = atoi(state_str);
-        if (state != 0 && state != 1) {
-            return; // Invalid state
+        break;
+
+    case DFA_ARG_DIGITS:
+        if (is_digit(c)) {
+            // Saturate instead of overflowing
+            if (g_dfa.args[g_dfa.argc] < 100000000) {
+                g_dfa.args[g_dfa.argc] = g_dfa.args[g_dfa.argc] * 10 + (c - '0');
+            }
+            break;
         }
-        
-        // Set lock state
-        g_kmbox_state.lock_my = (state == 1);
-        
-        // Send the prompt
-        printf(">>> ");
+        if (!is_blank(c) && c != ',' && c != ')') {
+            g_dfa.state = DFA_REJECT;
+            break;
+        }
+        if (!cmd_dfa_end_arg()) {
+            g_dfa.state = DFA_REJECT;
+            break;
+        }
+        g_dfa.state = (c == ',') ? DFA_ARG_BEGIN : (c == ')') ? DFA_DONE : DFA_ARG_END;
+        break;
+
+    case DFA_ARG_END:
+        if (c == ',') {
+            g_dfa.state = DFA_ARG_BEGIN;
+        } else if (c == ')') {
+            g_dfa.state = DFA_DONE;
+        } else if (!is_blank(c)) {
+            g_dfa.state = DFA_REJECT;
+        }
+        break;
+
+    default:
+        // DONE, REJECT and IGNORE absorb the rest of the line
+        break;
+    }
+}
+
+// Finish the current line: echo it (given as up to two spans, the second
+// may be NULL) if it carried the km. prefix and run it if it parsed.
+static void cmd_dfa_finish(const char* first, size_t first_len,
+                           const char* second, size_t second_len,
+                           uint64_t current_time_us)
+{
+    uint8_t state = g_dfa.state;
+    const kmbox_cmd_desc_t* desc = g_dfa.desc;
+    uint8_t argc = g_dfa.argc;
+    cmd_dfa_reset();
+
+    if (state <= DFA_PREFIX_DOT || state == DFA_IGNORE) {
         return;
     }
     
-    // Check if this is a click command
-    if (strncmp(cmd + 3, "click(", 6) == 0) {
-        // Parse click command
-        const char* num_start = cmd + 9; // Skip "km.click("
-        char* num_end;
-        long button_num = strtol(num_start, &num_end, 10);
-        
-        // Validate button number and closing parenthesis
-        if (*num_end != ')' || button_num < 0 || button_num >= KMBOX_BUTTON_COUNT) {
-            return;
+    // Echo the command back with the original line terminator
+    if (g_echo_mode == KMBOX_ECHO_FULL) {
+        resp_put(first, first_len);
+        if (second) {
+            resp_put(second, second_len);
         }
-        
-        // Start the click sequence
-        start_button_click((kmbox_button_t)button_num, current_time_ms);
-        
-        // Send the prompt
-        printf(">>> ");
-        return;
+        resp_put(g_parser.command_terminator, g_parser.terminator_len);
     }
-    
-    // Check if this is a buttons callback command
-    if (strncmp(cmd + 3, "buttons(", 8) == 0) {
-        // Parse buttons command
-        const char* arg_start = cmd + 11; // Skip "km.buttons("
-        const char* paren_end = strchr(arg_start, ')');
-        
-        if (!paren_end) {
-            return;
+
+    if (state == DFA_DONE && argc >= desc->min_args) {
+        // Arguments stay valid in g_dfa.args until the next byte is fed
+        desc->handler(desc, g_dfa.args, argc, current_time_us);
+        g_command_count++;
+    }
+
+    resp_flush();
+}
+
+// Parse and execute one complete command line given as up to two spans
+static void parse_command(const char* first, size_t first_len,
+                          const char* second, size_t second_len,
+                          uint64_t current_time_us)
+{
+    cmd_dfa_reset();
+    for (size_t i = 0; i < first_len; i++) {
+        cmd_dfa_feed(first[i]);
+    }
+    for (size_t i = 0; i < second_len; i++) {
+        cmd_dfa_feed(second[i]);
+    }
+    cmd_dfa_finish(first, first_len, second, second_len, current_time_us);
+}
+
+//--------------------------------------------------------------------+
+// Binary Protocol
+//--------------------------------------------------------------------+
+
+static void send_binary_response(const kmbox_bin_frame_t* frame, kmbox_bin_status_t status, int16_t value)
+{
+    uint8_t out[KMBOX_BIN_MAX_FRAME];
+    size_t len = kmbox_bin_encode_response(out, sizeof(out), frame->op, frame->seq, status, value);
+    g_output((const char*)out, len);
+}
+
+static void dispatch_binary_frame(const kmbox_bin_frame_t* frame, uint64_t current_time_us)
+{
+    const uint8_t* p = frame->payload;
+    kmbox_bin_status_t status = KMBOX_BIN_STATUS_OK;
+    int16_t value = -1;  // No value byte in the response
+
+    // Payload sizes and ranges are validated per opcode; arguments are
+    // already binary so no string scanning happens here
+    switch (frame->op) {
+    case KMBOX_BIN_OP_MOVE:
+        if (frame->len != 4) {
+            status = KMBOX_BIN_STATUS_BAD_ARGS;
+            break;
         }
-        
-        // Check if there's an argument
-        size_t arg_len = paren_end - arg_start;
-        if (arg_len == 0) {
-            // No argument - return callback state with result
-            printf("%d\r\n>>> ", g_kmbox_state.button_callback_enabled ? 1 : 0);
-            return;
+        add_commanded_movement(kmbox_bin_get_i16(&p[0]), kmbox_bin_get_i16(&p[2]));
+        break;
+
+    case KMBOX_BIN_OP_MOVE8:
+        if (frame->len != 2) {
+            status = KMBOX_BIN_STATUS_BAD_ARGS;
+            break;
         }
-        
-        // Extract state value
-        char state_str[8];
-        if (arg_len >= sizeof(state_str)) {
-            return;
+        add_commanded_movement((int8_t)p[0], (int8_t)p[1]);
+        break;
+
+    case KMBOX_BIN_OP_WHEEL:
+        if (frame->len != 1) {
+            status = KMBOX_BIN_STATUS_BAD_ARGS;
+            break;
         }
-        
-        strncpy(state_str, arg_start, arg_len);
-        state_str[arg_len] = '\0';
-        
-        // Parse state
-        int state = atoi(state_str);
-        if (state != 0 && state != 1) {
-            return; // Invalid state
+        kmbox_add_wheel_movement((int8_t)p[0]);
+        break;
+
+    case KMBOX_BIN_OP_BUTTON:
+        if (frame->len != 2 || p[0] >= KMBOX_BUTTON_COUNT || p[1] > 1) {
+            status = KMBOX_BIN_STATUS_BAD_ARGS;
+            break;
         }
-        
-        // Set callback state
-        g_kmbox_state.button_callback_enabled = (state == 1);
-        
-        // Send the prompt
-        printf(">>> ");
-        return;
+        set_button_state((kmbox_button_t)p[0], p[1] == 1, current_time_us);
+        break;
+
+    case KMBOX_BIN_OP_CLICK: {
+        uint32_t press_us = (frame->len == 5) ? kmbox_bin_get_u32(&p[1]) : 0;
+        if ((frame->len != 1 && frame->len != 5) || p[0] >= KMBOX_BUTTON_COUNT ||
+            (frame->len == 5 && (press_us == 0 || press_us > CLICK_PRESS_LIMIT_US))) {
+            status = KMBOX_BIN_STATUS_BAD_ARGS;
+            break;
+        }
+        start_button_click((kmbox_button_t)p[0], press_us, current_time_us);
+        break;
     }
-    
-    // Check if this is a lock command
-    if (strncmp(cmd + 3, "lock_", 5) == 0) {
-        // Parse lock command
-        const char* lock_cmd_start = cmd + 8; // Skip "km.lock_"
-        
-        // Find the opening parenthesis
-        const char* paren_start = strchr(lock_cmd_start, '(');
-        if (!paren_start) {
-            return;
+
+    case KMBOX_BIN_OP_LOCK_AXIS: {
+        if (frame->len < 1 || frame->len > 2 || p[0] > KMBOX_BIN_AXIS_Y ||
+            (frame->len == 2 && p[1] > 1)) {
+            status = KMBOX_BIN_STATUS_BAD_ARGS;
+            break;
         }
-        
-        // Find the closing parenthesis
-        const char* paren_end = strchr(paren_start, ')');
-        if (!paren_end) {
-            return;
+        bool* lock = (p[0] == KMBOX_BIN_AXIS_X) ? &g_kmbox_state.lock_mx : &g_kmbox_state.lock_my;
+        if (frame->len == 1) {
+            value = *lock ? 1 : 0;
+        } else {
+            *lock = (p[1] == 1);
         }
-        
-        // Extract button name
-        size_t button_name_len = paren_start - lock_cmd_start;
-        if (button_name_len >= 16) {
-            return;
+        break;
+    }
+
+    case KMBOX_BIN_OP_LOCK_BUTTON:
+        if (frame->len < 1 || frame->len > 2 || p[0] >= KMBOX_BUTTON_COUNT ||
+            (frame->len == 2 && p[1] > 1)) {
+            status = KMBOX_BIN_STATUS_BAD_ARGS;
+            break;
         }
-        
-        char button_name[16];
-        strncpy(button_name, lock_cmd_start, button_name_len);
-        button_name[button_name_len] = '\0';
-        
-        // Parse button
-        kmbox_button_t button = parse_lock_button_name(button_name);
-        if (button == KMBOX_BUTTON_COUNT) {
-            return; // Invalid button name
+        if (frame->len == 1) {
+            value = get_button_lock((kmbox_button_t)p[0]) ? 1 : 0;
+        } else {
+            set_button_lock((kmbox_button_t)p[0], p[1] == 1);
         }
-        
-        // Check if there's an argument
-        size_t arg_len = paren_end - paren_start - 1;
-        if (arg_len == 0) {
-            // No argument - return lock state with result
-            bool is_locked = get_button_lock(button);
-            printf("%d\r\n>>> ", is_locked ? 1 : 0);
-            return;
+        break;
+
+    case KMBOX_BIN_OP_BUTTONS_CB:
+        if (frame->len > 1 || (frame->len == 1 && p[0] > 1)) {
+            status = KMBOX_BIN_STATUS_BAD_ARGS;
+            break;
         }
-        
-        // Extract state value
-        char state_str[8];
-        if (arg_len >= sizeof(state_str)) {
-            return;
+        if (frame->len == 0) {
+            value = g_kmbox_state.button_callback_enabled ? 1 : 0;
+        } else {
+            g_kmbox_state.button_callback_enabled = (p[0] == 1);
         }
-        
-        strncpy(state_str, paren_start + 1, arg_len);
-        state_str[arg_len] = '\0';
-        
-        // Parse state
-        int state = atoi(state_str);
-        if (state != 0 && state != 1) {
-            return; // Invalid state
+        break;
+
+    case KMBOX_BIN_OP_BAUD: {
+        uint32_t baud = (frame->len == 4) ? kmbox_bin_get_u32(p) : 0;
+        if (baud < KMBOX_BAUD_MIN || baud > KMBOX_BAUD_MAX || !request_baud_rate(baud)) {
+            status = KMBOX_BIN_STATUS_BAD_ARGS;
         }
-        
-        // Apply the lock
-        set_button_lock(button, state == 1);
-        
-        // Send the prompt
-        printf(">>> ");
-        return;
-    }
-    
-    // Parse regular button command
-    // Find the opening parenthesis
-    const char* paren_start = strchr(cmd + 3, '(');
-    if (!paren_start) {
-        return;
-    }
-    
-    // Find the closing parenthesis
-    const char* paren_end = strchr(paren_start, ')');
-    if (!paren_end) {
-        return;
-    }
-    
-    // Extract button name
-    size_t button_name_len = paren_start - (cmd + 3);
-    if (button_name_len >= 16) { // Reasonable limit for button name
-        return;
+        break;
     }
-    
-    char button_name[16];
-    strncpy(button_name, cmd + 3, button_name_len);
-    button_name[button_name_len] = '\0';
-    
-    // Extract state value
-    char state_str[8];
-    size_t state_len = paren_end - paren_start - 1;
-    if (state_len >= sizeof(state_str)) {
-        return;
-    }
-    
-    strncpy(state_str, paren_start + 1, state_len);
-    state_str[state_len] = '\0';
-    
-    // Parse button and state
-    kmbox_button_t button = parse_button_name(button_name);
-    if (button == KMBOX_BUTTON_COUNT) {
-        return; // Invalid button name
+
+    case KMBOX_BIN_OP_MOVE_PACED: {
+        uint16_t duration_ms = (frame->len == 6) ? (uint16_t)kmbox_bin_get_i16(&p[4]) : 0;
+        if (duration_ms == 0 || duration_ms > KMBOX_PACED_MOVE_MAX_MS ||
+            !kmbox_queue_paced_move(kmbox_bin_get_i16(&p[0]), kmbox_bin_get_i16(&p[2]),
+                                    duration_ms * 1000u, current_time_us)) {
+            status = KMBOX_BIN_STATUS_BAD_ARGS;
+        }
+        break;
     }
-    
-    int state = atoi(state_str);
-    if (state != 0 && state != 1) {
-        return; // Invalid state
+
+    case KMBOX_BIN_OP_MOVE_CANCEL:
+        if (frame->len != 0) {
+            status = KMBOX_BIN_STATUS_BAD_ARGS;
+            break;
+        }
+        value = kmbox_cancel_paced_moves();
+        break;
+
+    case KMBOX_BIN_OP_DRAIN:
+        if (frame->len == 0) {
+            value = g_kmbox_state.drain_mode;
+        } else if ((frame->len != 1 && frame->len != 3) ||
+                   !kmbox_set_drain_mode((kmbox_drain_mode_t)p[0],
+                                         (frame->len == 3) ? (uint16_t)kmbox_bin_get_i16(&p[1]) : 0)) {
+            status = KMBOX_BIN_STATUS_BAD_ARGS;
+        }
+        break;
+
+    default:
+        status = KMBOX_BIN_STATUS_UNKNOWN_OP;
+        break;
     }
-    
-    // Apply the command
-    set_button_state(button, state == 1, current_time_ms);
-    
-    // Send result (1 for button press/release commands)
-    printf("1\r\n>>> ");
+
+    // Any well-formed frame counts, even if its arguments were rejected
+    g_command_count++;
+    send_binary_response(frame, status, value);
 }
 
 //--------------------------------------------------------------------+
@@ -547,7 +1135,13 @@ void kmbox_commands_init(void)
 {
     // Initialize state
     memset(&g_kmbox_state, 0, sizeof(g_kmbox_state));
+    memset(&g_movement_stats, 0, sizeof(g_movement_stats));
     memset(&g_parser, 0, sizeof(g_parser));
+    kmbox_bin_decoder_reset(&g_bin_decoder);
+    
+    // Build the command dispatch table
+    build_cmd_slots();
+    cmd_dfa_reset();
     
     // Initialize random seed with a better value if available
     // For now, using a fixed seed for reproducibility
@@ -562,8 +1156,31 @@ void kmbox_commands_init(void)
            g_kmbox_state.lock_mx ? 1 : 0, g_kmbox_state.lock_my ? 1 : 0);
 }
 
-void kmbox_process_serial_char(char c, uint32_t current_time_ms)
+// Dispatch the buffered line and start a new one. A line that outgrew the
+// buffer is dropped whole, like kmbox_process_serial_spans() drops it, so
+// neither its head nor its tail runs as a command.
+static void finish_buffered_line(uint64_t current_time_us)
+{
+    if (!g_parser.line_overflow) {
+        cmd_dfa_finish(g_parser.buffer, g_parser.buffer_pos, NULL, 0, current_time_us);
+    }
+    g_parser.line_overflow = false;
+    g_parser.buffer_pos = 0;
+    g_parser.in_command = false;
+}
+
+void kmbox_process_serial_char(char c, uint64_t current_time_us)
 {
+    // Binary frames are auto-detected by their sync byte at the start of a line
+    if (kmbox_bin_decoder_busy(&g_bin_decoder) ||
+        (g_parser.buffer_pos == 0 && (uint8_t)c == KMBOX_BIN_SYNC)) {
+        g_parser.skip_next_terminator = false;
+        if (kmbox_bin_decoder_feed(&g_bin_decoder, (uint8_t)c) == KMBOX_BIN_FRAME_READY) {
+            dispatch_binary_frame(&g_bin_decoder.frame, current_time_us);
+        }
+        return;
+    }
+    
     // Handle line termination characters
     if (c == '\n' || c == '\r') {
         // Check if we have a command to process
@@ -580,13 +1197,7 @@ void kmbox_process_serial_char(char c, uint32_t current_time_ms)
                 g_parser.terminator_len = 1;
             }
             
-            // Null terminate and process command
-            g_parser.buffer[g_parser.buffer_pos] = '\0';
-            parse_command(g_parser.buffer, current_time_ms);
-            
-            // Reset parser
-            g_parser.buffer_pos = 0;
-            g_parser.in_command = false;
+            finish_buffered_line(current_time_us);
         } else if (g_parser.skip_next_terminator) {
             // Check if this is part of a \r\n sequence
             if (g_parser.last_terminator == '\r' && c == '\n') {
@@ -610,10 +1221,7 @@ void kmbox_process_serial_char(char c, uint32_t current_time_ms)
                         g_parser.terminator_len = 1;
                     }
                     
-                    g_parser.buffer[g_parser.buffer_pos] = '\0';
-                    parse_command(g_parser.buffer, current_time_ms);
-                    g_parser.buffer_pos = 0;
-                    g_parser.in_command = false;
+                    finish_buffered_line(current_time_us);
                 }
             }
         }
@@ -623,9 +1231,11 @@ void kmbox_process_serial_char(char c, uint32_t current_time_ms)
     // Reset skip flag for non-terminator characters
     g_parser.skip_next_terminator = false;
     
-    // Add character to buffer if there's space
+    // Add character to buffer if there's space. The buffer is only kept for
+    // the echo; the command itself is recognized as the bytes arrive.
     if (g_parser.buffer_pos < KMBOX_CMD_BUFFER_SIZE - 1) {
         g_parser.buffer[g_parser.buffer_pos++] = c;
+        cmd_dfa_feed(c);
         
         // Check if we're starting a command
         if (!g_parser.in_command && g_parser.buffer_pos >= 3) {
@@ -634,27 +1244,74 @@ void kmbox_process_serial_char(char c, uint32_t current_time_ms)
             }
         }
     } else {
-        // Buffer overflow - reset
-        g_parser.buffer_pos = 0;
-        g_parser.in_command = false;
+        // Buffer overflow - drop the rest of the line up to its terminator
+        g_parser.line_overflow = true;
+        cmd_dfa_reset();
     }
 }
 
+void kmbox_commands_set_output(kmbox_output_fn_t output)
+{
+    g_output = output ? output : default_output;
+}
+
+void kmbox_set_echo_mode(kmbox_echo_mode_t mode)
+{
+    if (mode < KMBOX_ECHO_MODE_COUNT) {
+        g_echo_mode = mode;
+    }
+}
+
+kmbox_echo_mode_t kmbox_get_echo_mode(void)
+{
+    return g_echo_mode;
+}
+
+void kmbox_commands_set_baud_handler(kmbox_baud_fn_t handler, uint32_t current_baud)
+{
+    g_baud_handler = handler;
+    g_baud_rate = current_baud;
+}
+
+void kmbox_commands_set_trace_handler(kmbox_trace_fn_t handler)
+{
+    g_trace_handler = handler;
+}
+
+uint32_t kmbox_get_command_count(void)
+{
+    return g_command_count;
+}
+
+bool kmbox_parser_is_idle(void)
+{
+    return g_parser.buffer_pos == 0 && !kmbox_bin_decoder_busy(&g_bin_decoder);
+}
+
 // Accept a complete command line (without trailing terminator characters).
 // This helper allows callers to hand over full lines from DMA/ring-buffer
-// with minimal per-byte overhead. The function will copy at most
-// KMBOX_CMD_BUFFER_SIZE-1 bytes into the parser buffer and call parse_command().
-void kmbox_process_serial_line(const char *line, size_t len, const char *terminator, uint8_t term_len, uint32_t current_time_ms)
+// with minimal per-byte overhead. The line is parsed in place.
+void kmbox_process_serial_line(const char *line, size_t len, const char *terminator, uint8_t term_len, uint64_t current_time_us)
 {
-    if (len == 0 || !line) return;
+    kmbox_process_serial_spans(line, len, NULL, 0, terminator, term_len, current_time_us);
+}
 
-    // Truncate if necessary
-    size_t copy_len = (len >= KMBOX_CMD_BUFFER_SIZE) ? (KMBOX_CMD_BUFFER_SIZE - 1) : len;
+void kmbox_process_serial_spans(const char *first, size_t first_len,
+                                const char *second, size_t second_len,
+                                const char *terminator, uint8_t term_len,
+                                uint64_t current_time_us)
+{
+    if (!first || first_len + second_len == 0) return;
+    if (!second) second_len = 0;
 
-    // Copy into parser buffer and null-terminate
-    memcpy(g_parser.buffer, line, copy_len);
-    g_parser.buffer[copy_len] = '\0';
-    g_parser.buffer_pos = (uint8_t)copy_len;
+    // Lines beyond the per-character path's buffer are dropped, as there
+    if (first_len + second_len >= KMBOX_CMD_BUFFER_SIZE) {
+        g_parser.buffer_pos = 0;
+        g_parser.in_command = false;
+        g_parser.line_overflow = false;
+        g_parser.skip_next_terminator = false;
+        return;
+    }
 
     // Store terminator info
     if (terminator && term_len > 0) {
@@ -665,8 +1322,8 @@ void kmbox_process_serial_line(const char *line, size_t len, const char *termina
         g_parser.terminator_len = 0;
     }
 
-    // Process the command
-    parse_command(g_parser.buffer, current_time_ms);
+    // Process the command straight from the caller's storage
+    parse_command(first, first_len, second_len ? second : NULL, second_len, current_time_us);
 
     // Reset parser state
     g_parser.buffer_pos = 0;
@@ -674,237 +1331,85 @@ void kmbox_process_serial_line(const char *line, size_t len, const char *termina
     g_parser.skip_next_terminator = false;
 }
 
-void kmbox_update_states(uint32_t current_time_ms)
+void kmbox_process_serial_data(const uint8_t *data, size_t len, uint64_t current_time_us)
 {
-    g_kmbox_state.last_update_time = current_time_ms;
-    
-    // Update each button state - UNROLLED for performance
-    // Eliminates loop overhead in this frequently called function
-    
-    // Button 0 (LEFT)
-    {
-        button_state_t* btn = &g_kmbox_state.buttons[KMBOX_BUTTON_LEFT];
-        
-        // Handle click sequence
-        if (btn->is_clicking) {
-            if (current_time_ms >= btn->click_end_time) {
-                // Click sequence complete, return to hardware state
-                btn->is_clicking = false;
-                btn->is_forced = false;
-                btn->click_release_start = 0;
-                btn->click_end_time = 0;
-                
-                // Restore physical button state
-                bool physical_pressed = (g_kmbox_state.physical_buttons & 0x01) != 0;
-                btn->is_pressed = physical_pressed;
-            } else if (current_time_ms >= btn->click_release_start) {
-                // In release phase of click
-                btn->is_pressed = false;
+    const char *p = (const char *)data;
+    const char *end = p + len;
+
+    while (p < end) {
+        // Whole text lines are parsed in place while the parser is between
+        // commands; binary frames may contain '\r' or '\n' and go byte-wise
+        if (kmbox_parser_is_idle() && (uint8_t)*p != KMBOX_BIN_SYNC) {
+            const char *q = p;
+            while (q < end && *q != '\r' && *q != '\n') {
+                q++;
             }
-            // If still in press phase, is_pressed remains true
-        }
-        // Check if a forced release has expired (for non-click commands)
-        else if (btn->is_forced && !btn->is_pressed && btn->release_time > 0) {
-            if (current_time_ms >= btn->release_time) {
-                // Release time expired, button returns to physical state
-                btn->is_forced = false;
-                btn->release_time = 0;
-                
-                // Restore physical button state (unless locked)
-                if (!btn->is_locked) {
-                    bool physical_pressed = (g_kmbox_state.physical_buttons & 0x01) != 0;
-                    btn->is_pressed = physical_pressed;
-                }
+            if (q < end) {
+                uint8_t term_len = (*q == '\r' && q + 1 < end && q[1] == '\n') ? 2 : 1;
+                kmbox_process_serial_spans(p, (size_t)(q - p), NULL, 0, q, term_len, current_time_us);
+                p = q + term_len;
+                continue;
             }
         }
-        // Update non-forced button states from physical state (unless locked)
-        else if (!btn->is_forced && !btn->is_locked) {
-            bool physical_pressed = (g_kmbox_state.physical_buttons & 0x01) != 0;
-            btn->is_pressed = physical_pressed;
-        }
+
+        // Partial lines and binary frames
+        kmbox_process_serial_char(*p++, current_time_us);
     }
+}
+
+void kmbox_update_states(uint64_t current_time_us)
+{
+    kmbox_state_t* s = &g_kmbox_state;
+    s->last_update_time = current_time_us;
     
-    // Button 1 (RIGHT)
-    {
-        button_state_t* btn = &g_kmbox_state.buttons[KMBOX_BUTTON_RIGHT];
-        
-        // Handle click sequence
-        if (btn->is_clicking) {
-            if (current_time_ms >= btn->click_end_time) {
-                // Click sequence complete, return to hardware state
-                btn->is_clicking = false;
-                btn->is_forced = false;
-                btn->click_release_start = 0;
-                btn->click_end_time = 0;
-                
-                // Restore physical button state
-                bool physical_pressed = (g_kmbox_state.physical_buttons & 0x02) != 0;
-                btn->is_pressed = physical_pressed;
-            } else if (current_time_ms >= btn->click_release_start) {
-                // In release phase of click
-                btn->is_pressed = false;
-            }
-            // If still in press phase, is_pressed remains true
-        }
-        // Check if a forced release has expired (for non-click commands)
-        else if (btn->is_forced && !btn->is_pressed && btn->release_time > 0) {
-            if (current_time_ms >= btn->release_time) {
-                // Release time expired, button returns to physical state
-                btn->is_forced = false;
-                btn->release_time = 0;
-                
-                // Restore physical button state (unless locked)
-                if (!btn->is_locked) {
-                    bool physical_pressed = (g_kmbox_state.physical_buttons & 0x02) != 0;
-                    btn->is_pressed = physical_pressed;
-                }
-            }
-        }
-        // Update non-forced button states from physical state (unless locked)
-        else if (!btn->is_forced && !btn->is_locked) {
-            bool physical_pressed = (g_kmbox_state.physical_buttons & 0x02) != 0;
-            btn->is_pressed = physical_pressed;
-        }
+    if (s->paced_count > 0) {
+        run_paced_moves(current_time_us);
     }
     
-    // Button 2 (MIDDLE)
-    {
-        button_state_t* btn = &g_kmbox_state.buttons[KMBOX_BUTTON_MIDDLE];
+    // Expire click phases and forced releases in deadline order. With
+    // nothing due this is a single compare.
+    kmbox_buttons_t expired = 0;
+    while (s->deadline_count > 0 && current_time_us >= s->deadlines[0].deadline) {
+        const kmbox_deadline_t due = s->deadlines[0];
+        const kmbox_buttons_t bit = BUTTON_BIT(due.button);
         
-        // Handle click sequence
-        if (btn->is_clicking) {
-            if (current_time_ms >= btn->click_end_time) {
-                // Click sequence complete, return to hardware state
-                btn->is_clicking = false;
-                btn->is_forced = false;
-                btn->click_release_start = 0;
-                btn->click_end_time = 0;
-                
-                // Restore physical button state
-                bool physical_pressed = (g_kmbox_state.physical_buttons & 0x04) != 0;
-                btn->is_pressed = physical_pressed;
-            } else if (current_time_ms >= btn->click_release_start) {
-                // In release phase of click
-                btn->is_pressed = false;
-            }
-            // If still in press phase, is_pressed remains true
-        }
-        // Check if a forced release has expired (for non-click commands)
-        else if (btn->is_forced && !btn->is_pressed && btn->release_time > 0) {
-            if (current_time_ms >= btn->release_time) {
-                // Release time expired, button returns to physical state
-                btn->is_forced = false;
-                btn->release_time = 0;
-                
-                // Restore physical button state (unless locked)
-                if (!btn->is_locked) {
-                    bool physical_pressed = (g_kmbox_state.physical_buttons & 0x04) != 0;
-                    btn->is_pressed = physical_pressed;
-                }
-            }
-        }
-        // Update non-forced button states from physical state (unless locked)
-        else if (!btn->is_forced && !btn->is_locked) {
-            bool physical_pressed = (g_kmbox_state.physical_buttons & 0x04) != 0;
-            btn->is_pressed = physical_pressed;
+        s->deadline_count--;
+        memmove(&s->deadlines[0], &s->deadlines[1], s->deadline_count * sizeof(s->deadlines[0]));
+        
+        if (s->clicking & (kmbox_buttons_t)~s->click_releasing & bit) {
+            // Press phase over, release for the rest of the click
+            s->pressed &= (kmbox_buttons_t)~bit;
+            s->click_releasing |= bit;
+            deadline_schedule(due.button, due.deadline + s->click_release_us[due.button]);
+            continue;
         }
+        expired |= bit;
     }
     
-    // Button 3 (SIDE1)
-    {
-        button_state_t* btn = &g_kmbox_state.buttons[KMBOX_BUTTON_SIDE1];
-        
-        // Handle click sequence
-        if (btn->is_clicking) {
-            if (current_time_ms >= btn->click_end_time) {
-                // Click sequence complete, return to hardware state
-                btn->is_clicking = false;
-                btn->is_forced = false;
-                btn->click_release_start = 0;
-                btn->click_end_time = 0;
-                
-                // Restore physical button state
-                bool physical_pressed = (g_kmbox_state.physical_buttons & 0x08) != 0;
-                btn->is_pressed = physical_pressed;
-            } else if (current_time_ms >= btn->click_release_start) {
-                // In release phase of click
-                btn->is_pressed = false;
-            }
-            // If still in press phase, is_pressed remains true
-        }
-        // Check if a forced release has expired (for non-click commands)
-        else if (btn->is_forced && !btn->is_pressed && btn->release_time > 0) {
-            if (current_time_ms >= btn->release_time) {
-                // Release time expired, button returns to physical state
-                btn->is_forced = false;
-                btn->release_time = 0;
-                
-                // Restore physical button state (unless locked)
-                if (!btn->is_locked) {
-                    bool physical_pressed = (g_kmbox_state.physical_buttons & 0x08) != 0;
-                    btn->is_pressed = physical_pressed;
-                }
-            }
-        }
-        // Update non-forced button states from physical state (unless locked)
-        else if (!btn->is_forced && !btn->is_locked) {
-            bool physical_pressed = (g_kmbox_state.physical_buttons & 0x08) != 0;
-            btn->is_pressed = physical_pressed;
-        }
+    if (!expired && !s->button_callback_enabled) {
+        return;
     }
     
-    // Button 4 (SIDE2)
-    {
-        button_state_t* btn = &g_kmbox_state.buttons[KMBOX_BUTTON_SIDE2];
+    if (expired) {
+        // A finished click returns to the physical state even when locked;
+        // an expired forced release only when unlocked
+        const kmbox_buttons_t click_done = expired & s->clicking;
+        s->pressed = (kmbox_buttons_t)((s->pressed & ~click_done) | (s->physical_buttons & click_done));
+        s->forced &= (kmbox_buttons_t)~expired;
+        s->clicking &= (kmbox_buttons_t)~expired;
+        s->click_releasing &= (kmbox_buttons_t)~expired;
+        s->release_pending &= (kmbox_buttons_t)~expired;
         
-        // Handle click sequence
-        if (btn->is_clicking) {
-            if (current_time_ms >= btn->click_end_time) {
-                // Click sequence complete, return to hardware state
-                btn->is_clicking = false;
-                btn->is_forced = false;
-                btn->click_release_start = 0;
-                btn->click_end_time = 0;
-                
-                // Restore physical button state
-                bool physical_pressed = (g_kmbox_state.physical_buttons & 0x10) != 0;
-                btn->is_pressed = physical_pressed;
-            } else if (current_time_ms >= btn->click_release_start) {
-                // In release phase of click
-                btn->is_pressed = false;
-            }
-            // If still in press phase, is_pressed remains true
-        }
-        // Check if a forced release has expired (for non-click commands)
-        else if (btn->is_forced && !btn->is_pressed && btn->release_time > 0) {
-            if (current_time_ms >= btn->release_time) {
-                // Release time expired, button returns to physical state
-                btn->is_forced = false;
-                btn->release_time = 0;
-                
-                // Restore physical button state (unless locked)
-                if (!btn->is_locked) {
-                    bool physical_pressed = (g_kmbox_state.physical_buttons & 0x10) != 0;
-                    btn->is_pressed = physical_pressed;
-                }
-            }
-        }
-        // Update non-forced button states from physical state (unless locked)
-        else if (!btn->is_forced && !btn->is_locked) {
-            bool physical_pressed = (g_kmbox_state.physical_buttons & 0x10) != 0;
-            btn->is_pressed = physical_pressed;
-        }
+        // Released buttons that are neither forced nor locked follow the
+        // physical mouse again
+        const kmbox_buttons_t hold = s->forced | s->locked;
+        s->pressed = (kmbox_buttons_t)((s->pressed & hold) | (s->physical_buttons & ~hold));
     }
     
     // Check if button state has changed and callback is enabled
     if (g_kmbox_state.button_callback_enabled) {
-        // Build current button state bitmap - UNROLLED for performance
-        uint8_t current_button_state = 
-            (g_kmbox_state.buttons[KMBOX_BUTTON_LEFT].is_pressed   ? 0x01 : 0) |
-            (g_kmbox_state.buttons[KMBOX_BUTTON_RIGHT].is_pressed  ? 0x02 : 0) |
-            (g_kmbox_state.buttons[KMBOX_BUTTON_MIDDLE].is_pressed ? 0x04 : 0) |
-            (g_kmbox_state.buttons[KMBOX_BUTTON_SIDE1].is_pressed  ? 0x08 : 0) |
-            (g_kmbox_state.buttons[KMBOX_BUTTON_SIDE2].is_pressed  ? 0x10 : 0);
+        // Build current button state bitmap
+        uint8_t current_button_state = get_button_byte();
         
         // Send callback if state changed
         if (current_button_state != g_kmbox_state.last_button_state) {
@@ -914,64 +1419,73 @@ void kmbox_update_states(uint32_t current_time_ms)
     }
 }
 
-void kmbox_get_mouse_report(uint8_t* buttons, int8_t* x, int8_t* y, int8_t* wheel, int8_t* pan)
+void kmbox_get_mouse_report(kmbox_buttons_t* buttons, int16_t* x, int16_t* y, int16_t* wheel, int16_t* pan)
 {
     if (!buttons || !x || !y || !wheel || !pan) {
         return;
     }
     
-    // Build button byte from current states - UNROLLED for performance
-    // Direct bit manipulation eliminates loop overhead and enables better optimization
-    uint8_t button_byte = 
-        (g_kmbox_state.buttons[KMBOX_BUTTON_LEFT].is_pressed   ? 0x01 : 0) |
-        (g_kmbox_state.buttons[KMBOX_BUTTON_RIGHT].is_pressed  ? 0x02 : 0) |
-        (g_kmbox_state.buttons[KMBOX_BUTTON_MIDDLE].is_pressed ? 0x04 : 0) |
-        (g_kmbox_state.buttons[KMBOX_BUTTON_SIDE1].is_pressed  ? 0x08 : 0) |
-        (g_kmbox_state.buttons[KMBOX_BUTTON_SIDE2].is_pressed  ? 0x10 : 0);
-    
     // Set output values
-    *buttons = button_byte;
+    *buttons = g_kmbox_state.pressed;
+    g_kmbox_state.last_report_buttons = g_kmbox_state.pressed;
     
-    // Get movement values from accumulators
-    // Clamp to int8_t range (-128 to 127)
-    if (g_kmbox_state.mouse_x_accumulator > 127) {
-        *x = 127;
-        g_kmbox_state.mouse_x_accumulator -= 127;
-    } else if (g_kmbox_state.mouse_x_accumulator < -128) {
-        *x = -128;
-        g_kmbox_state.mouse_x_accumulator -= -128;
-    } else {
-        *x = (int8_t)g_kmbox_state.mouse_x_accumulator;
-        g_kmbox_state.mouse_x_accumulator = 0;
+    // Get movement values from accumulators under the drain policy. The
+    // remainder stays queued for the following reports.
+    *x = drain_axis(&g_kmbox_state.cmd_x_accumulator, &g_kmbox_state.mouse_x_accumulator);
+    *y = drain_axis(&g_kmbox_state.cmd_y_accumulator, &g_kmbox_state.mouse_y_accumulator);
+    if (g_kmbox_state.pace_reports_left > 0) {
+        g_kmbox_state.pace_reports_left--;
     }
     
-    if (g_kmbox_state.mouse_y_accumulator > 127) {
-        *y = 127;
-        g_kmbox_state.mouse_y_accumulator -= 127;
-    } else if (g_kmbox_state.mouse_y_accumulator < -128) {
-        *y = -128;
-        g_kmbox_state.mouse_y_accumulator -= -128;
-    } else {
-        *y = (int8_t)g_kmbox_state.mouse_y_accumulator;
-        g_kmbox_state.mouse_y_accumulator = 0;
-    }
+    // Wheel and pan drain as much as fits in the report
+    *wheel = drain_full(&g_kmbox_state.wheel_accumulator);
+    *pan = drain_full(&g_kmbox_state.pan_accumulator);
     
-    // Get wheel value
-    *wheel = g_kmbox_state.wheel_accumulator;
-    g_kmbox_state.wheel_accumulator = 0;
+    g_movement_stats.emitted_x += *x;
+    g_movement_stats.emitted_y += *y;
+    g_movement_stats.emitted_wheel += *wheel;
+}
+
+bool kmbox_has_pending_report(void)
+{
+    // A report is pending when there is queued movement or the buttons
+    // differ from the ones handed out with the last report
+    return g_kmbox_state.mouse_x_accumulator != 0 ||
+           g_kmbox_state.mouse_y_accumulator != 0 ||
+           g_kmbox_state.cmd_x_accumulator != 0 ||
+           g_kmbox_state.cmd_y_accumulator != 0 ||
+           g_kmbox_state.wheel_accumulator != 0 ||
+           g_kmbox_state.pan_accumulator != 0 ||
+           g_kmbox_state.pressed != g_kmbox_state.last_report_buttons;
+}
+
+void kmbox_get_movement_stats(kmbox_movement_stats_t* stats)
+{
+    if (!stats) {
+        return;
+    }
     
-    *pan = 0;  // No pan movement from commands
+    *stats = g_movement_stats;
+    stats->lost_x = stats->accepted_x - stats->emitted_x -
+                    g_kmbox_state.mouse_x_accumulator - g_kmbox_state.cmd_x_accumulator;
+    stats->lost_y = stats->accepted_y - stats->emitted_y -
+                    g_kmbox_state.mouse_y_accumulator - g_kmbox_state.cmd_y_accumulator;
+    stats->lost_wheel = stats->accepted_wheel - stats->emitted_wheel - g_kmbox_state.wheel_accumulator;
 }
 
 bool kmbox_has_forced_buttons(void)
 {
-    // Check all buttons for forced state - UNROLLED for performance
-    // Direct access eliminates loop overhead
-    return g_kmbox_state.buttons[KMBOX_BUTTON_LEFT].is_forced ||
-           g_kmbox_state.buttons[KMBOX_BUTTON_RIGHT].is_forced ||
-           g_kmbox_state.buttons[KMBOX_BUTTON_MIDDLE].is_forced ||
-           g_kmbox_state.buttons[KMBOX_BUTTON_SIDE1].is_forced ||
-           g_kmbox_state.buttons[KMBOX_BUTTON_SIDE2].is_forced;
+    return g_kmbox_state.forced != 0;
+}
+
+uint64_t kmbox_get_next_deadline(void)
+{
+    return g_kmbox_state.deadline_count ? g_kmbox_state.deadlines[0].deadline : UINT64_MAX;
+}
+
+kmbox_buttons_t kmbox_get_button_mask(void)
+{
+    return g_kmbox_state.pressed;
 }
 
 const char* kmbox_get_button_name(kmbox_button_t button)
@@ -982,76 +1496,113 @@ const char* kmbox_get_button_name(kmbox_button_t button)
     return "unknown";
 }
 
-void kmbox_update_physical_buttons(uint8_t physical_buttons)
+void kmbox_update_physical_buttons(kmbox_buttons_t physical_buttons)
 {
-    g_kmbox_state.physical_buttons = physical_buttons;
-    
-    // Update button states for non-forced, non-locked buttons - UNROLLED for performance
-    // Direct bit testing eliminates loop overhead and array indexing
-    
-    // Button 0 (LEFT)
-    {
-        button_state_t* btn = &g_kmbox_state.buttons[KMBOX_BUTTON_LEFT];
-        if (!btn->is_forced && !btn->is_locked) {
-            btn->is_pressed = (physical_buttons & 0x01) != 0;
-        }
-    }
+    kmbox_state_t* s = &g_kmbox_state;
+    s->physical_buttons = physical_buttons;
     
-    // Button 1 (RIGHT)
-    {
-        button_state_t* btn = &g_kmbox_state.buttons[KMBOX_BUTTON_RIGHT];
-        if (!btn->is_forced && !btn->is_locked) {
-            btn->is_pressed = (physical_buttons & 0x02) != 0;
-        }
-    }
-    
-    // Button 2 (MIDDLE)
-    {
-        button_state_t* btn = &g_kmbox_state.buttons[KMBOX_BUTTON_MIDDLE];
-        if (!btn->is_forced && !btn->is_locked) {
-            btn->is_pressed = (physical_buttons & 0x04) != 0;
-        }
+    // Update button states for non-forced, non-locked buttons
+    const kmbox_buttons_t hold = s->forced | s->locked;
+    s->pressed = (kmbox_buttons_t)((s->pressed & hold) | (physical_buttons & ~hold));
+}
+
+void kmbox_add_mouse_movement(int16_t x, int16_t y)
+{
+    add_movement(&g_kmbox_state.mouse_x_accumulator, &g_kmbox_state.mouse_y_accumulator, x, y);
+}
+
+void kmbox_add_wheel_movement(int16_t wheel)
+{
+    // Scroll beyond one report is carried over instead of clamped away
+    g_kmbox_state.wheel_accumulator = accumulate(g_kmbox_state.wheel_accumulator, wheel);
+    g_movement_stats.accepted_wheel += wheel;
+}
+
+void kmbox_add_pan_movement(int16_t pan)
+{
+    g_kmbox_state.pan_accumulator = accumulate(g_kmbox_state.pan_accumulator, pan);
+}
+
+void kmbox_set_wide_reports(bool wide)
+{
+    g_kmbox_state.wide_reports = wide;
+}
+
+bool kmbox_get_wide_reports(void)
+{
+    return g_kmbox_state.wide_reports;
+}
+
+bool kmbox_queue_paced_move(int16_t x, int16_t y, uint32_t duration_us, uint64_t current_time_us)
+{
+    kmbox_state_t* s = &g_kmbox_state;
+    if (s->paced_count >= KMBOX_PACED_MOVE_QUEUE || duration_us == 0) {
+        return false;
     }
     
-    // Button 3 (SIDE1)
-    {
-        button_state_t* btn = &g_kmbox_state.buttons[KMBOX_BUTTON_SIDE1];
-        if (!btn->is_forced && !btn->is_locked) {
-            btn->is_pressed = (physical_buttons & 0x08) != 0;
-        }
+    if (s->paced_count == 0) {
+        s->paced_start_us = current_time_us;
+        s->paced_sent_x = 0;
+        s->paced_sent_y = 0;
     }
+    kmbox_paced_move_t* move = &s->paced_moves[(s->paced_head + s->paced_count) % KMBOX_PACED_MOVE_QUEUE];
+    move->x = x;
+    move->y = y;
+    move->duration_us = duration_us;
+    s->paced_count++;
+    return true;
+}
+
+uint8_t kmbox_cancel_paced_moves(void)
+{
+    kmbox_state_t* s = &g_kmbox_state;
+    const uint8_t cancelled = s->paced_count;
     
-    // Button 4 (SIDE2)
-    {
-        button_state_t* btn = &g_kmbox_state.buttons[KMBOX_BUTTON_SIDE2];
-        if (!btn->is_forced && !btn->is_locked) {
-            btn->is_pressed = (physical_buttons & 0x10) != 0;
-        }
-    }
+    s->paced_count = 0;
+    s->paced_head = 0;
+    s->paced_sent_x = 0;
+    s->paced_sent_y = 0;
+    return cancelled;
 }
 
-void kmbox_add_mouse_movement(int16_t x, int16_t y)
+bool kmbox_set_drain_mode(kmbox_drain_mode_t mode, uint16_t param)
 {
-    // Apply axis locks
-    if (!g_kmbox_state.lock_mx) {
-        g_kmbox_state.mouse_x_accumulator += x;
+    switch (mode) {
+    case KMBOX_DRAIN_IMMEDIATE:
+        param = 0;
+        break;
+    case KMBOX_DRAIN_CAPPED:
+        if (param == 0) {
+            param = KMBOX_DRAIN_DEFAULT_CAP;
+        }
+        if (param > INT8_MAX) {
+            return false;
+        }
+        break;
+    case KMBOX_DRAIN_PACED:
+        if (param == 0) {
+            param = KMBOX_DRAIN_DEFAULT_REPORTS;
+        }
+        if (param > KMBOX_DRAIN_PARAM_MAX) {
+            return false;
+        }
+        break;
+    default:
+        return false;
     }
     
-    if (!g_kmbox_state.lock_my) {
-        g_kmbox_state.mouse_y_accumulator += y;
-    }
+    g_kmbox_state.drain_mode = (uint8_t)mode;
+    g_kmbox_state.drain_param = param;
+    g_kmbox_state.pace_reports_left = 0;
+    return true;
 }
 
-void kmbox_add_wheel_movement(int8_t wheel)
+kmbox_drain_mode_t kmbox_get_drain_mode(uint16_t* param)
 {
-    g_kmbox_state.wheel_accumulator += wheel;
-    
-    // Clamp to int8_t range
-    if (g_kmbox_state.wheel_accumulator > 127) {
-        g_kmbox_state.wheel_accumulator = 127;
-    } else if (g_kmbox_state.wheel_accumulator < -128) {
-        g_kmbox_state.wheel_accumulator = -128;
+    if (param) {
+        *param = g_kmbox_state.drain_param;
     }
+    return (kmbox_drain_mode_t)g_kmbox_state.drain_mode;
 }
 
 void kmbox_set_axis_lock(bool lock_x, bool lock_y)
@@ -27,27 +27,81 @@ typedef enum {
 // Button State Management
 //--------------------------------------------------------------------+
 
+// Number of buttons tracked by the button engine. Bit n of every button
+// mask is button n, as in the HID report; the first KMBOX_BUTTON_COUNT have
+// names and km.* commands, the rest follow the physical mouse. Up to 16 for
+// mice with extra side buttons.
+#ifndef KMBOX_MAX_BUTTONS
+#define KMBOX_MAX_BUTTONS 8
+#endif
+
+#if KMBOX_MAX_BUTTONS < 5 || KMBOX_MAX_BUTTONS > 16
+#error "KMBOX_MAX_BUTTONS must cover the named buttons and be at most 16"
+#elif KMBOX_MAX_BUTTONS <= 8
+typedef uint8_t kmbox_buttons_t;
+#else
+typedef uint16_t kmbox_buttons_t;
+#endif
+
+// Mask of all tracked buttons
+#define KMBOX_BUTTONS_ALL ((kmbox_buttons_t)((1u << KMBOX_MAX_BUTTONS) - 1u))
+
+// Pending timed button action (click phase end or forced release end)
+typedef struct {
+    uint64_t deadline;  // Expiry time (us)
+    uint8_t button;
+} kmbox_deadline_t;
+
+// Displacement delivered over a duration by km.move(x, y, ms)
+#define KMBOX_PACED_MOVE_QUEUE   8      // Moves queued behind the one in progress, including it
+#define KMBOX_PACED_MOVE_MAX_MS  60000
+
 typedef struct {
-    bool is_pressed;
-    bool is_forced;  // True if button state is forced by command
-    uint32_t release_time;  // Time when forced release should end (0 if not active)
-    bool is_clicking;  // True if button is in a click sequence
-    uint32_t click_release_start;  // Time when click press ends and release starts
-    uint32_t click_end_time;  // Time when entire click sequence ends
-    bool is_locked;  // True if button is locked (physical input masked from output)
-} button_state_t;
+    int16_t x;
+    int16_t y;
+    uint32_t duration_us;
+} kmbox_paced_move_t;
 
 typedef struct {
-    button_state_t buttons[KMBOX_BUTTON_COUNT];
-    uint8_t physical_buttons;  // Actual physical button states
-    uint32_t last_update_time;
+    // Button engine: one bit per button in each mask
+    kmbox_buttons_t pressed;          // Output state
+    kmbox_buttons_t forced;           // State owned by a command, not the mouse
+    kmbox_buttons_t clicking;         // In a click sequence
+    kmbox_buttons_t click_releasing;  // Click press phase over, release phase running
+    kmbox_buttons_t release_pending;  // Forced release running until its deadline
+    kmbox_buttons_t locked;           // Physical input masked from output
+    kmbox_buttons_t physical_buttons; // Actual physical button states
+    kmbox_deadline_t deadlines[KMBOX_MAX_BUTTONS]; // Expiries of clicking and release-pending buttons, soonest first
+    uint8_t deadline_count;
+    uint32_t click_release_us[KMBOX_MAX_BUTTONS];  // Release phase length, applied when the press phase ends
+    
+    uint64_t last_update_time;    // Timestamp (us) of the last kmbox_update_states()
     bool button_callback_enabled;  // True if button state change callback is enabled
     uint8_t last_button_state;     // Last reported button state for callback
+    kmbox_buttons_t last_report_buttons; // Buttons handed out with the last mouse report
+    
+    // Mouse movement state. Additions saturate at +/-INT32_MAX.
+    int32_t mouse_x_accumulator;  // Accumulated physical X movement
+    int32_t mouse_y_accumulator;  // Accumulated physical Y movement
+    int32_t cmd_x_accumulator;    // Commanded X movement, drained under the drain policy
+    int32_t cmd_y_accumulator;    // Commanded Y movement, drained under the drain policy
+    int32_t wheel_accumulator;    // Accumulated wheel movement
+    int32_t pan_accumulator;      // Accumulated horizontal scroll (physical only)
+    bool wide_reports;            // Reports carry 16-bit axes (see kmbox_set_wide_reports)
+    
+    // Drain policy for the commanded X/Y accumulators (see kmbox_drain_mode_t)
+    uint8_t drain_mode;
+    uint16_t drain_param;
+    uint16_t pace_reports_left;   // Reports left in the current paced window
     
-    // Mouse movement state
-    int16_t mouse_x_accumulator;  // Accumulated X movement
-    int16_t mouse_y_accumulator;  // Accumulated Y movement
-    int8_t wheel_accumulator;      // Accumulated wheel movement
+    // Paced moves, oldest (in progress) first. Each starts when the previous
+    // one ends, so consecutive moves chain without gaps.
+    kmbox_paced_move_t paced_moves[KMBOX_PACED_MOVE_QUEUE];
+    uint8_t paced_head;
+    uint8_t paced_count;
+    uint64_t paced_start_us;      // Start of the move in progress
+    int16_t paced_sent_x;         // Part of it already added to the accumulators
+    int16_t paced_sent_y;
     
     // Axis lock states
     bool lock_mx;  // Lock X axis (left/right movement)
@@ -64,39 +118,189 @@ typedef struct {
     char buffer[KMBOX_CMD_BUFFER_SIZE];
     uint8_t buffer_pos;
     bool in_command;
+    bool line_overflow;         // Current line outgrew the buffer and is dropped at its terminator
     bool skip_next_terminator;  // Skip next terminator if it's part of \r\n
     char last_terminator;       // Track last terminator seen ('\r' or '\n')
     char command_terminator[3]; // Store the line terminator(s) used for current command
     uint8_t terminator_len;     // Length of the terminator (1 for \n or \r, 2 for \r\n)
 } kmbox_parser_t;
 
+//--------------------------------------------------------------------+
+// Response Output
+//--------------------------------------------------------------------+
+
+// Response verbosity for km.* text commands, selected with km.echo(mode).
+// Binary protocol responses are not affected.
+typedef enum {
+    KMBOX_ECHO_FULL = 0,    // Echo the command line, results and ">>> " prompt
+    KMBOX_ECHO_PROMPT,      // Results and prompt, no echo
+    KMBOX_ECHO_ACK,         // One line per accepted command: its value or "1"
+    KMBOX_ECHO_SILENT,      // Query results only
+    KMBOX_ECHO_MODE_COUNT
+} kmbox_echo_mode_t;
+
+// Line sent in every echo mode, in place of the acknowledgement, when a
+// well-formed command is refused: a paced move with the queue full, or a
+// baud rate or drain mode that is not accepted
+#define KMBOX_RESP_ERROR "ERR"
+
+// Sink for everything the library sends back to the controller (echoes,
+// results, button callbacks and binary responses). Must not block.
+typedef void (*kmbox_output_fn_t)(const char* data, size_t len);
+
+// Baud rate limits accepted by km.baud() and the binary BAUD opcode
+#define KMBOX_BAUD_MIN  9600
+#define KMBOX_BAUD_MAX  4000000
+
+// Transport hook for km.baud(rate). Return false to reject the rate. The
+// acknowledgement is queued at the old rate before the hook's transport
+// switches, so the switch should be deferred until TX has drained.
+typedef bool (*kmbox_baud_fn_t)(uint32_t baud);
+
+// How queued commanded X/Y movement is handed out with mouse reports,
+// selected with km.drain(mode, param) or the binary DRAIN opcode. Physical
+// movement and the wheel always drain as fast as the report allows; commanded
+// movement gets what is left of the report's range.
+typedef enum {
+    KMBOX_DRAIN_IMMEDIATE = 0,  // As much as one report can carry (default)
+    KMBOX_DRAIN_CAPPED,         // At most param counts per axis per report (1-127)
+    KMBOX_DRAIN_PACED,          // Each commanded move spread evenly over param reports
+    KMBOX_DRAIN_MODE_COUNT
+} kmbox_drain_mode_t;
+
+#define KMBOX_DRAIN_PARAM_MAX       1000  // Largest paced window, in reports
+#define KMBOX_DRAIN_DEFAULT_CAP     32    // km.drain(1) without a parameter
+#define KMBOX_DRAIN_DEFAULT_REPORTS 8     // km.drain(2) without a parameter
+
+// Diagnostic hook for km.trace(): dump the firmware's event trace and return
+// the number of records it contains
+typedef uint32_t (*kmbox_trace_fn_t)(void);
+
 //--------------------------------------------------------------------+
 // Public API
 //--------------------------------------------------------------------+
 
+// All current_time_us arguments are a monotonic 64-bit microsecond clock,
+// e.g. time_us_64(); button deadlines are kept at that resolution.
+
 // Initialize the kmbox commands module
 void kmbox_commands_init(void);
 
-// Process incoming serial data (call this with each received character)
-void kmbox_process_serial_char(char c, uint32_t current_time_ms);
+// Route responses to a transport. Defaults to stdout; NULL restores it.
+void kmbox_commands_set_output(kmbox_output_fn_t output);
+
+// Get/set the text response mode
+void kmbox_set_echo_mode(kmbox_echo_mode_t mode);
+kmbox_echo_mode_t kmbox_get_echo_mode(void);
+
+// Install the baud rate hook and the rate currently in use (reported by
+// km.baud()). Without a hook, rate change requests are rejected.
+void kmbox_commands_set_baud_handler(kmbox_baud_fn_t handler, uint32_t current_baud);
+
+// Install the km.trace() hook. Without a hook, km.trace() answers ERR.
+void kmbox_commands_set_trace_handler(kmbox_trace_fn_t handler);
+
+// Number of commands executed so far (valid text commands and well-formed
+// binary frames); lets a transport confirm a link is alive
+uint32_t kmbox_get_command_count(void);
+
+// Process incoming serial data (call this with each received character).
+// Accepts both km.* text lines and binary frames (see kmbox_protocol.h),
+// which are recognised by their sync byte at the start of a line.
+void kmbox_process_serial_char(char c, uint64_t current_time_us);
+
+// Check if the parser is between commands (no partial text line or binary
+// frame buffered). Whole-line hand-over is only valid while idle.
+bool kmbox_parser_is_idle(void);
 
 // Process a complete command line (without trailing terminator). The caller
 // should pass the line contents (len bytes), the terminator bytes (pointer)
 // and terminator length (1 or 2). This allows callers to hand over full
 // lines from DMA/ring-buffer with a single call instead of per-byte calls.
-void kmbox_process_serial_line(const char *line, size_t len, const char *terminator, uint8_t term_len, uint32_t current_time_ms);
+void kmbox_process_serial_line(const char *line, size_t len, const char *terminator, uint8_t term_len, uint64_t current_time_us);
+
+// Process a complete command line stored as two contiguous spans, e.g. the
+// two halves of a line that wraps around a ring buffer. The line is parsed
+// in place without being copied; second may be NULL. The storage only has
+// to stay valid for the duration of the call.
+void kmbox_process_serial_spans(const char *first, size_t first_len,
+                                const char *second, size_t second_len,
+                                const char *terminator, uint8_t term_len,
+                                uint64_t current_time_us);
+
+// Process a chunk of received bytes, e.g. straight from a DMA ring. Complete
+// text lines inside the chunk are parsed in place; partial lines and binary
+// frames are fed through kmbox_process_serial_char() and may span chunks.
+void kmbox_process_serial_data(const uint8_t *data, size_t len, uint64_t current_time_us);
+
+// Update button states and handle timing (call this periodically). Only
+// compares against the soonest pending deadline unless something expired.
+void kmbox_update_states(uint64_t current_time_us);
+
+// Time (us) of the soonest pending button expiry, or UINT64_MAX if none
+uint64_t kmbox_get_next_deadline(void);
 
-// Update button states and handle timing (call this periodically)
-void kmbox_update_states(uint32_t current_time_ms);
+// Get the current mouse report based on button states. Axis values are
+// within the range selected with kmbox_set_wide_reports(); movement beyond
+// one report stays queued for the next. Buttons are all KMBOX_MAX_BUTTONS
+// output bits; the 8-bit report carries the low byte.
+void kmbox_get_mouse_report(kmbox_buttons_t* buttons, int16_t* x, int16_t* y, int16_t* wheel, int16_t* pan);
 
-// Get the current mouse report based on button states
-void kmbox_get_mouse_report(uint8_t* buttons, int8_t* x, int8_t* y, int8_t* wheel, int8_t* pan);
+// Report axis range: 8-bit (-128..127, boot mouse layout, the default) or
+// 16-bit (+/-KMBOX_WIDE_AXIS_MAX) when the device side declares a mouse
+// report with 16-bit X/Y, wheel and pan
+#define KMBOX_WIDE_AXIS_MAX         32767
 
-// Add mouse movement
+void kmbox_set_wide_reports(bool wide);
+bool kmbox_get_wide_reports(void);
+
+// Check if a mouse report should be emitted (queued movement or a button
+// change that has not been handed out by kmbox_get_mouse_report yet)
+bool kmbox_has_pending_report(void);
+
+// Movement accounting since kmbox_commands_init(). "Accepted" is everything
+// added to the accumulators by commands and physical reports (after axis
+// locks), "emitted" is what kmbox_get_mouse_report() handed out, and "lost"
+// is the net difference not explained by movement still queued, e.g. from
+// accumulator overflow or wheel clamping.
+typedef struct {
+    int64_t accepted_x;
+    int64_t accepted_y;
+    int64_t accepted_wheel;
+    int64_t emitted_x;
+    int64_t emitted_y;
+    int64_t emitted_wheel;
+    int64_t lost_x;
+    int64_t lost_y;
+    int64_t lost_wheel;
+    uint32_t overflows;  // Additions that saturated an accumulator
+} kmbox_movement_stats_t;
+
+void kmbox_get_movement_stats(kmbox_movement_stats_t* stats);
+
+// Add physical mouse movement; it is never held back by the drain policy
 void kmbox_add_mouse_movement(int16_t x, int16_t y);
 
 // Add wheel movement
-void kmbox_add_wheel_movement(int8_t wheel);
+void kmbox_add_wheel_movement(int16_t wheel);
+
+// Add horizontal scroll (AC Pan) movement
+void kmbox_add_pan_movement(int16_t pan);
+
+// Queue a displacement to be added to the accumulators evenly over
+// duration_us, starting now or when the queued moves before it finish.
+// Returns false if the queue is full.
+bool kmbox_queue_paced_move(int16_t x, int16_t y, uint32_t duration_us, uint64_t current_time_us);
+
+// Drop the paced move in progress (its undelivered part) and all queued
+// ones. Returns the number of moves cancelled.
+uint8_t kmbox_cancel_paced_moves(void);
+
+// Select the drain policy. param is the per-report cap (CAPPED) or the
+// window length in reports (PACED), 0 for the mode's default; ignored for
+// IMMEDIATE. Returns false for an invalid mode or parameter.
+bool kmbox_set_drain_mode(kmbox_drain_mode_t mode, uint16_t param);
+kmbox_drain_mode_t kmbox_get_drain_mode(uint16_t* param);
 
 // Set axis lock state
 void kmbox_set_axis_lock(bool lock_x, bool lock_y);
@@ -112,6 +316,10 @@ bool kmbox_has_forced_buttons(void);
 const char* kmbox_get_button_name(kmbox_button_t button);
 
 // Update physical button states (call this with actual hardware button states)
-void kmbox_update_physical_buttons(uint8_t physical_buttons);
+void kmbox_update_physical_buttons(kmbox_buttons_t physical_buttons);
+
+// Current output state of all KMBOX_MAX_BUTTONS buttons, as handed out by
+// the next kmbox_get_mouse_report()
+kmbox_buttons_t kmbox_get_button_mask(void);
 
 #endif // KMBOX_COMMANDS_H
\ No newline at end of file
@@ -0,0 +1,224 @@
+/*
+ * KMBox Binary Protocol Implementation
+ * Framing, CRC and encode/decode helpers shared by firmware and host tools
+ */
+
+#include "kmbox_protocol.h"
+#include <string.h>
+
+//--------------------------------------------------------------------+
+// CRC-8 (poly 0x07, init 0x00)
+//--------------------------------------------------------------------+
+
+static const uint8_t crc8_table[256] = {
+    0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15,
+    0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D,
+    0x70, 0x77, 0x7E, 0x79, 0x6C, 0x6B, 0x62, 0x65,
+    0x48, 0x4F, 0x46, 0x41, 0x54, 0x53, 0x5A, 0x5D,
+    0xE0, 0xE7, 0xEE, 0xE9, 0xFC, 0xFB, 0xF2, 0xF5,
+    0xD8, 0xDF, 0xD6, 0xD1, 0xC4, 0xC3, 0xCA, 0xCD,
+    0x90, 0x97, 0x9E, 0x99, 0x8C, 0x8B, 0x82, 0x85,
+    0xA8, 0xAF, 0xA6, 0xA1, 0xB4, 0xB3, 0xBA, 0xBD,
+    0xC7, 0xC0, 0xC9, 0xCE, 0xDB, 0xDC, 0xD5, 0xD2,
+    0xFF, 0xF8, 0xF1, 0xF6, 0xE3, 0xE4, 0xED, 0xEA,
+    0xB7, 0xB0, 0xB9, 0xBE, 0xAB, 0xAC, 0xA5, 0xA2,
+    0x8F, 0x88, 0x81, 0x86, 0x93, 0x94, 0x9D, 0x9A,
+    0x27, 0x20, 0x29, 0x2E, 0x3B, 0x3C, 0x35, 0x32,
+    0x1F, 0x18, 0x11, 0x16, 0x03, 0x04, 0x0D, 0x0A,
+    0x57, 0x50, 0x59, 0x5E, 0x4B, 0x4C, 0x45, 0x42,
+    0x6F, 0x68, 0x61, 0x66, 0x73, 0x74, 0x7D, 0x7A,
+    0x89, 0x8E, 0x87, 0x80, 0x95, 0x92, 0x9B, 0x9C,
+    0xB1, 0xB6, 0xBF, 0xB8, 0xAD, 0xAA, 0xA3, 0xA4,
+    0xF9, 0xFE, 0xF7, 0xF0, 0xE5, 0xE2, 0xEB, 0xEC,
+    0xC1, 0xC6, 0xCF, 0xC8, 0xDD, 0xDA, 0xD3, 0xD4,
+    0x69, 0x6E, 0x67, 0x60, 0x75, 0x72, 0x7B, 0x7C,
+    0x51, 0x56, 0x5F, 0x58, 0x4D, 0x4A, 0x43, 0x44,
+    0x19, 0x1E, 0x17, 0x10, 0x05, 0x02, 0x0B, 0x0C,
+    0x21, 0x26, 0x2F, 0x28, 0x3D, 0x3A, 0x33, 0x34,
+    0x4E, 0x49, 0x40, 0x47, 0x52, 0x55, 0x5C, 0x5B,
+    0x76, 0x71, 0x78, 0x7F, 0x6A, 0x6D, 0x64, 0x63,
+    0x3E, 0x39, 0x30, 0x37, 0x22, 0x25, 0x2C, 0x2B,
+    0x06, 0x01, 0x08, 0x0F, 0x1A, 0x1D, 0x14, 0x13,
+    0xAE, 0xA9, 0xA0, 0xA7, 0xB2, 0xB5, 0xBC, 0xBB,
+    0x96, 0x91, 0x98, 0x9F, 0x8A, 0x8D, 0x84, 0x83,
+    0xDE, 0xD9, 0xD0, 0xD7, 0xC2, 0xC5, 0xCC, 0xCB,
+    0xE6, 0xE1, 0xE8, 0xEF, 0xFA, 0xFD, 0xF4, 0xF3,
+};
+
+uint8_t kmbox_bin_crc8(uint8_t crc, const uint8_t* data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        crc = crc8_table[crc ^ data[i]];
+    }
+    return crc;
+}
+
+//--------------------------------------------------------------------+
+// Streaming Decoder
+//--------------------------------------------------------------------+
+
+enum {
+    DEC_WAIT_SYNC = 0,
+    DEC_WAIT_HDR,
+    DEC_WAIT_SEQ,
+    DEC_PAYLOAD,
+    DEC_WAIT_CRC
+};
+
+void kmbox_bin_decoder_reset(kmbox_bin_decoder_t* dec)
+{
+    memset(dec, 0, sizeof(*dec));
+    dec->state = DEC_WAIT_SYNC;
+}
+
+bool kmbox_bin_decoder_busy(const kmbox_bin_decoder_t* dec)
+{
+    return dec->state != DEC_WAIT_SYNC;
+}
+
+kmbox_bin_result_t kmbox_bin_decoder_feed(kmbox_bin_decoder_t* dec, uint8_t byte)
+{
+    switch (dec->state) {
+    case DEC_WAIT_SYNC:
+        if (byte == KMBOX_BIN_SYNC) {
+            dec->state = DEC_WAIT_HDR;
+        }
+        return KMBOX_BIN_NEED_MORE;
+
+    case DEC_WAIT_HDR:
+        dec->frame.op = KMBOX_BIN_HDR_OP(byte);
+        dec->frame.len = KMBOX_BIN_HDR_LEN(byte);
+        dec->crc = crc8_table[byte];
+        dec->pos = 0;
+        dec->state = DEC_WAIT_SEQ;
+        return KMBOX_BIN_NEED_MORE;
+
+    case DEC_WAIT_SEQ:
+        dec->frame.seq = byte;
+        dec->crc = crc8_table[dec->crc ^ byte];
+        dec->state = (dec->frame.len > 0) ? DEC_PAYLOAD : DEC_WAIT_CRC;
+        return KMBOX_BIN_NEED_MORE;
+
+    case DEC_PAYLOAD:
+        dec->frame.payload[dec->pos++] = byte;
+        dec->crc = crc8_table[dec->crc ^ byte];
+        if (dec->pos >= dec->frame.len) {
+            dec->state = DEC_WAIT_CRC;
+        }
+        return KMBOX_BIN_NEED_MORE;
+
+    case DEC_WAIT_CRC:
+    default:
+        dec->state = DEC_WAIT_SYNC;
+        return (byte == dec->crc) ? KMBOX_BIN_FRAME_READY : KMBOX_BIN_CRC_ERROR;
+    }
+}
+
+//--------------------------------------------------------------------+
+// Encoder
+//--------------------------------------------------------------------+
+
+size_t kmbox_bin_encode(uint8_t* out, size_t out_size, uint8_t op, uint8_t seq,
+                        const uint8_t* payload, uint8_t len)
+{
+    if (!out || len > KMBOX_BIN_MAX_PAYLOAD || out_size < (size_t)(KMBOX_BIN_OVERHEAD + len)) {
+        return 0;
+    }
+
+    out[0] = KMBOX_BIN_SYNC;
+    out[1] = KMBOX_BIN_HDR(op, len);
+    out[2] = seq;
+    if (len > 0) {
+        memcpy(&out[3], payload, len);
+    }
+    out[3 + len] = kmbox_bin_crc8(0, &out[1], 2 + len);
+
+    return KMBOX_BIN_OVERHEAD + len;
+}
+
+size_t kmbox_bin_encode_move(uint8_t* out, size_t out_size, uint8_t seq, int16_t x, int16_t y)
+{
+    if (x >= -128 && x <= 127 && y >= -128 && y <= 127) {
+        const uint8_t payload[2] = { (uint8_t)(int8_t)x, (uint8_t)(int8_t)y };
+        return kmbox_bin_encode(out, out_size, KMBOX_BIN_OP_MOVE8, seq, payload, 2);
+    }
+
+    uint8_t payload[4];
+    kmbox_bin_put_i16(&payload[0], x);
+    kmbox_bin_put_i16(&payload[2], y);
+    return kmbox_bin_encode(out, out_size, KMBOX_BIN_OP_MOVE, seq, payload, 4);
+}
+
+size_t kmbox_bin_encode_wheel(uint8_t* out, size_t out_size, uint8_t seq, int8_t amount)
+{
+    const uint8_t payload[1] = { (uint8_t)amount };
+    return kmbox_bin_encode(out, out_size, KMBOX_BIN_OP_WHEEL, seq, payload, 1);
+}
+
+size_t kmbox_bin_encode_button(uint8_t* out, size_t out_size, uint8_t seq, uint8_t button, bool pressed)
+{
+    const uint8_t payload[2] = { button, pressed ? 1 : 0 };
+    return kmbox_bin_encode(out, out_size, KMBOX_BIN_OP_BUTTON, seq, payload, 2);
+}
+
+size_t kmbox_bin_encode_click(uint8_t* out, size_t out_size, uint8_t seq, uint8_t button, uint32_t press_us)
+{
+    // press_us = 0 leaves the press duration to the firmware
+    uint8_t payload[5] = { button };
+    kmbox_bin_put_u32(&payload[1], press_us);
+    return kmbox_bin_encode(out, out_size, KMBOX_BIN_OP_CLICK, seq, payload, press_us ? 5 : 1);
+}
+
+size_t kmbox_bin_encode_lock_axis(uint8_t* out, size_t out_size, uint8_t seq, uint8_t axis, int8_t state)
+{
+    const uint8_t payload[2] = { axis, (uint8_t)state };
+    return kmbox_bin_encode(out, out_size, KMBOX_BIN_OP_LOCK_AXIS, seq, payload, state < 0 ? 1 : 2);
+}
+
+size_t kmbox_bin_encode_lock_button(uint8_t* out, size_t out_size, uint8_t seq, uint8_t button, int8_t state)
+{
+    const uint8_t payload[2] = { button, (uint8_t)state };
+    return kmbox_bin_encode(out, out_size, KMBOX_BIN_OP_LOCK_BUTTON, seq, payload, state < 0 ? 1 : 2);
+}
+
+size_t kmbox_bin_encode_buttons_cb(uint8_t* out, size_t out_size, uint8_t seq, int8_t state)
+{
+    const uint8_t payload[1] = { (uint8_t)state };
+    return kmbox_bin_encode(out, out_size, KMBOX_BIN_OP_BUTTONS_CB, seq, payload, state < 0 ? 0 : 1);
+}
+
+size_t kmbox_bin_encode_baud(uint8_t* out, size_t out_size, uint8_t seq, uint32_t baud)
+{
+    uint8_t payload[4];
+    kmbox_bin_put_u32(payload, baud);
+    return kmbox_bin_encode(out, out_size, KMBOX_BIN_OP_BAUD, seq, payload, 4);
+}
+
+size_t kmbox_bin_encode_drain(uint8_t* out, size_t out_size, uint8_t seq, int8_t mode, uint16_t param)
+{
+    uint8_t payload[3] = { (uint8_t)mode };
+    kmbox_bin_put_i16(&payload[1], (int16_t)param);
+    return kmbox_bin_encode(out, out_size, KMBOX_BIN_OP_DRAIN, seq, payload,
+                            mode < 0 ? 0 : (param ? 3 : 1));
+}
+
+size_t kmbox_bin_encode_move_paced(uint8_t* out, size_t out_size, uint8_t seq, int16_t x, int16_t y, uint16_t duration_ms)
+{
+    uint8_t payload[6];
+    kmbox_bin_put_i16(&payload[0], x);
+    kmbox_bin_put_i16(&payload[2], y);
+    kmbox_bin_put_i16(&payload[4], (int16_t)duration_ms);
+    return kmbox_bin_encode(out, out_size, KMBOX_BIN_OP_MOVE_PACED, seq, payload, 6);
+}
+
+size_t kmbox_bin_encode_move_cancel(uint8_t* out, size_t out_size, uint8_t seq)
+{
+    return kmbox_bin_encode(out, out_size, KMBOX_BIN_OP_MOVE_CANCEL, seq, NULL, 0);
+}
+
+size_t kmbox_bin_encode_response(uint8_t* out, size_t out_size, uint8_t op, uint8_t seq,
+                                 kmbox_bin_status_t status, int16_t value)
+{
+    const uint8_t payload[2] = { (uint8_t)status, (uint8_t)value };
+    return kmbox_bin_encode(out, out_size, op, seq, payload, value < 0 ? 1 : 2);
+}
@@ -0,0 +1,162 @@
+/*
+ * KMBox Binary Protocol
+ * Compact framed encoding of the km.* commands, shared by the firmware
+ * parser and host-side controllers
+ *
+ * Frame layout (all multi-byte values little-endian):
+ *
+ *   +------+--------------------+-----+-------------+-------+
+ *   | SYNC | HDR = LEN<<5 | OP  | SEQ | payload[LEN]| CRC-8 |
+ *   +------+--------------------+-----+-------------+-------+
+ *
+ * SYNC is 0xA5, which never starts an ASCII command, so binary frames and
+ * km.* text lines can be mixed on the same wire. The CRC-8 (poly 0x07,
+ * init 0x00) covers HDR, SEQ and the payload. A km.move(-123,45) costs
+ * 6 bytes as a MOVE8 frame instead of 18 bytes of text.
+ *
+ * Responses use the same framing: the opcode and sequence number of the
+ * request, followed by a status byte and an optional value byte.
+ */
+
+#ifndef KMBOX_PROTOCOL_H
+#define KMBOX_PROTOCOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+//--------------------------------------------------------------------+
+// Framing
+//--------------------------------------------------------------------+
+
+#define KMBOX_BIN_SYNC            0xA5
+#define KMBOX_BIN_MAX_PAYLOAD     7
+#define KMBOX_BIN_OVERHEAD        4   // SYNC + HDR + SEQ + CRC
+#define KMBOX_BIN_MAX_FRAME       (KMBOX_BIN_OVERHEAD + KMBOX_BIN_MAX_PAYLOAD)
+
+#define KMBOX_BIN_HDR(op, len)    ((uint8_t)(((len) << 5) | ((op) & 0x1F)))
+#define KMBOX_BIN_HDR_OP(hdr)     ((uint8_t)((hdr) & 0x1F))
+#define KMBOX_BIN_HDR_LEN(hdr)    ((uint8_t)((hdr) >> 5))
+
+// Opcodes (5 bits)
+typedef enum {
+    KMBOX_BIN_OP_MOVE        = 0x01,  // i16 x, i16 y
+    KMBOX_BIN_OP_MOVE8       = 0x02,  // i8 x, i8 y
+    KMBOX_BIN_OP_WHEEL       = 0x03,  // i8 amount
+    KMBOX_BIN_OP_BUTTON      = 0x04,  // u8 button, u8 state
+    KMBOX_BIN_OP_CLICK       = 0x05,  // u8 button [, u32 press duration in us]
+    KMBOX_BIN_OP_LOCK_AXIS   = 0x06,  // u8 axis (0=x, 1=y) [, u8 state]
+    KMBOX_BIN_OP_LOCK_BUTTON = 0x07,  // u8 button [, u8 state]
+    KMBOX_BIN_OP_BUTTONS_CB  = 0x08,  // [u8 state]
+    KMBOX_BIN_OP_BAUD        = 0x09,  // u32 baud rate
+    KMBOX_BIN_OP_DRAIN       = 0x0A,  // [u8 mode [, u16 param]]
+    KMBOX_BIN_OP_MOVE_PACED  = 0x0B,  // i16 x, i16 y, u16 duration in ms
+    KMBOX_BIN_OP_MOVE_CANCEL = 0x0C,  // (none), responds with the number cancelled
+} kmbox_bin_op_t;
+
+// Response status codes
+typedef enum {
+    KMBOX_BIN_STATUS_OK          = 0x00,
+    KMBOX_BIN_STATUS_BAD_ARGS    = 0x01,
+    KMBOX_BIN_STATUS_UNKNOWN_OP  = 0x02,
+} kmbox_bin_status_t;
+
+// Axis selectors for KMBOX_BIN_OP_LOCK_AXIS
+#define KMBOX_BIN_AXIS_X          0
+#define KMBOX_BIN_AXIS_Y          1
+
+typedef struct {
+    uint8_t op;
+    uint8_t seq;
+    uint8_t len;
+    uint8_t payload[KMBOX_BIN_MAX_PAYLOAD];
+} kmbox_bin_frame_t;
+
+//--------------------------------------------------------------------+
+// Streaming Decoder
+//--------------------------------------------------------------------+
+
+typedef enum {
+    KMBOX_BIN_NEED_MORE = 0,   // Frame incomplete, keep feeding
+    KMBOX_BIN_FRAME_READY,     // A valid frame was decoded
+    KMBOX_BIN_CRC_ERROR,       // Frame completed with a bad CRC and was dropped
+} kmbox_bin_result_t;
+
+typedef struct {
+    uint8_t state;
+    uint8_t crc;
+    uint8_t pos;
+    kmbox_bin_frame_t frame;
+} kmbox_bin_decoder_t;
+
+// Reset the decoder to wait for a SYNC byte
+void kmbox_bin_decoder_reset(kmbox_bin_decoder_t* dec);
+
+// Feed one byte. Bytes outside a frame are ignored until SYNC is seen.
+// On KMBOX_BIN_FRAME_READY the decoded frame is available in dec->frame.
+kmbox_bin_result_t kmbox_bin_decoder_feed(kmbox_bin_decoder_t* dec, uint8_t byte);
+
+// True while the decoder is in the middle of a frame
+bool kmbox_bin_decoder_busy(const kmbox_bin_decoder_t* dec);
+
+//--------------------------------------------------------------------+
+// Encoder
+//--------------------------------------------------------------------+
+
+// CRC-8 (poly 0x07) over a byte range, continuing from crc
+uint8_t kmbox_bin_crc8(uint8_t crc, const uint8_t* data, size_t len);
+
+// Encode a generic frame into out. Returns the frame length, or 0 if the
+// payload is too long or out is too small.
+size_t kmbox_bin_encode(uint8_t* out, size_t out_size, uint8_t op, uint8_t seq,
+                        const uint8_t* payload, uint8_t len);
+
+// Command encoders. kmbox_bin_encode_move() picks MOVE8 when both deltas
+// fit in a signed byte. state < 0 encodes a query (no state argument).
+// press_us = 0 encodes a click with the firmware's random press duration.
+// For drain, mode < 0 encodes a query and param = 0 the mode's default.
+size_t kmbox_bin_encode_move(uint8_t* out, size_t out_size, uint8_t seq, int16_t x, int16_t y);
+size_t kmbox_bin_encode_wheel(uint8_t* out, size_t out_size, uint8_t seq, int8_t amount);
+size_t kmbox_bin_encode_button(uint8_t* out, size_t out_size, uint8_t seq, uint8_t button, bool pressed);
+size_t kmbox_bin_encode_click(uint8_t* out, size_t out_size, uint8_t seq, uint8_t button, uint32_t press_us);
+size_t kmbox_bin_encode_lock_axis(uint8_t* out, size_t out_size, uint8_t seq, uint8_t axis, int8_t state);
+size_t kmbox_bin_encode_lock_button(uint8_t* out, size_t out_size, uint8_t seq, uint8_t button, int8_t state);
+size_t kmbox_bin_encode_buttons_cb(uint8_t* out, size_t out_size, uint8_t seq, int8_t state);
+size_t kmbox_bin_encode_baud(uint8_t* out, size_t out_size, uint8_t seq, uint32_t baud);
+size_t kmbox_bin_encode_drain(uint8_t* out, size_t out_size, uint8_t seq, int8_t mode, uint16_t param);
+size_t kmbox_bin_encode_move_paced(uint8_t* out, size_t out_size, uint8_t seq, int16_t x, int16_t y, uint16_t duration_ms);
+size_t kmbox_bin_encode_move_cancel(uint8_t* out, size_t out_size, uint8_t seq);
+
+// Encode a response frame: status plus an optional value byte (value < 0 omits it)
+size_t kmbox_bin_encode_response(uint8_t* out, size_t out_size, uint8_t op, uint8_t seq,
+                                 kmbox_bin_status_t status, int16_t value);
+
+//--------------------------------------------------------------------+
+// Little-endian helpers
+//--------------------------------------------------------------------+
+
+static inline int16_t kmbox_bin_get_i16(const uint8_t* p)
+{
+    return (int16_t)((uint16_t)p[0] | ((uint16_t)p[1] << 8));
+}
+
+static inline void kmbox_bin_put_i16(uint8_t* p, int16_t v)
+{
+    p[0] = (uint8_t)((uint16_t)v & 0xFF);
+    p[1] = (uint8_t)((uint16_t)v >> 8);
+}
+
+static inline uint32_t kmbox_bin_get_u32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void kmbox_bin_put_u32(uint8_t* p, uint32_t v)
+{
+    p[0] = (uint8_t)(v & 0xFF);
+    p[1] = (uint8_t)((v >> 8) & 0xFF);
+    p[2] = (uint8_t)((v >> 16) & 0xFF);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+#endif // KMBOX_PROTOCOL_H
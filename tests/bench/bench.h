@@ -0,0 +1,42 @@
+/*
+ * Micro-benchmark harness for the host build
+ *
+ * A benchmark runs its operation a given number of times; the runner times
+ * the whole run and reports nanoseconds (and on x86-64 TSC cycles) per
+ * operation. Each benchmark runs in its own process after its setup, so
+ * the firmware's static state starts fresh.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct {
+    const char* name;
+    uint64_t iterations;            // Operations per run (divided down by --quick)
+    void (*setup)(void);            // Untimed, may be NULL
+    void (*run)(uint64_t iterations);
+} bench_case_t;
+
+typedef struct {
+    const char* name;
+    const bench_case_t* cases;      // Terminated by an entry with a NULL name
+} bench_group_t;
+
+#define BENCH_END                       { NULL, 0, NULL, NULL }
+
+// Keep a computed value alive so the operation is not optimized away
+static inline void bench_consume(uint64_t value)
+{
+    __asm__ volatile("" : : "r"(value) : "memory");
+}
+
+// Groups, registered in bench_main.c
+extern const bench_group_t bench_group_passthrough;
+extern const bench_group_t bench_group_commands;
+extern const bench_group_t bench_group_commands_baseline;
+extern const bench_group_t bench_group_buttons;
+
+#endif // BENCH_H
@@ -0,0 +1,88 @@
+/*
+ * Button engine benchmarks: cost of one kmbox_update_states() call, the
+ * per-pass button timing in the main loop, and of following a physical
+ * button report
+ */
+
+#include "bench.h"
+#include "kmbox_commands.h"
+#include <string.h>
+
+#define NOW_US          1000000u
+#define SECOND_US       1000000u
+
+static void discard_output(const char* data, size_t len)
+{
+    (void)data;
+    (void)len;
+}
+
+static void send_line(const char* line, uint64_t now_us)
+{
+    kmbox_process_serial_data((const uint8_t*)line, strlen(line), now_us);
+}
+
+static void setup_idle(void)
+{
+    kmbox_commands_init();
+    kmbox_commands_set_output(discard_output);
+    kmbox_set_echo_mode(KMBOX_ECHO_SILENT);
+}
+
+// A click running on every named button, far from expiring
+static void setup_clicking(void)
+{
+    setup_idle();
+    send_line("km.click(0,5000)\r\nkm.click(1,5000)\r\nkm.click(2,5000)\r\n"
+              "km.click(3,5000)\r\nkm.click(4,5000)\r\n", NOW_US);
+}
+
+// Held buttons with the km.buttons() change callback on
+static void setup_callback(void)
+{
+    setup_idle();
+    send_line("km.buttons(1)\r\nkm.left(1)\r\nkm.side2(1)\r\n", NOW_US);
+}
+
+// The clock advances 1 us per 64 calls, about the rate of a busy main loop,
+// so the clicks above stay in their press phase
+static void run_update(uint64_t iterations)
+{
+    for (uint64_t i = 0; i < iterations; i++) {
+        kmbox_update_states(NOW_US + i / 64);
+    }
+    bench_consume(kmbox_get_button_mask());
+}
+
+// Press and release phase of a click both expire: arms a click each time,
+// so this includes the cost of commands/click
+static void run_update_expiry(uint64_t iterations)
+{
+    uint64_t now = NOW_US;
+    for (uint64_t i = 0; i < iterations; i++) {
+        send_line("km.click(0)\r\n", now);
+        kmbox_update_states(now + SECOND_US);
+        kmbox_update_states(now + 2 * SECOND_US);
+        now += 2 * SECOND_US;
+    }
+    bench_consume(kmbox_get_button_mask());
+}
+
+static void run_physical(uint64_t iterations)
+{
+    for (uint64_t i = 0; i < iterations; i++) {
+        kmbox_update_physical_buttons((kmbox_buttons_t)(i & KMBOX_BUTTONS_ALL));
+    }
+    bench_consume(kmbox_get_button_mask());
+}
+
+static const bench_case_t cases[] = {
+    { "update_idle", 20000000, setup_idle, run_update },
+    { "update_clicking", 20000000, setup_clicking, run_update },
+    { "update_callback", 20000000, setup_callback, run_update },
+    { "update_expiry", 2000000, setup_idle, run_update_expiry },
+    { "physical", 20000000, setup_idle, run_physical },
+    BENCH_END
+};
+
+const bench_group_t bench_group_buttons = { "buttons", cases };
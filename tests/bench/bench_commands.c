@@ -0,0 +1,124 @@
+/*
+ * Command benchmarks: cost of one command through the kmbox-commands
+ * parser and dispatcher, per command type
+ *
+ * Text commands are handed over as whole lines with their terminator, the
+ * way the DMA ring transport delivers them; the *_bytes cases feed the same
+ * line one byte at a time instead. Responses go to a discarding sink.
+ */
+
+#include "bench.h"
+#include "kmbox_commands.h"
+#include "kmbox_protocol.h"
+#include <string.h>
+
+#define NOW_US          1000000u
+
+static void discard_output(const char* data, size_t len)
+{
+    (void)data;
+    (void)len;
+}
+
+static void setup_parser(void)
+{
+    kmbox_commands_init();
+    kmbox_commands_set_output(discard_output);
+    kmbox_set_echo_mode(KMBOX_ECHO_SILENT);
+}
+
+static void run_line(const char* line, uint64_t iterations)
+{
+    const size_t len = strlen(line);
+    for (uint64_t i = 0; i < iterations; i++) {
+        kmbox_process_serial_data((const uint8_t*)line, len, NOW_US + i);
+    }
+    bench_consume(kmbox_get_command_count());
+}
+
+static void run_bytes(const char* line, uint64_t iterations)
+{
+    const size_t len = strlen(line);
+    for (uint64_t i = 0; i < iterations; i++) {
+        for (size_t j = 0; j < len; j++) {
+            kmbox_process_serial_char(line[j], NOW_US + i);
+        }
+    }
+    bench_consume(kmbox_get_command_count());
+}
+
+static void run_frame(const uint8_t* frame, size_t len, uint64_t iterations)
+{
+    for (uint64_t i = 0; i < iterations; i++) {
+        kmbox_process_serial_data(frame, len, NOW_US + i);
+    }
+    bench_consume(kmbox_get_command_count());
+}
+
+static void run_move(uint64_t n)          { run_line("km.move(-123,45)\r\n", n); }
+static void run_move_bytes(uint64_t n)    { run_bytes("km.move(-123,45)\r\n", n); }
+static void run_wheel(uint64_t n)         { run_line("km.wheel(-1)\r\n", n); }
+static void run_button(uint64_t n)        { run_line("km.left(1)\r\n", n); }
+static void run_button_query(uint64_t n)  { run_line("km.left()\r\n", n); }
+static void run_click(uint64_t n)         { run_line("km.click(0)\r\n", n); }
+static void run_lock(uint64_t n)          { run_line("km.lock_mx(0)\r\n", n); }
+static void run_lock_button(uint64_t n)   { run_line("km.lock_ms1(0)\r\n", n); }
+static void run_buttons_cb(uint64_t n)    { run_line("km.buttons(0)\r\n", n); }
+static void run_drain(uint64_t n)         { run_line("km.drain(0)\r\n", n); }
+static void run_unknown(uint64_t n)       { run_line("km.bogus(1)\r\n", n); }
+static void run_move_bytes_lf(uint64_t n) { run_bytes("km.move(-123,45)\n", n); }
+
+// The queue holds eight moves; empty it before it fills so every command
+// is accepted
+static void run_move_paced(uint64_t iterations)
+{
+    const char* line = "km.move(10,10,5)\r\n";
+    const size_t len = strlen(line);
+    for (uint64_t i = 0; i < iterations; i++) {
+        kmbox_process_serial_data((const uint8_t*)line, len, NOW_US);
+        if ((i % KMBOX_PACED_MOVE_QUEUE) == KMBOX_PACED_MOVE_QUEUE - 1) {
+            kmbox_cancel_paced_moves();
+        }
+    }
+    bench_consume(kmbox_get_command_count());
+}
+
+static void run_bin_move8(uint64_t n)
+{
+    uint8_t frame[KMBOX_BIN_MAX_FRAME];
+    run_frame(frame, kmbox_bin_encode_move(frame, sizeof(frame), 0, -123, 45), n);
+}
+
+static void run_bin_move(uint64_t n)
+{
+    uint8_t frame[KMBOX_BIN_MAX_FRAME];
+    run_frame(frame, kmbox_bin_encode_move(frame, sizeof(frame), 0, -1234, 456), n);
+}
+
+static void run_bin_button(uint64_t n)
+{
+    uint8_t frame[KMBOX_BIN_MAX_FRAME];
+    run_frame(frame, kmbox_bin_encode_button(frame, sizeof(frame), 0, KMBOX_BUTTON_LEFT, true), n);
+}
+
+static const bench_case_t cases[] = {
+    { "move", 2000000, setup_parser, run_move },
+    { "move_bytes", 2000000, setup_parser, run_move_bytes },
+    { "move_bytes_lf", 2000000, setup_parser, run_move_bytes_lf },
+    { "move_paced", 2000000, setup_parser, run_move_paced },
+    { "wheel", 2000000, setup_parser, run_wheel },
+    { "button", 2000000, setup_parser, run_button },
+    { "button_query", 2000000, setup_parser, run_button_query },
+    { "click", 2000000, setup_parser, run_click },
+    { "lock_axis", 2000000, setup_parser, run_lock },
+    { "lock_button", 2000000, setup_parser, run_lock_button },
+    { "buttons_cb", 2000000, setup_parser, run_buttons_cb },
+    { "drain", 2000000, setup_parser, run_drain },
+    { "unknown", 2000000, setup_parser, run_unknown },
+    { "bin_move8", 2000000, setup_parser, run_bin_move8 },
+    { "bin_move", 2000000, setup_parser, run_bin_move },
+    { "bin_button", 2000000, setup_parser, run_bin_button },
+    BENCH_END
+};
+
+const bench_group_t bench_group_commands = { "commands", cases };
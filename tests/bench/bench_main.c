@@ -0,0 +1,129 @@
+/*
+ * Host benchmark runner
+ *
+ * Usage: piokmbox_bench [--quick] [group [benchmark]]
+ * --quick runs a thousandth of the iterations; ctest uses it to check the
+ * benchmarks still run. Numbers come from the host CPU and are meant for
+ * comparing changes, not for predicting RP2040 timings.
+ */
+
+#include "bench.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC 1
+#else
+#define BENCH_HAVE_TSC 0
+#endif
+
+static const bench_group_t* const g_groups[] = {
+    &bench_group_passthrough,
+    &bench_group_commands,
+    &bench_group_commands_baseline,
+    &bench_group_buttons,
+};
+
+#define GROUP_COUNT (sizeof(g_groups) / sizeof(g_groups[0]))
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t now_cycles(void)
+{
+#if BENCH_HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static void run_case(const bench_group_t* group, const bench_case_t* bc, bool quick)
+{
+    uint64_t iterations = quick ? bc->iterations / 1000 : bc->iterations;
+    if (iterations == 0) {
+        iterations = 1;
+    }
+
+    if (bc->setup != NULL) {
+        bc->setup();
+    }
+
+    const uint64_t start_ns = now_ns();
+    const uint64_t start_cycles = now_cycles();
+    bc->run(iterations);
+    const uint64_t cycles = now_cycles() - start_cycles;
+    const uint64_t ns = now_ns() - start_ns;
+
+    char name[64];
+    snprintf(name, sizeof(name), "%s.%s", group->name, bc->name);
+    fprintf(stderr, "%-40s %10llu ops %10.1f ns/op", name, (unsigned long long)iterations,
+            (double)ns / (double)iterations);
+    if (BENCH_HAVE_TSC) {
+        fprintf(stderr, " %10.1f cycles/op", (double)cycles / (double)iterations);
+    }
+    fprintf(stderr, "\n");
+}
+
+int main(int argc, char** argv)
+{
+    bool quick = false;
+    int arg = 1;
+    if (arg < argc && strcmp(argv[arg], "--quick") == 0) {
+        quick = true;
+        arg++;
+    }
+    const char* group_filter = (arg < argc) ? argv[arg++] : NULL;
+    const char* case_filter = (arg < argc) ? argv[arg++] : NULL;
+    unsigned run = 0;
+    unsigned failed = 0;
+
+    for (size_t g = 0; g < GROUP_COUNT; g++) {
+        const bench_group_t* group = g_groups[g];
+        if (group_filter != NULL && strcmp(group_filter, group->name) != 0) {
+            continue;
+        }
+        for (const bench_case_t* bc = group->cases; bc->name != NULL; bc++) {
+            if (case_filter != NULL && strcmp(case_filter, bc->name) != 0) {
+                continue;
+            }
+            run++;
+
+            fflush(stderr);
+            const pid_t pid = fork();
+            if (pid < 0) {
+                perror("fork");
+                return 1;
+            }
+            if (pid == 0) {
+                // Firmware logging would dominate the timings
+                if (freopen("/dev/null", "w", stdout) == NULL) {
+                    exit(2);
+                }
+                run_case(group, bc, quick);
+                exit(0);
+            }
+            int status = 0;
+            if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                fprintf(stderr, "%s.%s: failed\n", group->name, bc->name);
+                failed++;
+            }
+        }
+    }
+
+    if (run == 0) {
+        fprintf(stderr, "no benchmarks matched\n");
+        return 1;
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,56 @@
+/*
+ * Passthrough benchmarks: cost of one host mouse report on its way from
+ * the host stack callback to the kmbox accumulators
+ */
+
+#include "bench.h"
+#include "fake_firmware.h"
+#include "fake_tusb.h"
+#include "usb_hid.h"
+#include "pico/stdlib.h"
+
+#define MOUSE_DEV 1
+
+static const uint8_t boot_mouse_desc[] = {
+    TUD_HID_REPORT_DESC_MOUSE()
+};
+
+static void setup_mouse(void)
+{
+    fake_firmware_init();
+    fake_host_attach(MOUSE_DEV, 0, 0x046D, 0xC077, HID_ITF_PROTOCOL_MOUSE,
+                     boot_mouse_desc, sizeof(boot_mouse_desc));
+    fake_firmware_run_for(FAKE_FIRMWARE_ATTACH_SETTLE_US, 50);
+}
+
+// core1 decode and queue, then the core0 merge; the endpoint stays busy
+// after the first report, so this is the steady-state merge path
+static void run_host_mouse_report(uint64_t iterations)
+{
+    const uint64_t now_us = time_us_64();
+    uint8_t report[] = { 0x00, 1, 0, 0, 0 };
+    for (uint64_t i = 0; i < iterations; i++) {
+        report[1] = (uint8_t)(i & 7);
+        tuh_hid_report_received_cb(MOUSE_DEV, 0, report, sizeof(report));
+        hid_host_task(now_us);
+    }
+}
+
+// Core0 merge only, with an already decoded report
+static void run_process_mouse_report(uint64_t iterations)
+{
+    const uint64_t now_us = time_us_64();
+    hid_mouse_report_wide_t report = { .buttons = 0, .x = 3, .y = -2 };
+    for (uint64_t i = 0; i < iterations; i++) {
+        report.buttons = (uint8_t)(i & 1);
+        process_mouse_report(&report, now_us);
+    }
+}
+
+static const bench_case_t cases[] = {
+    { "host_mouse_report", 2000000, setup_mouse, run_host_mouse_report },
+    { "process_mouse_report", 2000000, setup_mouse, run_process_mouse_report },
+    BENCH_END
+};
+
+const bench_group_t bench_group_passthrough = { "passthrough", cases };
@@ -0,0 +1,20 @@
+/*
+ * Host fakes for the board peripherals the firmware logic signals: the
+ * status LED and the neopixel effects do nothing on the host
+ */
+
+#include "led_control.h"
+
+void led_set_blink_interval(uint32_t interval_ms) { (void)interval_ms; }
+
+void neopixel_update_status(void) {}
+void neopixel_trigger_mouse_activity(void) {}
+void neopixel_trigger_keyboard_activity(void) {}
+void neopixel_trigger_caps_lock_flash(void) {}
+void neopixel_trigger_usb_connection_flash(void) {}
+void neopixel_trigger_usb_disconnection_flash(void) {}
+void neopixel_trigger_usb_reset_pending(void) {}
+void neopixel_trigger_usb_reset_success(void) {}
+void neopixel_trigger_usb_reset_failed(void) {}
+void neopixel_trigger_rainbow_effect(void) {}
+void neopixel_rainbow_on_movement(int16_t dx, int16_t dy) { (void)dx; (void)dy; }
@@ -0,0 +1,68 @@
+/*
+ * Host harness around the firmware logic
+ */
+
+#include "fake_firmware.h"
+#include "fake_sdk.h"
+#include "fake_tusb.h"
+#include "fake_uart.h"
+#include "usb_hid.h"
+#include "kmbox_serial_handler.h"
+#include "defines.h"
+#include "pico/stdlib.h"
+
+void fake_firmware_init(void)
+{
+    fake_sdk_reset();
+    fake_usb_reset();
+    fake_uart_reset();
+
+    // PIOKMbox.c: core1 configures the host stack, core0 brings up the
+    // serial handler, the HID module and then the device stack
+    tuh_init(USB_HOST_PORT);
+    kmbox_serial_init();
+    usb_hid_init();
+    tud_init(USB_DEVICE_PORT);
+    usb_device_mark_initialized();
+    tud_sof_cb_enable(HID_SOF_SYNC_ENABLED);
+    usb_host_mark_initialized();
+
+    fake_usb_device_attach();
+    fake_firmware_loop_once();
+}
+
+void fake_firmware_loop_once(void)
+{
+    fake_usb_run_until(time_us_64());
+
+    // core1: host stack, completes control transfers such as SET_PROTOCOL
+    fake_set_core_num(1);
+    tuh_task();
+    fake_set_core_num(0);
+
+    tud_task();
+    const uint64_t now_us = time_us_64();
+    hid_device_task(now_us);
+    hid_host_task(now_us);
+    kmbox_serial_task(now_us);
+}
+
+void fake_firmware_run_until(uint64_t end_us, uint32_t loop_us)
+{
+    if (loop_us == 0) {
+        loop_us = 1;
+    }
+    while (time_us_64() < end_us) {
+        uint64_t step = end_us - time_us_64();
+        if (step > loop_us) {
+            step = loop_us;
+        }
+        fake_time_advance_us(step);
+        fake_firmware_loop_once();
+    }
+}
+
+void fake_firmware_run_for(uint64_t duration_us, uint32_t loop_us)
+{
+    fake_firmware_run_until(time_us_64() + duration_us, loop_us);
+}
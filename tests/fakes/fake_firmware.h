@@ -0,0 +1,34 @@
+/*
+ * Host harness around the firmware logic
+ *
+ * Brings up the pieces the host build links in the order PIOKMbox.c does
+ * and runs the core0 main loop against the virtual clock and bus. Shared by
+ * the unit tests, the benchmarks and tools/kmbox_sim.c.
+ */
+
+#ifndef FAKE_FIRMWARE_H
+#define FAKE_FIRMWARE_H
+
+#include <stdint.h>
+#include "defines.h"
+
+// Time for a newly attached host device to take effect: the device stack
+// re-enumerates with its VID/PID and is mounted again
+#define FAKE_FIRMWARE_ATTACH_SETTLE_US  ((uint64_t)USB_REENUM_DISCONNECT_MS * 1000u + 20000u)
+
+// Reset all fakes, initialize the serial handler and USB HID module, attach
+// the device to the virtual host and run the loop until it is mounted
+void fake_firmware_init(void);
+
+// One pass of the core0 main loop at the current virtual time: tud_task(),
+// hid_device_task(), hid_host_task(), kmbox_serial_task()
+void fake_firmware_loop_once(void);
+
+// Advance the virtual clock to end_us in steps of loop_us, generating bus
+// events and running one main loop pass per step
+void fake_firmware_run_until(uint64_t end_us, uint32_t loop_us);
+
+// Same, for a duration from now
+void fake_firmware_run_for(uint64_t duration_us, uint32_t loop_us);
+
+#endif // FAKE_FIRMWARE_H
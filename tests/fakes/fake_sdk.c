@@ -0,0 +1,161 @@
+/*
+ * Host fakes for the Pico SDK: virtual clock, GPIO, interrupts, clocks
+ */
+
+#include "fake_sdk.h"
+#include "pico/stdlib.h"
+#include "pico/unique_id.h"
+#include "hardware/sync.h"
+#include "hardware/clocks.h"
+#include <string.h>
+
+#define FAKE_GPIO_COUNT                 30
+#define FAKE_CLK_PERI_HZ                125000000u
+
+static uint64_t g_now_us = FAKE_TIME_START_US;
+static bool g_gpio_level[FAKE_GPIO_COUNT];
+static bool g_gpio_output[FAKE_GPIO_COUNT];
+static unsigned int g_core_num = 0;
+
+void fake_sdk_reset(void)
+{
+    g_now_us = FAKE_TIME_START_US;
+    memset(g_gpio_level, 0, sizeof(g_gpio_level));
+    memset(g_gpio_output, 0, sizeof(g_gpio_output));
+    g_core_num = 0;
+}
+
+//--------------------------------------------------------------------+
+// Time
+//--------------------------------------------------------------------+
+
+void fake_time_set_us(uint64_t now_us)
+{
+    g_now_us = now_us;
+}
+
+void fake_time_advance_us(uint64_t delta_us)
+{
+    g_now_us += delta_us;
+}
+
+uint64_t time_us_64(void)
+{
+    return g_now_us;
+}
+
+uint32_t time_us_32(void)
+{
+    return (uint32_t)g_now_us;
+}
+
+absolute_time_t get_absolute_time(void)
+{
+    return g_now_us;
+}
+
+uint32_t to_ms_since_boot(absolute_time_t t)
+{
+    return (uint32_t)(t / 1000u);
+}
+
+uint64_t to_us_since_boot(absolute_time_t t)
+{
+    return t;
+}
+
+void sleep_ms(uint32_t ms)
+{
+    g_now_us += (uint64_t)ms * 1000u;
+}
+
+void sleep_us(uint64_t us)
+{
+    g_now_us += us;
+}
+
+void busy_wait_us_32(uint32_t us)
+{
+    g_now_us += us;
+}
+
+//--------------------------------------------------------------------+
+// GPIO
+//--------------------------------------------------------------------+
+
+void fake_gpio_set_input(unsigned int gpio, bool level)
+{
+    if (gpio < FAKE_GPIO_COUNT) {
+        g_gpio_level[gpio] = level;
+    }
+}
+
+bool fake_gpio_get_output(unsigned int gpio)
+{
+    return gpio < FAKE_GPIO_COUNT && g_gpio_output[gpio];
+}
+
+void gpio_init(unsigned int gpio)
+{
+    (void)gpio;
+}
+
+void gpio_set_dir(unsigned int gpio, bool out)
+{
+    (void)gpio;
+    (void)out;
+}
+
+void gpio_put(unsigned int gpio, bool value)
+{
+    if (gpio < FAKE_GPIO_COUNT) {
+        g_gpio_output[gpio] = value;
+    }
+}
+
+bool gpio_get(unsigned int gpio)
+{
+    return gpio < FAKE_GPIO_COUNT && g_gpio_level[gpio];
+}
+
+void gpio_pull_up(unsigned int gpio)
+{
+    fake_gpio_set_input(gpio, true);
+}
+
+//--------------------------------------------------------------------+
+// Interrupts, cores, clocks, board ID
+//--------------------------------------------------------------------+
+
+uint32_t save_and_disable_interrupts(void)
+{
+    return 0;
+}
+
+void restore_interrupts(uint32_t status)
+{
+    (void)status;
+}
+
+void fake_set_core_num(unsigned int core)
+{
+    g_core_num = core & 1u;
+}
+
+unsigned int get_core_num(void)
+{
+    return g_core_num;
+}
+
+uint32_t clock_get_hz(enum clock_index clk_index)
+{
+    return (clk_index == clk_usb) ? 48000000u : FAKE_CLK_PERI_HZ;
+}
+
+void pico_get_unique_board_id(pico_unique_board_id_t* id_out)
+{
+    static const uint8_t id[PICO_UNIQUE_BOARD_ID_SIZE_BYTES] = {
+        0xE6, 0x61, 0x38, 0x52, 0x83, 0x4A, 0x2B, 0x29
+    };
+    memcpy(id_out->id, id, sizeof(id));
+}
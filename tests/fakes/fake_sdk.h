@@ -0,0 +1,28 @@
+/*
+ * Host fakes for the Pico SDK: test control interface
+ */
+
+#ifndef FAKE_SDK_H
+#define FAKE_SDK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Virtual clock behind time_us_64() and friends. Starts at 1 s so that
+// timestamps of zero ("never") are not confused with real ones.
+#define FAKE_TIME_START_US              1000000ULL
+
+void fake_time_set_us(uint64_t now_us);
+void fake_time_advance_us(uint64_t delta_us);
+
+// Level returned by gpio_get() for a pin
+void fake_gpio_set_input(unsigned int gpio, bool level);
+bool fake_gpio_get_output(unsigned int gpio);
+
+// Core reported by get_core_num() (0 or 1)
+void fake_set_core_num(unsigned int core);
+
+// Restore the clock, GPIOs and core number to their reset state
+void fake_sdk_reset(void);
+
+#endif // FAKE_SDK_H
@@ -0,0 +1,538 @@
+/*
+ * Host fake of TinyUSB: device endpoint model and attached host devices
+ */
+
+#include "fake_tusb.h"
+#include "fake_sdk.h"
+#include "tusb.h"
+#include "pico/time.h"
+#include "hardware/sync.h"
+#include "usb_hid.h"
+#include "defines.h"
+#include <string.h>
+
+//--------------------------------------------------------------------+
+// Device side
+//--------------------------------------------------------------------+
+
+typedef enum {
+    DEV_EVENT_MOUNT = 0,
+    DEV_EVENT_UNMOUNT,
+    DEV_EVENT_SOF,
+    DEV_EVENT_XFER_COMPLETE
+} dev_event_type_t;
+
+typedef struct {
+    uint8_t type;
+    uint32_t frame;
+    uint8_t len;
+    uint8_t data[FAKE_USB_REPORT_MAX];
+} dev_event_t;
+
+#define DEV_EVENT_QUEUE_SIZE            256
+
+typedef struct {
+    bool attached;              // Pull-up connected
+    bool mounted;
+    bool suspended;
+    bool sof_cb_enabled;
+    uint32_t connects;
+    uint32_t core1_calls;       // Device stack calls made from core1
+
+    uint64_t bus_time_us;       // Bus events generated up to here
+    uint32_t frames;
+    uint32_t poll_offset_us;
+    bool in_token_done;         // IN token of the current frame already sent
+
+    bool armed;                 // Report waiting for the IN token
+    fake_usb_report_t pending;
+
+    dev_event_t events[DEV_EVENT_QUEUE_SIZE];
+    uint32_t event_head;
+    uint32_t event_tail;
+
+    fake_usb_report_t log[FAKE_USB_REPORT_LOG];
+    size_t log_count;
+    fake_usb_report_hook_t hook;
+
+    uint8_t host_desc[CFG_TUD_HID_EP_BUFSIZE * 8];
+    uint16_t host_desc_len;
+} fake_device_t;
+
+static fake_device_t g_dev;
+
+static void dev_event_push(uint8_t type, uint32_t frame, const uint8_t* data, uint8_t len)
+{
+    if (g_dev.event_head - g_dev.event_tail >= DEV_EVENT_QUEUE_SIZE) {
+        return; // Like an overflowing TinyUSB event queue
+    }
+    dev_event_t* ev = &g_dev.events[g_dev.event_head % DEV_EVENT_QUEUE_SIZE];
+    ev->type = type;
+    ev->frame = frame;
+    ev->len = len;
+    if (data != NULL && len > 0) {
+        memcpy(ev->data, data, len);
+    }
+    g_dev.event_head++;
+}
+
+// The virtual host collects the armed report in the current frame
+static void dev_in_token(void)
+{
+    g_dev.in_token_done = true;
+    if (!g_dev.armed) {
+        return;
+    }
+    g_dev.armed = false;
+
+    fake_usb_report_t* report = &g_dev.pending;
+    report->frame = g_dev.frames;
+    report->sent_us = g_dev.bus_time_us;
+    if (g_dev.log_count < FAKE_USB_REPORT_LOG) {
+        g_dev.log[g_dev.log_count++] = *report;
+    }
+    if (g_dev.hook != NULL) {
+        g_dev.hook(report);
+    }
+
+    // TinyUSB hands the report without its ID to the complete callback
+    dev_event_push(DEV_EVENT_XFER_COMPLETE, report->frame, report->data, report->len);
+}
+
+void fake_usb_reset(void)
+{
+    memset(&g_dev, 0, sizeof(g_dev));
+    g_dev.bus_time_us = time_us_64() - time_us_64() % USB_FRAME_US;
+}
+
+void fake_usb_device_attach(void)
+{
+    g_dev.attached = true;
+    g_dev.connects++;
+    dev_event_push(DEV_EVENT_MOUNT, g_dev.frames, NULL, 0);
+}
+
+void fake_usb_set_suspended(bool suspended)
+{
+    g_dev.suspended = suspended;
+}
+
+void fake_usb_set_poll_offset_us(uint32_t offset_us)
+{
+    g_dev.poll_offset_us = offset_us % USB_FRAME_US;
+}
+
+void fake_usb_run_until(uint64_t now_us)
+{
+    while (g_dev.bus_time_us < now_us) {
+        const uint64_t frame_start = g_dev.bus_time_us - g_dev.bus_time_us % USB_FRAME_US;
+        const uint64_t token_us = frame_start + g_dev.poll_offset_us;
+        const uint64_t next_sof_us = frame_start + USB_FRAME_US;
+
+        if (!g_dev.in_token_done && token_us >= g_dev.bus_time_us && token_us <= now_us) {
+            g_dev.bus_time_us = token_us;
+            if (g_dev.mounted && !g_dev.suspended) {
+                dev_in_token();
+            }
+            g_dev.in_token_done = true;
+            continue;
+        }
+        if (next_sof_us > now_us) {
+            g_dev.bus_time_us = now_us;
+            break;
+        }
+
+        g_dev.bus_time_us = next_sof_us;
+        g_dev.in_token_done = false;
+        if (g_dev.mounted && !g_dev.suspended) {
+            g_dev.frames++;
+            if (g_dev.sof_cb_enabled) {
+                dev_event_push(DEV_EVENT_SOF, g_dev.frames, NULL, 0);
+            }
+        }
+    }
+}
+
+uint32_t fake_usb_frame_count(void)
+{
+    return g_dev.frames;
+}
+
+size_t fake_usb_report_count(void)
+{
+    return g_dev.log_count;
+}
+
+const fake_usb_report_t* fake_usb_report(size_t index)
+{
+    return (index < g_dev.log_count) ? &g_dev.log[index] : NULL;
+}
+
+const fake_usb_report_t* fake_usb_last_report(void)
+{
+    return (g_dev.log_count > 0) ? &g_dev.log[g_dev.log_count - 1] : NULL;
+}
+
+void fake_usb_clear_reports(void)
+{
+    g_dev.log_count = 0;
+}
+
+void fake_usb_set_report_hook(fake_usb_report_hook_t hook)
+{
+    g_dev.hook = hook;
+}
+
+uint32_t fake_usb_connect_count(void)
+{
+    return g_dev.connects;
+}
+
+uint32_t fake_usb_core1_call_count(void)
+{
+    return g_dev.core1_calls;
+}
+
+// The device stack belongs to core0
+static void dev_check_core(void)
+{
+    if (get_core_num() != 0) {
+        g_dev.core1_calls++;
+    }
+}
+
+const uint8_t* fake_usb_host_report_descriptor(uint16_t* len)
+{
+    *len = g_dev.host_desc_len;
+    return g_dev.host_desc;
+}
+
+// Enumeration as seen by the virtual host: read the configuration and the
+// report descriptor it declares
+static void dev_enumerate(void)
+{
+    const uint8_t* config = tud_descriptor_configuration_cb(0);
+    const uint16_t report_len = (uint16_t)(config[TUD_CONFIG_DESC_LEN + 9 + 7] |
+                                           (config[TUD_CONFIG_DESC_LEN + 9 + 8] << 8));
+    const uint8_t* report = tud_hid_descriptor_report_cb(0);
+
+    g_dev.host_desc_len = (report_len <= sizeof(g_dev.host_desc)) ? report_len : 0;
+    memcpy(g_dev.host_desc, report, g_dev.host_desc_len);
+}
+
+void tud_task(void)
+{
+    while (g_dev.event_tail != g_dev.event_head) {
+        dev_event_t ev = g_dev.events[g_dev.event_tail % DEV_EVENT_QUEUE_SIZE];
+        g_dev.event_tail++;
+
+        switch (ev.type) {
+        case DEV_EVENT_MOUNT:
+            if (g_dev.attached && !g_dev.mounted) {
+                dev_enumerate();
+                g_dev.mounted = true;
+                tud_mount_cb();
+            }
+            break;
+        case DEV_EVENT_UNMOUNT:
+            tud_umount_cb();
+            break;
+        case DEV_EVENT_SOF:
+            if (g_dev.mounted && g_dev.sof_cb_enabled) {
+                tud_sof_cb(ev.frame);
+            }
+            break;
+        case DEV_EVENT_XFER_COMPLETE:
+            if (g_dev.mounted) {
+                tud_hid_report_complete_cb(0, ev.data, ev.len);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+bool tud_init(uint8_t rhport)
+{
+    (void)rhport;
+    return true;
+}
+
+bool tud_mounted(void)
+{
+    return g_dev.mounted;
+}
+
+bool tud_ready(void)
+{
+    return g_dev.mounted && !g_dev.suspended;
+}
+
+bool tud_suspended(void)
+{
+    return g_dev.suspended;
+}
+
+bool tud_remote_wakeup(void)
+{
+    if (!g_dev.suspended) {
+        return false;
+    }
+    g_dev.suspended = false;
+    return true;
+}
+
+bool tud_disconnect(void)
+{
+    dev_check_core();
+    const bool was_mounted = g_dev.mounted;
+    g_dev.attached = false;
+    g_dev.mounted = false;
+    g_dev.armed = false;
+    if (was_mounted) {
+        dev_event_push(DEV_EVENT_UNMOUNT, g_dev.frames, NULL, 0);
+    }
+    return true;
+}
+
+bool tud_connect(void)
+{
+    dev_check_core();
+    fake_usb_device_attach();
+    return true;
+}
+
+void tud_sof_cb_enable(bool en)
+{
+    g_dev.sof_cb_enabled = en;
+}
+
+uint32_t tud_frame_number(void)
+{
+    return g_dev.frames & 0x7FF;
+}
+
+bool tud_hid_ready(void)
+{
+    return tud_ready() && !g_dev.armed;
+}
+
+bool tud_hid_report(uint8_t report_id, const void* report, uint16_t len)
+{
+    dev_check_core();
+    if (!tud_hid_ready() || len > FAKE_USB_REPORT_MAX - 1 || (len > 0 && report == NULL)) {
+        return false;
+    }
+
+    fake_usb_report_t* pending = &g_dev.pending;
+    memset(pending, 0, sizeof(*pending));
+    pending->submit_us = time_us_64();
+    pending->report_id = report_id;
+    pending->len = (uint8_t)len;
+    if (len > 0) {
+        memcpy(pending->data, report, len);
+    }
+    g_dev.armed = true;
+    return true;
+}
+
+bool tud_hid_mouse_report(uint8_t report_id, uint8_t buttons, int8_t x, int8_t y, int8_t vertical, int8_t horizontal)
+{
+    const hid_mouse_report_t report = {
+        .buttons = buttons,
+        .x = x,
+        .y = y,
+        .wheel = vertical,
+        .pan = horizontal
+    };
+    return tud_hid_report(report_id, &report, sizeof(report));
+}
+
+bool tud_hid_keyboard_report(uint8_t report_id, uint8_t modifier, const uint8_t keycode[6])
+{
+    hid_keyboard_report_t report = { .modifier = modifier };
+    if (keycode != NULL) {
+        memcpy(report.keycode, keycode, sizeof(report.keycode));
+    }
+    return tud_hid_report(report_id, &report, sizeof(report));
+}
+
+//--------------------------------------------------------------------+
+// Host side
+//--------------------------------------------------------------------+
+
+#define FAKE_HOST_DEVICES               (CFG_TUH_DEVICE_MAX + 1)
+
+typedef struct {
+    bool mounted;
+    uint8_t itf_protocol;
+    uint8_t protocol;
+    bool set_protocol_pending;
+    uint8_t set_protocol_value;
+    uint32_t set_protocol_count;
+} fake_host_itf_t;
+
+typedef struct {
+    uint16_t vid;
+    uint16_t pid;
+    fake_host_itf_t itf[CFG_TUH_HID];
+} fake_host_dev_t;
+
+static fake_host_dev_t g_host[FAKE_HOST_DEVICES];
+static uint8_t g_host_default_protocol = HID_PROTOCOL_BOOT;
+
+static fake_host_itf_t* host_itf(uint8_t dev_addr, uint8_t instance)
+{
+    if (dev_addr >= FAKE_HOST_DEVICES || instance >= CFG_TUH_HID) {
+        return NULL;
+    }
+    return &g_host[dev_addr].itf[instance];
+}
+
+void fake_host_attach(uint8_t dev_addr, uint8_t instance, uint16_t vid, uint16_t pid,
+                      uint8_t itf_protocol, const uint8_t* desc, uint16_t desc_len)
+{
+    fake_host_itf_t* itf = host_itf(dev_addr, instance);
+    if (itf == NULL) {
+        return;
+    }
+    g_host[dev_addr].vid = vid;
+    g_host[dev_addr].pid = pid;
+    memset(itf, 0, sizeof(*itf));
+    itf->mounted = true;
+    itf->itf_protocol = itf_protocol;
+    // TinyUSB only sends SET_PROTOCOL to boot interfaces during enumeration
+    itf->protocol = (itf_protocol != HID_ITF_PROTOCOL_NONE) ? g_host_default_protocol : HID_PROTOCOL_REPORT;
+
+    fake_set_core_num(1);
+    tuh_hid_mount_cb(dev_addr, instance, desc, desc_len);
+    fake_set_core_num(0);
+}
+
+void fake_host_detach(uint8_t dev_addr, uint8_t instance)
+{
+    fake_host_itf_t* itf = host_itf(dev_addr, instance);
+    if (itf == NULL || !itf->mounted) {
+        return;
+    }
+    itf->mounted = false;
+
+    fake_set_core_num(1);
+    tuh_hid_umount_cb(dev_addr, instance);
+    fake_set_core_num(0);
+}
+
+void fake_host_task(void)
+{
+    for (uint8_t dev = 0; dev < FAKE_HOST_DEVICES; dev++) {
+        for (uint8_t inst = 0; inst < CFG_TUH_HID; inst++) {
+            fake_host_itf_t* itf = &g_host[dev].itf[inst];
+            if (itf->set_protocol_pending) {
+                itf->set_protocol_pending = false;
+                itf->protocol = itf->set_protocol_value;
+            }
+        }
+    }
+}
+
+void fake_host_report(uint8_t dev_addr, uint8_t instance, const uint8_t* report, uint16_t len)
+{
+    fake_host_itf_t* itf = host_itf(dev_addr, instance);
+    if (itf == NULL || !itf->mounted) {
+        return;
+    }
+    fake_host_task();
+
+    fake_set_core_num(1);
+    tuh_hid_report_received_cb(dev_addr, instance, report, len);
+    fake_set_core_num(0);
+}
+
+uint8_t fake_host_protocol(uint8_t dev_addr, uint8_t instance)
+{
+    fake_host_itf_t* itf = host_itf(dev_addr, instance);
+    return (itf != NULL) ? itf->protocol : HID_PROTOCOL_BOOT;
+}
+
+uint32_t fake_host_set_protocol_count(uint8_t dev_addr, uint8_t instance)
+{
+    fake_host_itf_t* itf = host_itf(dev_addr, instance);
+    return (itf != NULL) ? itf->set_protocol_count : 0;
+}
+
+bool tuh_init(uint8_t rhport)
+{
+    (void)rhport;
+    memset(g_host, 0, sizeof(g_host));
+    return true;
+}
+
+void tuh_task(void)
+{
+    fake_host_task();
+}
+
+bool tuh_vid_pid_get(uint8_t daddr, uint16_t* vid, uint16_t* pid)
+{
+    if (daddr >= FAKE_HOST_DEVICES) {
+        return false;
+    }
+    *vid = g_host[daddr].vid;
+    *pid = g_host[daddr].pid;
+    return true;
+}
+
+// String descriptors are not modelled; the firmware falls back to its own
+uint8_t tuh_descriptor_get_manufacturer_string_sync(uint8_t daddr, uint16_t language_id, void* buffer, uint16_t len)
+{
+    (void)daddr; (void)language_id; (void)buffer; (void)len;
+    return XFER_RESULT_FAILED;
+}
+
+uint8_t tuh_descriptor_get_product_string_sync(uint8_t daddr, uint16_t language_id, void* buffer, uint16_t len)
+{
+    (void)daddr; (void)language_id; (void)buffer; (void)len;
+    return XFER_RESULT_FAILED;
+}
+
+uint8_t tuh_descriptor_get_serial_string_sync(uint8_t daddr, uint16_t language_id, void* buffer, uint16_t len)
+{
+    (void)daddr; (void)language_id; (void)buffer; (void)len;
+    return XFER_RESULT_FAILED;
+}
+
+uint8_t tuh_hid_interface_protocol(uint8_t dev_addr, uint8_t idx)
+{
+    fake_host_itf_t* itf = host_itf(dev_addr, idx);
+    return (itf != NULL) ? itf->itf_protocol : HID_ITF_PROTOCOL_NONE;
+}
+
+bool tuh_hid_receive_report(uint8_t dev_addr, uint8_t idx)
+{
+    fake_host_itf_t* itf = host_itf(dev_addr, idx);
+    return itf != NULL && itf->mounted;
+}
+
+uint8_t tuh_hid_get_protocol(uint8_t dev_addr, uint8_t idx)
+{
+    return fake_host_protocol(dev_addr, idx);
+}
+
+// Completes from the next fake_host_task(), like the control transfer
+bool tuh_hid_set_protocol(uint8_t dev_addr, uint8_t idx, uint8_t protocol)
+{
+    fake_host_itf_t* itf = host_itf(dev_addr, idx);
+    if (itf == NULL || !itf->mounted || itf->itf_protocol == HID_ITF_PROTOCOL_NONE) {
+        return false;
+    }
+    itf->set_protocol_pending = true;
+    itf->set_protocol_value = protocol;
+    itf->set_protocol_count++;
+    return true;
+}
+
+void tuh_hid_set_default_protocol(uint8_t protocol)
+{
+    g_host_default_protocol = protocol;
+}
@@ -0,0 +1,96 @@
+/*
+ * Host fake of TinyUSB: test control interface
+ *
+ * Device side: one HID IN endpoint polled by a virtual host. A start of
+ * frame is generated every USB_FRAME_US of virtual time and the host sends
+ * its IN token poll_offset_us later; a report armed with tud_hid_report()
+ * before the token is collected in that frame. SOF, transfer complete and
+ * (re)mount events are queued like TinyUSB's ISR does and dispatched to the
+ * firmware callbacks by tud_task().
+ *
+ * Host side: attached HID interfaces with their protocol mode. Reports are
+ * delivered by calling tuh_hid_report_received_cb() as core1 would.
+ */
+
+#ifndef FAKE_TUSB_CONTROL_H
+#define FAKE_TUSB_CONTROL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define FAKE_USB_REPORT_MAX             64      // Endpoint buffer, including the report ID
+#define FAKE_USB_REPORT_LOG             4096    // Reports kept for inspection
+
+// Report collected from the device IN endpoint
+typedef struct {
+    uint32_t frame;             // Frame whose IN transaction collected it
+    uint64_t submit_us;         // When the firmware armed it
+    uint64_t sent_us;           // When the host collected it
+    uint8_t report_id;
+    uint8_t len;                // Payload length, without the report ID
+    uint8_t data[FAKE_USB_REPORT_MAX];
+} fake_usb_report_t;
+
+typedef void (*fake_usb_report_hook_t)(const fake_usb_report_t* report);
+
+// Reset both sides: detached, no reports, frame counter at zero
+void fake_usb_reset(void);
+
+//--------------------------------------------------------------------+
+// Device side
+//--------------------------------------------------------------------+
+
+// Plug into the virtual host; the mount is dispatched by the next tud_task()
+void fake_usb_device_attach(void);
+
+void fake_usb_set_suspended(bool suspended);
+
+// Delay of the host's IN token after each SOF (0..USB_FRAME_US-1)
+void fake_usb_set_poll_offset_us(uint32_t offset_us);
+
+// Generate the SOFs and IN transactions due up to now_us
+void fake_usb_run_until(uint64_t now_us);
+
+// Frames started since fake_usb_reset()
+uint32_t fake_usb_frame_count(void);
+
+// Collected reports, oldest first; the log keeps the first FAKE_USB_REPORT_LOG
+size_t fake_usb_report_count(void);
+const fake_usb_report_t* fake_usb_report(size_t index);
+const fake_usb_report_t* fake_usb_last_report(void);
+void fake_usb_clear_reports(void);
+
+// Called for every collected report, whether or not the log has room
+void fake_usb_set_report_hook(fake_usb_report_hook_t hook);
+
+// Times the device connected (initial attach and every re-enumeration)
+uint32_t fake_usb_connect_count(void);
+
+// Calls into the device stack (report, disconnect, connect) made from core1
+uint32_t fake_usb_core1_call_count(void);
+
+// Report descriptor the virtual host read at the last mount
+const uint8_t* fake_usb_host_report_descriptor(uint16_t* len);
+
+//--------------------------------------------------------------------+
+// Host side
+//--------------------------------------------------------------------+
+
+// Attach a HID interface and run tuh_hid_mount_cb() for it. Interfaces with
+// a boot protocol start in the default protocol, others in report protocol.
+void fake_host_attach(uint8_t dev_addr, uint8_t instance, uint16_t vid, uint16_t pid,
+                      uint8_t itf_protocol, const uint8_t* desc, uint16_t desc_len);
+void fake_host_detach(uint8_t dev_addr, uint8_t instance);
+
+// Complete pending control transfers (SET_PROTOCOL), like tuh_task()
+void fake_host_task(void);
+
+// Deliver an input report through tuh_hid_report_received_cb()
+void fake_host_report(uint8_t dev_addr, uint8_t instance, const uint8_t* report, uint16_t len);
+
+// Protocol the interface is in, and SET_PROTOCOL requests issued for it
+uint8_t fake_host_protocol(uint8_t dev_addr, uint8_t instance);
+uint32_t fake_host_set_protocol_count(uint8_t dev_addr, uint8_t instance);
+
+#endif // FAKE_TUSB_CONTROL_H
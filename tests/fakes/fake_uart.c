@@ -0,0 +1,228 @@
+/*
+ * Host fake of the KMBox transport (kmbox_interface.h)
+ */
+
+#include "fake_uart.h"
+#include "kmbox_interface.h"
+#include "defines.h"
+#include "pico/stdlib.h"
+#include <string.h>
+
+const kmbox_uart_config_t KMBOX_UART_DEFAULT_CONFIG = {
+    .baudrate = KMBOX_UART_BAUDRATE,
+    .tx_pin = KMBOX_UART_TX_PIN,
+    .rx_pin = KMBOX_UART_RX_PIN,
+    .use_dma = true
+};
+
+const kmbox_spi_config_t KMBOX_SPI_DEFAULT_CONFIG = {
+    .baudrate = 1000000,
+    .sck_pin = 18,
+    .mosi_pin = 19,
+    .miso_pin = 16,
+    .cs_pin = 17,
+    .use_dma = true,
+    .is_slave = true
+};
+
+#define RX_MASK (FAKE_UART_RX_SIZE - 1)
+_Static_assert((FAKE_UART_RX_SIZE & RX_MASK) == 0, "FAKE_UART_RX_SIZE must be a power of two");
+
+typedef struct {
+    kmbox_interface_config_t config;
+    bool initialized;
+    uint32_t baudrate;
+    bool paced;
+
+    uint8_t rx[FAKE_UART_RX_SIZE];
+    uint64_t rx_time_us[FAKE_UART_RX_SIZE];
+    uint32_t rx_head;           // Next free slot
+    uint32_t rx_tail;           // Next byte to deliver
+    uint64_t rx_line_free_us;   // When the last queued byte has arrived
+    bool rx_frame_ready;
+    uint32_t rx_scan;
+
+    uint8_t tx[FAKE_UART_TX_SIZE];
+    size_t tx_len;
+
+    kmbox_interface_stats_t stats;
+} fake_uart_t;
+
+static fake_uart_t g_uart;
+
+void fake_uart_reset(void)
+{
+    memset(&g_uart, 0, sizeof(g_uart));
+    g_uart.baudrate = KMBOX_UART_BAUDRATE;
+}
+
+void fake_uart_set_paced(bool paced)
+{
+    g_uart.paced = paced;
+}
+
+bool fake_uart_rx(const void* data, size_t len)
+{
+    if (len > FAKE_UART_RX_SIZE - (g_uart.rx_head - g_uart.rx_tail)) {
+        return false;
+    }
+
+    const uint8_t* bytes = (const uint8_t*)data;
+    const uint64_t now_us = time_us_64();
+    uint64_t t = (g_uart.rx_line_free_us > now_us) ? g_uart.rx_line_free_us : now_us;
+    for (size_t i = 0; i < len; i++) {
+        if (g_uart.paced) {
+            // Start bit, 8 data bits, stop bit
+            t += (10u * 1000000u + g_uart.baudrate - 1) / g_uart.baudrate;
+        }
+        g_uart.rx[g_uart.rx_head & RX_MASK] = bytes[i];
+        g_uart.rx_time_us[g_uart.rx_head & RX_MASK] = t;
+        g_uart.rx_head++;
+    }
+    g_uart.rx_line_free_us = t;
+    return true;
+}
+
+bool fake_uart_rx_str(const char* str)
+{
+    return fake_uart_rx(str, strlen(str));
+}
+
+uint64_t fake_uart_rx_done_us(void)
+{
+    return g_uart.rx_line_free_us;
+}
+
+size_t fake_uart_rx_pending(void)
+{
+    return g_uart.rx_head - g_uart.rx_tail;
+}
+
+size_t fake_uart_tx_len(void)
+{
+    return g_uart.tx_len;
+}
+
+const uint8_t* fake_uart_tx_data(void)
+{
+    return g_uart.tx;
+}
+
+void fake_uart_tx_clear(void)
+{
+    g_uart.tx_len = 0;
+}
+
+uint32_t fake_uart_baudrate(void)
+{
+    return g_uart.baudrate;
+}
+
+//--------------------------------------------------------------------+
+// kmbox_interface.h
+//--------------------------------------------------------------------+
+
+bool kmbox_interface_init(const kmbox_interface_config_t* config)
+{
+    if (config == NULL || config->transport_type != KMBOX_TRANSPORT_UART) {
+        return false;
+    }
+    g_uart.config = *config;
+    g_uart.baudrate = config->config.uart.baudrate;
+    g_uart.initialized = true;
+    return true;
+}
+
+void kmbox_interface_process(uint64_t now_us)
+{
+    if (!g_uart.initialized) {
+        return;
+    }
+
+    // Bytes that have arrived by now
+    uint32_t arrived = g_uart.rx_tail;
+    while (arrived != g_uart.rx_head && g_uart.rx_time_us[arrived & RX_MASK] <= now_us) {
+        arrived++;
+    }
+    if (arrived == g_uart.rx_tail) {
+        return;
+    }
+
+    for (uint32_t i = g_uart.rx_scan; i != arrived; i++) {
+        const uint8_t ch = g_uart.rx[i & RX_MASK];
+        if (ch == '\n' || ch == '\r') {
+            g_uart.rx_frame_ready = true;
+        }
+    }
+    g_uart.rx_scan = arrived;
+
+    const uint64_t last_us = g_uart.rx_time_us[(arrived - 1) & RX_MASK];
+    const uint64_t idle_us = (20u * 1000000u) / g_uart.baudrate + 1;
+    if (!g_uart.rx_frame_ready && now_us - last_us < idle_us) {
+        return;
+    }
+    g_uart.rx_frame_ready = false;
+    g_uart.stats.packets_received++;
+
+    // Up to two contiguous spans when the script wraps, as from the RX ring
+    while (g_uart.rx_tail != arrived) {
+        const uint32_t start = g_uart.rx_tail & RX_MASK;
+        uint32_t chunk = arrived - g_uart.rx_tail;
+        if (chunk > FAKE_UART_RX_SIZE - start) {
+            chunk = FAKE_UART_RX_SIZE - start;
+        }
+        g_uart.rx_tail += chunk;
+        g_uart.stats.bytes_received += chunk;
+        if (g_uart.config.on_command_received) {
+            g_uart.config.on_command_received(&g_uart.rx[start], chunk);
+        }
+    }
+}
+
+bool kmbox_interface_send(const uint8_t* data, size_t len)
+{
+    if (len > FAKE_UART_TX_SIZE - g_uart.tx_len) {
+        g_uart.stats.tx_dropped += (uint32_t)len;
+        return false;
+    }
+    memcpy(&g_uart.tx[g_uart.tx_len], data, len);
+    g_uart.tx_len += len;
+    g_uart.stats.bytes_sent += (uint32_t)len;
+    return true;
+}
+
+bool kmbox_interface_tx_idle(void)
+{
+    return true;
+}
+
+bool kmbox_interface_set_baudrate(uint32_t baudrate)
+{
+    if (baudrate == 0) {
+        return false;
+    }
+    g_uart.baudrate = baudrate;
+    return true;
+}
+
+bool kmbox_interface_is_ready(void)
+{
+    return g_uart.initialized;
+}
+
+void kmbox_interface_get_stats(kmbox_interface_stats_t* stats)
+{
+    if (stats != NULL) {
+        *stats = g_uart.stats;
+    }
+}
+
+void kmbox_interface_deinit(void)
+{
+    g_uart.initialized = false;
+}
+
+kmbox_transport_type_t kmbox_interface_get_transport_type(void)
+{
+    return g_uart.initialized ? KMBOX_TRANSPORT_UART : KMBOX_TRANSPORT_NONE;
+}
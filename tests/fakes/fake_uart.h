@@ -0,0 +1,44 @@
+/*
+ * Host fake of the KMBox transport (kmbox_interface.h): test control interface
+ *
+ * RX bytes are scripted with their arrival time on the virtual clock. Like
+ * the DMA ring transport, kmbox_interface_process() hands what has arrived
+ * to the callback once a line delimiter is in or the line has been idle for
+ * two character times. Transmitted bytes are captured.
+ */
+
+#ifndef FAKE_UART_H
+#define FAKE_UART_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define FAKE_UART_RX_SIZE               65536   // Scripted bytes not yet delivered
+#define FAKE_UART_TX_SIZE               16384   // Captured output
+
+void fake_uart_reset(void);
+
+// With pacing, every byte takes 10 bit times at the current baud rate and
+// follows the previous one back to back; without, bytes arrive immediately
+void fake_uart_set_paced(bool paced);
+
+// Queue bytes on the RX line, starting no earlier than now. Returns false
+// if the RX script is full.
+bool fake_uart_rx(const void* data, size_t len);
+bool fake_uart_rx_str(const char* str);
+
+// Arrival time of the last queued byte
+uint64_t fake_uart_rx_done_us(void);
+
+// Bytes queued but not yet handed to the parser
+size_t fake_uart_rx_pending(void);
+
+// Captured output, oldest first
+size_t fake_uart_tx_len(void);
+const uint8_t* fake_uart_tx_data(void);
+void fake_uart_tx_clear(void);
+
+uint32_t fake_uart_baudrate(void);
+
+#endif // FAKE_UART_H
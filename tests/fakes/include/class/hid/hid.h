@@ -0,0 +1,226 @@
+/*
+ * Host fake of TinyUSB's HID class definitions
+ *
+ * Report structures, protocol constants and the report descriptor item
+ * macros with TinyUSB's encoding, so descriptors built by the firmware are
+ * byte-identical on the host and can be fed to the report parser in tests.
+ */
+
+#ifndef FAKE_CLASS_HID_H
+#define FAKE_CLASS_HID_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//--------------------------------------------------------------------+
+// Protocol
+//--------------------------------------------------------------------+
+
+enum { HID_SUBCLASS_NONE = 0, HID_SUBCLASS_BOOT = 1 };
+
+typedef enum {
+    HID_ITF_PROTOCOL_NONE = 0,
+    HID_ITF_PROTOCOL_KEYBOARD = 1,
+    HID_ITF_PROTOCOL_MOUSE = 2
+} hid_interface_protocol_enum_t;
+
+enum { HID_DESC_TYPE_HID = 0x21, HID_DESC_TYPE_REPORT = 0x22 };
+
+typedef enum {
+    HID_PROTOCOL_BOOT = 0,
+    HID_PROTOCOL_REPORT = 1
+} hid_protocol_mode_enum_t;
+
+typedef enum {
+    HID_REPORT_TYPE_INVALID = 0,
+    HID_REPORT_TYPE_INPUT,
+    HID_REPORT_TYPE_OUTPUT,
+    HID_REPORT_TYPE_FEATURE
+} hid_report_type_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t modifier;
+    uint8_t reserved;
+    uint8_t keycode[6];
+} hid_keyboard_report_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t buttons;
+    int8_t x;
+    int8_t y;
+    int8_t wheel;
+    int8_t pan;
+} hid_mouse_report_t;
+
+#define KEYBOARD_LED_NUMLOCK            (1u << 0)
+#define KEYBOARD_LED_CAPSLOCK           (1u << 1)
+#define KEYBOARD_LED_SCROLLLOCK         (1u << 2)
+
+//--------------------------------------------------------------------+
+// Report descriptor items
+//--------------------------------------------------------------------+
+
+enum { RI_TYPE_MAIN = 0, RI_TYPE_GLOBAL = 1, RI_TYPE_LOCAL = 2 };
+
+#define HID_REPORT_DATA_0(data)
+#define HID_REPORT_DATA_1(data)         , (data)
+#define HID_REPORT_DATA_2(data)         , U16_TO_U8S_LE(data)
+#define HID_REPORT_DATA_3(data)         , U32_TO_U8S_LE(data)
+
+#define HID_REPORT_ITEM(data, tag, type, size) \
+    (((tag) << 4) | ((type) << 2) | (size)) HID_REPORT_DATA_##size(data)
+
+#define HID_DATA                        (0 << 0)
+#define HID_CONSTANT                    (1 << 0)
+#define HID_ARRAY                       (0 << 1)
+#define HID_VARIABLE                    (1 << 1)
+#define HID_ABSOLUTE                    (0 << 2)
+#define HID_RELATIVE                    (1 << 2)
+
+#define HID_INPUT(x)                    HID_REPORT_ITEM(x, 8, RI_TYPE_MAIN, 1)
+#define HID_OUTPUT(x)                   HID_REPORT_ITEM(x, 9, RI_TYPE_MAIN, 1)
+#define HID_COLLECTION(x)               HID_REPORT_ITEM(x, 10, RI_TYPE_MAIN, 1)
+#define HID_COLLECTION_END              HID_REPORT_ITEM(x, 12, RI_TYPE_MAIN, 0)
+
+#define HID_COLLECTION_PHYSICAL         0
+#define HID_COLLECTION_APPLICATION      1
+
+#define HID_USAGE_PAGE(x)               HID_REPORT_ITEM(x, 0, RI_TYPE_GLOBAL, 1)
+#define HID_USAGE_PAGE_N(x, n)          HID_REPORT_ITEM(x, 0, RI_TYPE_GLOBAL, n)
+#define HID_LOGICAL_MIN(x)              HID_REPORT_ITEM(x, 1, RI_TYPE_GLOBAL, 1)
+#define HID_LOGICAL_MIN_N(x, n)         HID_REPORT_ITEM(x, 1, RI_TYPE_GLOBAL, n)
+#define HID_LOGICAL_MAX(x)              HID_REPORT_ITEM(x, 2, RI_TYPE_GLOBAL, 1)
+#define HID_LOGICAL_MAX_N(x, n)         HID_REPORT_ITEM(x, 2, RI_TYPE_GLOBAL, n)
+#define HID_REPORT_SIZE(x)              HID_REPORT_ITEM(x, 7, RI_TYPE_GLOBAL, 1)
+#define HID_REPORT_ID(x)                HID_REPORT_ITEM(x, 8, RI_TYPE_GLOBAL, 1),
+#define HID_REPORT_COUNT(x)             HID_REPORT_ITEM(x, 9, RI_TYPE_GLOBAL, 1)
+#define HID_PUSH                        HID_REPORT_ITEM(x, 10, RI_TYPE_GLOBAL, 0)
+#define HID_POP                         HID_REPORT_ITEM(x, 11, RI_TYPE_GLOBAL, 0)
+
+#define HID_USAGE(x)                    HID_REPORT_ITEM(x, 0, RI_TYPE_LOCAL, 1)
+#define HID_USAGE_N(x, n)               HID_REPORT_ITEM(x, 0, RI_TYPE_LOCAL, n)
+#define HID_USAGE_MIN(x)                HID_REPORT_ITEM(x, 1, RI_TYPE_LOCAL, 1)
+#define HID_USAGE_MIN_N(x, n)           HID_REPORT_ITEM(x, 1, RI_TYPE_LOCAL, n)
+#define HID_USAGE_MAX(x)                HID_REPORT_ITEM(x, 2, RI_TYPE_LOCAL, 1)
+#define HID_USAGE_MAX_N(x, n)           HID_REPORT_ITEM(x, 2, RI_TYPE_LOCAL, n)
+
+enum {
+    HID_USAGE_PAGE_DESKTOP = 0x01,
+    HID_USAGE_PAGE_KEYBOARD = 0x07,
+    HID_USAGE_PAGE_LED = 0x08,
+    HID_USAGE_PAGE_BUTTON = 0x09,
+    HID_USAGE_PAGE_CONSUMER = 0x0C,
+    HID_USAGE_PAGE_DIGITIZER = 0x0D,
+    HID_USAGE_PAGE_VENDOR = 0xFF00
+};
+
+enum {
+    HID_USAGE_DESKTOP_POINTER = 0x01,
+    HID_USAGE_DESKTOP_MOUSE = 0x02,
+    HID_USAGE_DESKTOP_KEYBOARD = 0x06,
+    HID_USAGE_DESKTOP_X = 0x30,
+    HID_USAGE_DESKTOP_Y = 0x31,
+    HID_USAGE_DESKTOP_WHEEL = 0x38
+};
+
+enum {
+    HID_USAGE_CONSUMER_CONTROL = 0x0001,
+    HID_USAGE_CONSUMER_AC_PAN = 0x0238
+};
+
+//--------------------------------------------------------------------+
+// Standard report descriptors (as in TinyUSB)
+//--------------------------------------------------------------------+
+
+#define TUD_HID_REPORT_DESC_KEYBOARD(...) \
+    HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP), \
+    HID_USAGE(HID_USAGE_DESKTOP_KEYBOARD), \
+    HID_COLLECTION(HID_COLLECTION_APPLICATION), \
+      __VA_ARGS__ \
+      HID_USAGE_PAGE(HID_USAGE_PAGE_KEYBOARD), \
+        HID_USAGE_MIN(224), \
+        HID_USAGE_MAX(231), \
+        HID_LOGICAL_MIN(0), \
+        HID_LOGICAL_MAX(1), \
+        HID_REPORT_COUNT(8), \
+        HID_REPORT_SIZE(1), \
+        HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE), \
+        HID_REPORT_COUNT(1), \
+        HID_REPORT_SIZE(8), \
+        HID_INPUT(HID_CONSTANT), \
+      HID_USAGE_PAGE(HID_USAGE_PAGE_LED), \
+        HID_USAGE_MIN(1), \
+        HID_USAGE_MAX(5), \
+        HID_REPORT_COUNT(5), \
+        HID_REPORT_SIZE(1), \
+        HID_OUTPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE), \
+        HID_REPORT_COUNT(1), \
+        HID_REPORT_SIZE(3), \
+        HID_OUTPUT(HID_CONSTANT), \
+      HID_USAGE_PAGE(HID_USAGE_PAGE_KEYBOARD), \
+        HID_USAGE_MIN(0), \
+        HID_USAGE_MAX_N(255, 2), \
+        HID_LOGICAL_MIN(0), \
+        HID_LOGICAL_MAX_N(255, 2), \
+        HID_REPORT_COUNT(6), \
+        HID_REPORT_SIZE(8), \
+        HID_INPUT(HID_DATA | HID_ARRAY | HID_ABSOLUTE), \
+    HID_COLLECTION_END
+
+#define TUD_HID_REPORT_DESC_MOUSE(...) \
+    HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP), \
+    HID_USAGE(HID_USAGE_DESKTOP_MOUSE), \
+    HID_COLLECTION(HID_COLLECTION_APPLICATION), \
+      __VA_ARGS__ \
+      HID_USAGE(HID_USAGE_DESKTOP_POINTER), \
+      HID_COLLECTION(HID_COLLECTION_PHYSICAL), \
+        HID_USAGE_PAGE(HID_USAGE_PAGE_BUTTON), \
+          HID_USAGE_MIN(1), \
+          HID_USAGE_MAX(5), \
+          HID_LOGICAL_MIN(0), \
+          HID_LOGICAL_MAX(1), \
+          HID_REPORT_COUNT(5), \
+          HID_REPORT_SIZE(1), \
+          HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE), \
+          HID_REPORT_COUNT(1), \
+          HID_REPORT_SIZE(3), \
+          HID_INPUT(HID_CONSTANT), \
+        HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP), \
+          HID_USAGE(HID_USAGE_DESKTOP_X), \
+          HID_USAGE(HID_USAGE_DESKTOP_Y), \
+          HID_LOGICAL_MIN(0x81), \
+          HID_LOGICAL_MAX(0x7f), \
+          HID_REPORT_COUNT(2), \
+          HID_REPORT_SIZE(8), \
+          HID_INPUT(HID_DATA | HID_VARIABLE | HID_RELATIVE), \
+          HID_USAGE(HID_USAGE_DESKTOP_WHEEL), \
+          HID_LOGICAL_MIN(0x81), \
+          HID_LOGICAL_MAX(0x7f), \
+          HID_REPORT_COUNT(1), \
+          HID_REPORT_SIZE(8), \
+          HID_INPUT(HID_DATA | HID_VARIABLE | HID_RELATIVE), \
+        HID_USAGE_PAGE(HID_USAGE_PAGE_CONSUMER), \
+          HID_USAGE_N(HID_USAGE_CONSUMER_AC_PAN, 2), \
+          HID_LOGICAL_MIN(0x81), \
+          HID_LOGICAL_MAX(0x7f), \
+          HID_REPORT_COUNT(1), \
+          HID_REPORT_SIZE(8), \
+          HID_INPUT(HID_DATA | HID_VARIABLE | HID_RELATIVE), \
+      HID_COLLECTION_END, \
+    HID_COLLECTION_END
+
+#define TUD_HID_REPORT_DESC_CONSUMER(...) \
+    HID_USAGE_PAGE(HID_USAGE_PAGE_CONSUMER), \
+    HID_USAGE(HID_USAGE_CONSUMER_CONTROL), \
+    HID_COLLECTION(HID_COLLECTION_APPLICATION), \
+      __VA_ARGS__ \
+      HID_LOGICAL_MIN(0x00), \
+      HID_LOGICAL_MAX_N(0x03FF, 2), \
+      HID_USAGE_MIN(0x00), \
+      HID_USAGE_MAX_N(0x03FF, 2), \
+      HID_REPORT_COUNT(1), \
+      HID_REPORT_SIZE(16), \
+      HID_INPUT(HID_DATA | HID_ARRAY | HID_ABSOLUTE), \
+    HID_COLLECTION_END
+
+#endif // FAKE_CLASS_HID_H
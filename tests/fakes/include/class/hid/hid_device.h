@@ -0,0 +1,15 @@
+/*
+ * Host fake of TinyUSB's HID device class API
+ */
+
+#ifndef FAKE_HID_DEVICE_H
+#define FAKE_HID_DEVICE_H
+
+#include "class/hid/hid.h"
+
+bool tud_hid_ready(void);
+bool tud_hid_report(uint8_t report_id, const void* report, uint16_t len);
+bool tud_hid_mouse_report(uint8_t report_id, uint8_t buttons, int8_t x, int8_t y, int8_t vertical, int8_t horizontal);
+bool tud_hid_keyboard_report(uint8_t report_id, uint8_t modifier, const uint8_t keycode[6]);
+
+#endif // FAKE_HID_DEVICE_H
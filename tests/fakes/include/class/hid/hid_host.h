@@ -0,0 +1,16 @@
+/*
+ * Host fake of TinyUSB's HID host class API
+ */
+
+#ifndef FAKE_HID_HOST_H
+#define FAKE_HID_HOST_H
+
+#include "class/hid/hid.h"
+
+uint8_t tuh_hid_interface_protocol(uint8_t dev_addr, uint8_t idx);
+bool tuh_hid_receive_report(uint8_t dev_addr, uint8_t idx);
+uint8_t tuh_hid_get_protocol(uint8_t dev_addr, uint8_t idx);
+bool tuh_hid_set_protocol(uint8_t dev_addr, uint8_t idx, uint8_t protocol);
+void tuh_hid_set_default_protocol(uint8_t protocol);
+
+#endif // FAKE_HID_HOST_H
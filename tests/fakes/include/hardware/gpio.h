@@ -0,0 +1,21 @@
+/*
+ * Host fake of the Pico SDK GPIO API. Inputs read the levels set with
+ * fake_gpio_set_input(); a pull-up makes an undriven pin read high.
+ */
+
+#ifndef FAKE_HARDWARE_GPIO_H
+#define FAKE_HARDWARE_GPIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define GPIO_IN                         false
+#define GPIO_OUT                        true
+
+void gpio_init(unsigned int gpio);
+void gpio_set_dir(unsigned int gpio, bool out);
+void gpio_put(unsigned int gpio, bool value);
+bool gpio_get(unsigned int gpio);
+void gpio_pull_up(unsigned int gpio);
+
+#endif // FAKE_HARDWARE_GPIO_H
@@ -0,0 +1,21 @@
+/*
+ * Host fake of the Pico SDK synchronization primitives. The host build runs
+ * both "cores" on one thread, so masking interrupts is a no-op and the
+ * barriers only have to stop compiler reordering.
+ */
+
+#ifndef FAKE_HARDWARE_SYNC_H
+#define FAKE_HARDWARE_SYNC_H
+
+#include <stdint.h>
+
+#define __dmb()                         __sync_synchronize()
+#define __compiler_memory_barrier()     __asm__ volatile("" ::: "memory")
+
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+
+// Core the caller runs on, see fake_set_core_num()
+unsigned int get_core_num(void);
+
+#endif // FAKE_HARDWARE_SYNC_H
@@ -0,0 +1,26 @@
+/*
+ * Host fake of the Pico SDK standard library headers
+ *
+ * Time comes from the virtual clock in fake_sdk.c; it only moves when a
+ * test or the simulator advances it (or the code under test sleeps).
+ */
+
+#ifndef FAKE_PICO_STDLIB_H
+#define FAKE_PICO_STDLIB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "pico/time.h"
+#include "hardware/gpio.h"
+
+typedef unsigned int uint;
+
+#define NUM_CORES                       2
+
+#define __not_in_flash_func(f)          f
+#define __time_critical_func(f)         f
+#define tight_loop_contents()           do { } while (0)
+
+#endif // FAKE_PICO_STDLIB_H
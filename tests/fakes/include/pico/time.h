@@ -0,0 +1,23 @@
+/*
+ * Host fake of the Pico SDK time API, driven by the virtual clock
+ */
+
+#ifndef FAKE_PICO_TIME_H
+#define FAKE_PICO_TIME_H
+
+#include <stdint.h>
+
+typedef uint64_t absolute_time_t;
+
+uint64_t time_us_64(void);
+uint32_t time_us_32(void);
+absolute_time_t get_absolute_time(void);
+uint32_t to_ms_since_boot(absolute_time_t t);
+uint64_t to_us_since_boot(absolute_time_t t);
+
+// Sleeping advances the virtual clock
+void sleep_ms(uint32_t ms);
+void sleep_us(uint64_t us);
+void busy_wait_us_32(uint32_t us);
+
+#endif // FAKE_PICO_TIME_H
@@ -0,0 +1,111 @@
+/*
+ * Host fake of the TinyUSB API used by the firmware logic
+ *
+ * Declares the subset of the device and host stacks that usb_hid.c and the
+ * serial handler call, with the same names and signatures as TinyUSB. The
+ * behaviour (endpoint, frames, attached devices) lives in fake_tusb.c.
+ */
+
+#ifndef FAKE_TUSB_H
+#define FAKE_TUSB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "tusb_config.h"
+
+#define TU_ATTR_PACKED                  __attribute__((packed))
+#define TU_ATTR_WEAK                    __attribute__((weak))
+#define TU_BIT(n)                       (1UL << (n))
+#define TU_U16_LOW(u16)                 ((uint8_t)((u16) & 0x00ff))
+#define TU_U16_HIGH(u16)                ((uint8_t)(((u16) >> 8) & 0x00ff))
+#define U16_TO_U8S_LE(u16)              TU_U16_LOW(u16), TU_U16_HIGH(u16)
+#define U32_TO_U8S_LE(u32)              ((uint8_t)((u32) & 0xff)), ((uint8_t)(((u32) >> 8) & 0xff)), \
+                                        ((uint8_t)(((u32) >> 16) & 0xff)), ((uint8_t)(((u32) >> 24) & 0xff))
+
+//--------------------------------------------------------------------+
+// Descriptors
+//--------------------------------------------------------------------+
+
+enum {
+    TUSB_DESC_DEVICE = 0x01,
+    TUSB_DESC_CONFIGURATION = 0x02,
+    TUSB_DESC_STRING = 0x03,
+    TUSB_DESC_INTERFACE = 0x04,
+    TUSB_DESC_ENDPOINT = 0x05,
+};
+
+enum { TUSB_CLASS_HID = 3 };
+enum { TUSB_XFER_INTERRUPT = 3 };
+
+typedef enum {
+    XFER_RESULT_SUCCESS = 0,
+    XFER_RESULT_FAILED,
+    XFER_RESULT_STALLED,
+    XFER_RESULT_TIMEOUT,
+    XFER_RESULT_INVALID
+} xfer_result_t;
+
+#define TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP  TU_BIT(5)
+
+typedef struct TU_ATTR_PACKED {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint16_t bcdUSB;
+    uint8_t bDeviceClass;
+    uint8_t bDeviceSubClass;
+    uint8_t bDeviceProtocol;
+    uint8_t bMaxPacketSize0;
+    uint16_t idVendor;
+    uint16_t idProduct;
+    uint16_t bcdDevice;
+    uint8_t iManufacturer;
+    uint8_t iProduct;
+    uint8_t iSerialNumber;
+    uint8_t bNumConfigurations;
+} tusb_desc_device_t;
+
+#define TUD_CONFIG_DESC_LEN             (9)
+#define TUD_HID_DESC_LEN                (9 + 9 + 7)
+
+#define TUD_CONFIG_DESCRIPTOR(config_num, _itfcount, _stridx, _total_len, _attribute, _power_ma) \
+    9, TUSB_DESC_CONFIGURATION, U16_TO_U8S_LE(_total_len), _itfcount, config_num, _stridx, \
+    TU_BIT(7) | (_attribute), (_power_ma) / 2
+
+#define TUD_HID_DESCRIPTOR(_itfnum, _stridx, _boot_protocol, _report_desc_len, _epin, _epsize, _ep_interval) \
+    9, TUSB_DESC_INTERFACE, _itfnum, 0, 1, TUSB_CLASS_HID, \
+    (uint8_t)((_boot_protocol) ? (uint8_t)HID_SUBCLASS_BOOT : 0), _boot_protocol, _stridx, \
+    9, HID_DESC_TYPE_HID, U16_TO_U8S_LE(0x0111), 0, 1, HID_DESC_TYPE_REPORT, U16_TO_U8S_LE(_report_desc_len), \
+    7, TUSB_DESC_ENDPOINT, _epin, TUSB_XFER_INTERRUPT, U16_TO_U8S_LE(_epsize), _ep_interval
+
+#include "class/hid/hid.h"
+#include "class/hid/hid_device.h"
+#include "class/hid/hid_host.h"
+
+//--------------------------------------------------------------------+
+// Device stack
+//--------------------------------------------------------------------+
+
+bool tud_init(uint8_t rhport);
+void tud_task(void);
+bool tud_mounted(void);
+bool tud_ready(void);
+bool tud_suspended(void);
+bool tud_remote_wakeup(void);
+bool tud_disconnect(void);
+bool tud_connect(void);
+void tud_sof_cb_enable(bool en);
+uint32_t tud_frame_number(void);
+
+//--------------------------------------------------------------------+
+// Host stack
+//--------------------------------------------------------------------+
+
+bool tuh_init(uint8_t rhport);
+void tuh_task(void);
+bool tuh_vid_pid_get(uint8_t daddr, uint16_t* vid, uint16_t* pid);
+uint8_t tuh_descriptor_get_manufacturer_string_sync(uint8_t daddr, uint16_t language_id, void* buffer, uint16_t len);
+uint8_t tuh_descriptor_get_product_string_sync(uint8_t daddr, uint16_t language_id, void* buffer, uint16_t len);
+uint8_t tuh_descriptor_get_serial_string_sync(uint8_t daddr, uint16_t language_id, void* buffer, uint16_t len);
+
+#endif // FAKE_TUSB_H
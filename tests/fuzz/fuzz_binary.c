@@ -0,0 +1,58 @@
+/*
+ * Fuzz target: the binary frame decoder
+ *
+ * Every frame the streaming decoder accepts must re-encode to the bytes it
+ * was decoded from, and its CRC must match kmbox_bin_crc8(). The same input
+ * is then run through the firmware parser, which dispatches the frames.
+ */
+
+#include "kmbox_commands.h"
+#include "kmbox_protocol.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FUZZ_NOW_US     1000000u
+
+static void discard_output(const char* data, size_t len)
+{
+    (void)data;
+    (void)len;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    kmbox_bin_decoder_t dec;
+    kmbox_bin_decoder_reset(&dec);
+
+    size_t frame_start = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (!kmbox_bin_decoder_busy(&dec)) {
+            frame_start = i;
+        }
+        const kmbox_bin_result_t result = kmbox_bin_decoder_feed(&dec, data[i]);
+        if (result != KMBOX_BIN_FRAME_READY) {
+            continue;
+        }
+
+        // The frame ends here and started at the last sync byte seen idle
+        const size_t frame_len = i + 1 - frame_start;
+        if (dec.frame.len > KMBOX_BIN_MAX_PAYLOAD || frame_len != (size_t)KMBOX_BIN_OVERHEAD + dec.frame.len) {
+            abort();
+        }
+        uint8_t encoded[KMBOX_BIN_MAX_FRAME];
+        const size_t len = kmbox_bin_encode(encoded, sizeof(encoded), dec.frame.op, dec.frame.seq,
+                                            dec.frame.payload, dec.frame.len);
+        if (len != frame_len || memcmp(encoded, &data[frame_start], len) != 0) {
+            abort();
+        }
+    }
+
+    kmbox_commands_init();
+    kmbox_commands_set_output(discard_output);
+    for (size_t i = 0; i < size; i++) {
+        kmbox_process_serial_char((char)data[i], FUZZ_NOW_US);
+    }
+    return 0;
+}
@@ -0,0 +1,91 @@
+/*
+ * Fuzz target: HID report descriptor compiler and mouse report decoder
+ *
+ * Input: a little-endian u16 descriptor length, the descriptor, then input
+ * reports, each preceded by its length byte. Whatever the descriptor, the
+ * compiled plans must stay inside the reports they describe and decoding
+ * must only read the bytes it is given (checked by ASan on exact-size
+ * copies).
+ */
+
+#include "hid_report_parser.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void check_field(const hid_mouse_plan_t* plan, const hid_field_t* field)
+{
+    if (field->bit_size == 0) {
+        return;
+    }
+    if (field->bit_size > 32 || (uint32_t)field->bit_offset + field->bit_size > plan->report_bits) {
+        abort();
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    if (size < 2) {
+        return 0;
+    }
+    size_t desc_len = (size_t)data[0] | ((size_t)data[1] << 8);
+    data += 2;
+    size -= 2;
+    if (desc_len > size) {
+        desc_len = size;
+    }
+
+    // Exact-size copy so reads past the descriptor are caught
+    uint8_t* desc = malloc(desc_len ? desc_len : 1);
+    if (desc == NULL) {
+        return 0;
+    }
+    memcpy(desc, data, desc_len);
+
+    hid_mouse_layout_t layout;
+    const bool ok = hid_parser_compile_mouse(desc, desc_len, &layout);
+    free(desc);
+    if (!ok) {
+        if (layout.count != 0) {
+            abort();
+        }
+        return 0;
+    }
+    if (layout.count == 0 || layout.count > HID_PARSER_MAX_REPORTS) {
+        abort();
+    }
+    for (uint8_t i = 0; i < layout.count; i++) {
+        const hid_mouse_plan_t* plan = &layout.plans[i];
+        check_field(plan, &plan->buttons);
+        check_field(plan, &plan->x);
+        check_field(plan, &plan->y);
+        check_field(plan, &plan->wheel);
+        check_field(plan, &plan->pan);
+        if (plan->x.bit_size == 0 || plan->y.bit_size == 0) {
+            abort();
+        }
+    }
+
+    data += desc_len;
+    size -= desc_len;
+    while (size > 0) {
+        size_t report_len = data[0];
+        data++;
+        size--;
+        if (report_len > size) {
+            report_len = size;
+        }
+        uint8_t* report = malloc(report_len ? report_len : 1);
+        if (report == NULL) {
+            return 0;
+        }
+        memcpy(report, data, report_len);
+        hid_mouse_values_t values;
+        hid_parser_decode_mouse(&layout, report, (uint16_t)report_len, &values);
+        free(report);
+        data += report_len;
+        size -= report_len;
+    }
+    return 0;
+}
@@ -0,0 +1,98 @@
+/*
+ * Corpus replay driver for the fuzz targets
+ *
+ * Compilers without libFuzzer link a fuzz target against this main instead,
+ * which runs LLVMFuzzerTestOneInput() once per file. Arguments are files or
+ * directories of files (not recursive). ctest uses it to run the seed
+ * corpora as regression tests.
+ */
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+static int run_file(const char* path)
+{
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return 1;
+    }
+    uint8_t* data = NULL;
+    size_t size = 0;
+    size_t cap = 0;
+    for (;;) {
+        if (size == cap) {
+            cap = cap ? cap * 2 : 4096;
+            uint8_t* grown = realloc(data, cap);
+            if (grown == NULL) {
+                free(data);
+                fclose(f);
+                return 1;
+            }
+            data = grown;
+        }
+        const size_t n = fread(data + size, 1, cap - size, f);
+        if (n == 0) {
+            break;
+        }
+        size += n;
+    }
+    fclose(f);
+
+    // Exact-size buffer so overreads are caught under ASan
+    uint8_t* input = malloc(size ? size : 1);
+    if (input == NULL) {
+        free(data);
+        return 1;
+    }
+    memcpy(input, data, size);
+    free(data);
+    LLVMFuzzerTestOneInput(input, size);
+    free(input);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned files = 0;
+    int status = 0;
+
+    for (int i = 1; i < argc; i++) {
+        struct stat st;
+        if (stat(argv[i], &st) != 0) {
+            perror(argv[i]);
+            return 1;
+        }
+        if (!S_ISDIR(st.st_mode)) {
+            status |= run_file(argv[i]);
+            files++;
+            continue;
+        }
+
+        DIR* dir = opendir(argv[i]);
+        if (dir == NULL) {
+            perror(argv[i]);
+            return 1;
+        }
+        const struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (entry->d_name[0] == '.') {
+                continue;
+            }
+            char path[4096];
+            snprintf(path, sizeof(path), "%s/%s", argv[i], entry->d_name);
+            status |= run_file(path);
+            files++;
+        }
+        closedir(dir);
+    }
+
+    printf("%u inputs replayed\n", files);
+    return (status == 0 && files > 0) ? 0 : 1;
+}
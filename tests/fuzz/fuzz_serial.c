@@ -0,0 +1,115 @@
+/*
+ * Fuzz target: km.* text lines and binary frames through the serial entry
+ * points of the kmbox-commands library
+ *
+ * The first input byte selects how the rest is delivered: in chunks of a
+ * given size through kmbox_process_serial_data() (the DMA path), byte by
+ * byte through kmbox_process_serial_char(), or split at line terminators
+ * and handed to kmbox_process_serial_spans() in two halves (the ring
+ * buffer line path). Button deadlines and movement are then run forward so
+ * the state the commands left behind is exercised too.
+ */
+
+#include "kmbox_commands.h"
+#include "kmbox_protocol.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define FUZZ_NOW_US     1000000u
+
+static void discard_output(const char* data, size_t len)
+{
+    (void)data;
+    (void)len;
+}
+
+static bool accept_baud(uint32_t baud)
+{
+    return baud % 2 == 0;
+}
+
+static void feed_chars(const char* p, const char* end)
+{
+    while (p < end) {
+        kmbox_process_serial_char(*p++, FUZZ_NOW_US);
+    }
+}
+
+static void feed_lines(const uint8_t* data, size_t size, uint8_t split)
+{
+    const char* p = (const char*)data;
+    const char* end = p + size;
+
+    while (p < end) {
+        const char* q = p;
+        while (q < end && *q != '\r' && *q != '\n') {
+            q++;
+        }
+        if (q == end) {
+            // Unterminated tail
+            feed_chars(p, end);
+            break;
+        }
+        const uint8_t term_len = (*q == '\r' && q + 1 < end && q[1] == '\n') ? 2 : 1;
+        const size_t len = (size_t)(q - p);
+
+        // Whole lines only while the parser is between commands, as the
+        // transport does; binary frames and empty lines go byte-wise
+        if (!kmbox_parser_is_idle() || len == 0 || (uint8_t)*p == KMBOX_BIN_SYNC) {
+            feed_chars(p, q + term_len);
+        } else {
+            const size_t first = 1 + split % len;
+            kmbox_process_serial_spans(p, first, p + first, len - first, q, term_len, FUZZ_NOW_US);
+        }
+        p = q + term_len;
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    if (size < 1) {
+        return 0;
+    }
+    const uint8_t mode = data[0];
+    data++;
+    size--;
+
+    kmbox_commands_init();
+    kmbox_commands_set_output(discard_output);
+    kmbox_commands_set_baud_handler(accept_baud, 115200);
+
+    switch (mode & 3) {
+    case 0:
+        kmbox_process_serial_data(data, size, FUZZ_NOW_US);
+        break;
+    case 1: {
+        const size_t chunk = 1 + (mode >> 2);
+        for (size_t i = 0; i < size; i += chunk) {
+            kmbox_process_serial_data(&data[i], (size - i < chunk) ? size - i : chunk, FUZZ_NOW_US);
+        }
+        break;
+    }
+    case 2:
+        for (size_t i = 0; i < size; i++) {
+            kmbox_process_serial_char((char)data[i], FUZZ_NOW_US);
+        }
+        break;
+    default:
+        feed_lines(data, size, mode >> 2);
+        break;
+    }
+
+    // Run paced moves, clicks and releases to completion and drain the
+    // accumulators in both report widths
+    kmbox_set_wide_reports((mode & 0x80) != 0);
+    uint64_t now = FUZZ_NOW_US;
+    for (int i = 0; i < 64; i++) {
+        now += 1000u << (i / 8);
+        kmbox_update_states(now);
+        kmbox_buttons_t buttons;
+        int16_t x, y, wheel, pan;
+        kmbox_get_mouse_report(&buttons, &x, &y, &wheel, &pan);
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+/*
+ * Minimal unit test harness for the host build
+ *
+ * A test is a void function registered in a suite table. The runner forks
+ * for every test, so the firmware's static state starts fresh each time and
+ * a failed check simply ends the child process.
+ */
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef void (*test_fn_t)(void);
+
+typedef struct {
+    const char* name;
+    test_fn_t fn;
+} test_case_t;
+
+typedef struct {
+    const char* name;
+    const test_case_t* cases;   // Terminated by an entry with a NULL name
+} test_suite_t;
+
+#define TEST_CASE(fn)                   { #fn, fn }
+#define TEST_END                        { NULL, NULL }
+
+// Report a failed check and end the test
+void test_fail(const char* file, int line, const char* fmt, ...)
+    __attribute__((noreturn, format(printf, 3, 4)));
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            test_fail(__FILE__, __LINE__, "%s", #cond); \
+        } \
+    } while (0)
+
+#define CHECK_EQ(actual, expected) \
+    do { \
+        const long long actual_ = (long long)(actual); \
+        const long long expected_ = (long long)(expected); \
+        if (actual_ != expected_) { \
+            test_fail(__FILE__, __LINE__, "%s is %lld, expected %lld", #actual, actual_, expected_); \
+        } \
+    } while (0)
+
+#define CHECK_MEM(actual, expected, len) \
+    do { \
+        if (memcmp((actual), (expected), (len)) != 0) { \
+            test_fail(__FILE__, __LINE__, "%s differs from %s", #actual, #expected); \
+        } \
+    } while (0)
+
+// Suites, one per area; registered in test_main.c
+extern const test_suite_t test_suite_passthrough;
+extern const test_suite_t test_suite_injection;
+extern const test_suite_t test_suite_protocol;
+extern const test_suite_t test_suite_parser;
+extern const test_suite_t test_suite_movement;
+extern const test_suite_t test_suite_trace;
+extern const test_suite_t test_suite_descriptors;
+
+#endif // TEST_H
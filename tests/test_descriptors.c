@@ -0,0 +1,424 @@
+/*
+ * Descriptor corpus tests: report descriptors as real mice, composite
+ * devices and non-mouse pointers present them, compiled by
+ * hid_report_parser.c and checked field by field
+ */
+
+#include "test.h"
+#include "hid_report_parser.h"
+#include "tusb.h"
+#include <string.h>
+
+//--------------------------------------------------------------------+
+// Corpus
+//--------------------------------------------------------------------+
+
+// Boot-compatible mouse: 5 buttons, 8-bit X/Y/wheel, AC pan
+static const uint8_t boot_mouse_desc[] = {
+    TUD_HID_REPORT_DESC_MOUSE()
+};
+
+// Gaming mouse: report ID 2, 16 buttons, 16-bit X/Y, 8-bit wheel
+static const uint8_t mouse_16bit_id_desc[] = {
+    HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+    HID_USAGE(HID_USAGE_DESKTOP_MOUSE),
+    HID_COLLECTION(HID_COLLECTION_APPLICATION),
+      HID_REPORT_ID(2)
+      HID_USAGE(HID_USAGE_DESKTOP_POINTER),
+      HID_COLLECTION(HID_COLLECTION_PHYSICAL),
+        HID_USAGE_PAGE(HID_USAGE_PAGE_BUTTON),
+          HID_USAGE_MIN(1),
+          HID_USAGE_MAX(16),
+          HID_LOGICAL_MIN(0),
+          HID_LOGICAL_MAX(1),
+          HID_REPORT_COUNT(16),
+          HID_REPORT_SIZE(1),
+          HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+          HID_USAGE(HID_USAGE_DESKTOP_X),
+          HID_USAGE(HID_USAGE_DESKTOP_Y),
+          HID_LOGICAL_MIN_N(0x8001, 2),
+          HID_LOGICAL_MAX_N(0x7FFF, 2),
+          HID_REPORT_COUNT(2),
+          HID_REPORT_SIZE(16),
+          HID_INPUT(HID_DATA | HID_VARIABLE | HID_RELATIVE),
+          HID_USAGE(HID_USAGE_DESKTOP_WHEEL),
+          HID_LOGICAL_MIN(0x81),
+          HID_LOGICAL_MAX(0x7f),
+          HID_REPORT_COUNT(1),
+          HID_REPORT_SIZE(8),
+          HID_INPUT(HID_DATA | HID_VARIABLE | HID_RELATIVE),
+      HID_COLLECTION_END,
+    HID_COLLECTION_END
+};
+
+// Packed 12-bit X/Y sharing a byte, as on many wireless receivers
+static const uint8_t mouse_12bit_desc[] = {
+    HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+    HID_USAGE(HID_USAGE_DESKTOP_MOUSE),
+    HID_COLLECTION(HID_COLLECTION_APPLICATION),
+      HID_REPORT_ID(2)
+      HID_USAGE(HID_USAGE_DESKTOP_POINTER),
+      HID_COLLECTION(HID_COLLECTION_PHYSICAL),
+        HID_USAGE_PAGE(HID_USAGE_PAGE_BUTTON),
+          HID_USAGE_MIN(1),
+          HID_USAGE_MAX(16),
+          HID_LOGICAL_MIN(0),
+          HID_LOGICAL_MAX(1),
+          HID_REPORT_COUNT(16),
+          HID_REPORT_SIZE(1),
+          HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+          HID_USAGE(HID_USAGE_DESKTOP_X),
+          HID_USAGE(HID_USAGE_DESKTOP_Y),
+          HID_LOGICAL_MIN_N(0xF801, 2),
+          HID_LOGICAL_MAX_N(0x07FF, 2),
+          HID_REPORT_COUNT(2),
+          HID_REPORT_SIZE(12),
+          HID_INPUT(HID_DATA | HID_VARIABLE | HID_RELATIVE),
+          HID_USAGE(HID_USAGE_DESKTOP_WHEEL),
+          HID_LOGICAL_MIN(0x81),
+          HID_LOGICAL_MAX(0x7f),
+          HID_REPORT_COUNT(1),
+          HID_REPORT_SIZE(8),
+          HID_INPUT(HID_DATA | HID_VARIABLE | HID_RELATIVE),
+      HID_COLLECTION_END,
+    HID_COLLECTION_END
+};
+
+// Keyboard and mouse on one interface, told apart by report ID
+static const uint8_t composite_desc[] = {
+    TUD_HID_REPORT_DESC_KEYBOARD(HID_REPORT_ID(1)),
+    TUD_HID_REPORT_DESC_MOUSE(HID_REPORT_ID(2))
+};
+
+// Mouse followed by a vendor-defined collection for configuration data
+static const uint8_t mouse_vendor_desc[] = {
+    TUD_HID_REPORT_DESC_MOUSE(HID_REPORT_ID(1)),
+    HID_USAGE_PAGE_N(HID_USAGE_PAGE_VENDOR, 2),
+    HID_USAGE(0x01),
+    HID_COLLECTION(HID_COLLECTION_APPLICATION),
+      HID_REPORT_ID(0x10)
+      HID_USAGE(0x01),
+      HID_LOGICAL_MIN(0),
+      HID_LOGICAL_MAX_N(0xFF, 2),
+      HID_REPORT_COUNT(19),
+      HID_REPORT_SIZE(8),
+      HID_INPUT(HID_DATA | HID_ARRAY | HID_ABSOLUTE),
+    HID_COLLECTION_END
+};
+
+// Pen tablet in mouse emulation: absolute X/Y over the whole surface
+static const uint8_t absolute_tablet_desc[] = {
+    HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+    HID_USAGE(HID_USAGE_DESKTOP_MOUSE),
+    HID_COLLECTION(HID_COLLECTION_APPLICATION),
+      HID_USAGE(HID_USAGE_DESKTOP_POINTER),
+      HID_COLLECTION(HID_COLLECTION_PHYSICAL),
+        HID_USAGE_PAGE(HID_USAGE_PAGE_BUTTON),
+          HID_USAGE_MIN(1),
+          HID_USAGE_MAX(3),
+          HID_LOGICAL_MIN(0),
+          HID_LOGICAL_MAX(1),
+          HID_REPORT_COUNT(3),
+          HID_REPORT_SIZE(1),
+          HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+          HID_REPORT_COUNT(1),
+          HID_REPORT_SIZE(5),
+          HID_INPUT(HID_CONSTANT),
+        HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+          HID_USAGE(HID_USAGE_DESKTOP_X),
+          HID_USAGE(HID_USAGE_DESKTOP_Y),
+          HID_LOGICAL_MIN(0),
+          HID_LOGICAL_MAX_N(0x7FFF, 2),
+          HID_REPORT_COUNT(2),
+          HID_REPORT_SIZE(16),
+          HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+      HID_COLLECTION_END,
+    HID_COLLECTION_END
+};
+
+// Touch screen that also offers a relative mouse report: only report ID 1
+// can be forwarded
+static const uint8_t mixed_pointer_desc[] = {
+    TUD_HID_REPORT_DESC_MOUSE(HID_REPORT_ID(1)),
+    HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+    HID_USAGE(HID_USAGE_DESKTOP_MOUSE),
+    HID_COLLECTION(HID_COLLECTION_APPLICATION),
+      HID_REPORT_ID(2)
+      HID_USAGE_PAGE(HID_USAGE_PAGE_BUTTON),
+        HID_USAGE_MIN(1),
+        HID_USAGE_MAX(1),
+        HID_LOGICAL_MIN(0),
+        HID_LOGICAL_MAX(1),
+        HID_REPORT_COUNT(8),
+        HID_REPORT_SIZE(1),
+        HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+      HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+        HID_USAGE(HID_USAGE_DESKTOP_X),
+        HID_USAGE(HID_USAGE_DESKTOP_Y),
+        HID_LOGICAL_MIN(0),
+        HID_LOGICAL_MAX_N(0x0FFF, 2),
+        HID_REPORT_COUNT(2),
+        HID_REPORT_SIZE(16),
+        HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+    HID_COLLECTION_END
+};
+
+// Relative X/Y with a wheel declared absolute (a position, not detents)
+static const uint8_t absolute_wheel_desc[] = {
+    HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+    HID_USAGE(HID_USAGE_DESKTOP_MOUSE),
+    HID_COLLECTION(HID_COLLECTION_APPLICATION),
+      HID_USAGE_PAGE(HID_USAGE_PAGE_BUTTON),
+        HID_USAGE_MIN(1),
+        HID_USAGE_MAX(8),
+        HID_LOGICAL_MIN(0),
+        HID_LOGICAL_MAX(1),
+        HID_REPORT_COUNT(8),
+        HID_REPORT_SIZE(1),
+        HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+      HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+        HID_USAGE(HID_USAGE_DESKTOP_X),
+        HID_USAGE(HID_USAGE_DESKTOP_Y),
+        HID_LOGICAL_MIN(0x81),
+        HID_LOGICAL_MAX(0x7f),
+        HID_REPORT_COUNT(2),
+        HID_REPORT_SIZE(8),
+        HID_INPUT(HID_DATA | HID_VARIABLE | HID_RELATIVE),
+        HID_USAGE(HID_USAGE_DESKTOP_WHEEL),
+        HID_LOGICAL_MIN(0),
+        HID_LOGICAL_MAX(0x7f),
+        HID_REPORT_COUNT(1),
+        HID_REPORT_SIZE(8),
+        HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+    HID_COLLECTION_END
+};
+
+static const uint8_t keyboard_desc[] = {
+    TUD_HID_REPORT_DESC_KEYBOARD()
+};
+
+static const uint8_t unbalanced_desc[] = {
+    TUD_HID_REPORT_DESC_MOUSE(),
+    HID_COLLECTION_END
+};
+
+static const uint8_t pop_without_push_desc[] = {
+    HID_POP,
+    TUD_HID_REPORT_DESC_MOUSE()
+};
+
+//--------------------------------------------------------------------+
+// Helpers
+//--------------------------------------------------------------------+
+
+static void check_field(const hid_field_t* field, uint16_t bit_offset, uint8_t bit_size, bool is_signed)
+{
+    CHECK_EQ(field->bit_offset, bit_offset);
+    CHECK_EQ(field->bit_size, bit_size);
+    CHECK_EQ(field->is_signed, is_signed);
+}
+
+static void compile(const uint8_t* desc, size_t len, hid_mouse_layout_t* layout)
+{
+    CHECK(hid_parser_compile_mouse(desc, len, layout));
+    CHECK_EQ(layout->count, 1);
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+
+static void test_boot_mouse(void)
+{
+    hid_mouse_layout_t layout;
+    compile(boot_mouse_desc, sizeof(boot_mouse_desc), &layout);
+
+    const hid_mouse_plan_t* plan = &layout.plans[0];
+    CHECK(!layout.uses_report_ids);
+    CHECK_EQ(plan->button_count, 5);
+    CHECK_EQ(plan->report_bits, 40);
+    check_field(&plan->buttons, 0, 5, false);
+    check_field(&plan->x, 8, 8, true);
+    check_field(&plan->y, 16, 8, true);
+    check_field(&plan->wheel, 24, 8, true);
+    check_field(&plan->pan, 32, 8, true);
+
+    const uint8_t report[] = { 0x03, 0xFB, 0x07, 0x01, 0xFF };
+    hid_mouse_values_t values;
+    CHECK(hid_parser_decode_mouse(&layout, report, sizeof(report), &values));
+    CHECK_EQ(values.buttons, 0x03);
+    CHECK_EQ(values.x, -5);
+    CHECK_EQ(values.y, 7);
+    CHECK_EQ(values.wheel, 1);
+    CHECK_EQ(values.pan, -1);
+}
+
+static void test_16bit_mouse_with_report_id(void)
+{
+    hid_mouse_layout_t layout;
+    compile(mouse_16bit_id_desc, sizeof(mouse_16bit_id_desc), &layout);
+
+    const hid_mouse_plan_t* plan = &layout.plans[0];
+    CHECK(layout.uses_report_ids);
+    CHECK_EQ(plan->report_id, 2);
+    CHECK_EQ(plan->button_count, 16);
+    CHECK_EQ(plan->report_bits, 56);
+    check_field(&plan->x, 16, 16, true);
+    check_field(&plan->y, 32, 16, true);
+    check_field(&plan->wheel, 48, 8, true);
+    CHECK_EQ(plan->pan.bit_size, 0);
+
+    const uint8_t report[] = { 0x02, 0x01, 0x80, 0x34, 0x12, 0xFE, 0xFF, 0x01 };
+    hid_mouse_values_t values;
+    CHECK(hid_parser_decode_mouse(&layout, report, sizeof(report), &values));
+    CHECK_EQ(values.buttons, 0x8001);
+    CHECK_EQ(values.x, 0x1234);
+    CHECK_EQ(values.y, -2);
+    CHECK_EQ(values.wheel, 1);
+
+    // Another report ID is not a mouse report
+    const uint8_t other[] = { 0x03, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00 };
+    CHECK(!hid_parser_decode_mouse(&layout, other, sizeof(other), &values));
+}
+
+static void test_packed_12bit_mouse(void)
+{
+    hid_mouse_layout_t layout;
+    compile(mouse_12bit_desc, sizeof(mouse_12bit_desc), &layout);
+
+    const hid_mouse_plan_t* plan = &layout.plans[0];
+    CHECK_EQ(plan->report_bits, 48);
+    check_field(&plan->x, 16, 12, true);
+    check_field(&plan->y, 28, 12, true);
+    check_field(&plan->wheel, 40, 8, true);
+
+    // X = -5 (0xFFB) and Y = 300 (0x12C) share the middle byte
+    const uint8_t report[] = { 0x02, 0x00, 0x00, 0xFB, 0xCF, 0x12, 0xFF };
+    hid_mouse_values_t values;
+    CHECK(hid_parser_decode_mouse(&layout, report, sizeof(report), &values));
+    CHECK_EQ(values.x, -5);
+    CHECK_EQ(values.y, 300);
+    CHECK_EQ(values.wheel, -1);
+}
+
+static void test_composite_keyboard_mouse(void)
+{
+    hid_mouse_layout_t layout;
+    compile(composite_desc, sizeof(composite_desc), &layout);
+    CHECK(layout.uses_report_ids);
+    CHECK_EQ(layout.plans[0].report_id, 2);
+    check_field(&layout.plans[0].x, 8, 8, true);
+
+    hid_mouse_values_t values;
+    const uint8_t keys[] = { 0x01, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00 };
+    CHECK(!hid_parser_decode_mouse(&layout, keys, sizeof(keys), &values));
+
+    const uint8_t mouse[] = { 0x02, 0x01, 0x0A, 0xF6, 0x00, 0x00 };
+    CHECK(hid_parser_decode_mouse(&layout, mouse, sizeof(mouse), &values));
+    CHECK_EQ(values.buttons, 0x01);
+    CHECK_EQ(values.x, 10);
+    CHECK_EQ(values.y, -10);
+}
+
+static void test_mouse_with_vendor_collection(void)
+{
+    hid_mouse_layout_t layout;
+    compile(mouse_vendor_desc, sizeof(mouse_vendor_desc), &layout);
+    CHECK_EQ(layout.plans[0].report_id, 1);
+    CHECK_EQ(layout.plans[0].report_bits, 40);
+
+    hid_mouse_values_t values;
+    uint8_t vendor[20] = { 0x10 };
+    CHECK(!hid_parser_decode_mouse(&layout, vendor, sizeof(vendor), &values));
+}
+
+static void test_absolute_tablet_rejected(void)
+{
+    hid_mouse_layout_t layout;
+    CHECK(!hid_parser_compile_mouse(absolute_tablet_desc, sizeof(absolute_tablet_desc), &layout));
+    CHECK_EQ(layout.count, 0);
+}
+
+static void test_absolute_report_skipped(void)
+{
+    hid_mouse_layout_t layout;
+    compile(mixed_pointer_desc, sizeof(mixed_pointer_desc), &layout);
+    CHECK_EQ(layout.plans[0].report_id, 1);
+    CHECK(layout.plans[0].x.is_relative);
+
+    hid_mouse_values_t values;
+    const uint8_t touch[] = { 0x02, 0x01, 0x00, 0x08, 0x00, 0x04 };
+    CHECK(!hid_parser_decode_mouse(&layout, touch, sizeof(touch), &values));
+}
+
+static void test_absolute_wheel_left_out(void)
+{
+    hid_mouse_layout_t layout;
+    compile(absolute_wheel_desc, sizeof(absolute_wheel_desc), &layout);
+    check_field(&layout.plans[0].x, 8, 8, true);
+    CHECK_EQ(layout.plans[0].wheel.bit_size, 0);
+
+    const uint8_t report[] = { 0x00, 0x01, 0x02, 0x40 };
+    hid_mouse_values_t values;
+    CHECK(hid_parser_decode_mouse(&layout, report, sizeof(report), &values));
+    CHECK_EQ(values.x, 1);
+    CHECK_EQ(values.y, 2);
+    CHECK_EQ(values.wheel, 0);
+}
+
+static void test_keyboard_rejected(void)
+{
+    hid_mouse_layout_t layout;
+    CHECK(!hid_parser_compile_mouse(keyboard_desc, sizeof(keyboard_desc), &layout));
+    CHECK_EQ(layout.count, 0);
+}
+
+static void test_malformed_rejected(void)
+{
+    hid_mouse_layout_t layout;
+    CHECK(!hid_parser_compile_mouse(unbalanced_desc, sizeof(unbalanced_desc), &layout));
+    CHECK(!hid_parser_compile_mouse(pop_without_push_desc, sizeof(pop_without_push_desc), &layout));
+
+    // Cut inside the two-byte logical minimum of the X/Y item
+    size_t cut = 0;
+    while (cut < sizeof(mouse_16bit_id_desc) && mouse_16bit_id_desc[cut] != 0x16) {
+        cut++;
+    }
+    CHECK(cut < sizeof(mouse_16bit_id_desc));
+    CHECK(!hid_parser_compile_mouse(mouse_16bit_id_desc, cut + 2, &layout));
+    CHECK_EQ(layout.count, 0);
+}
+
+static void test_every_truncation_is_safe(void)
+{
+    // Any prefix either compiles to a plan inside the declared report or is
+    // rejected with an empty layout
+    for (size_t len = 0; len <= sizeof(mouse_12bit_desc); len++) {
+        hid_mouse_layout_t layout;
+        if (hid_parser_compile_mouse(mouse_12bit_desc, len, &layout)) {
+            const hid_mouse_plan_t* plan = &layout.plans[0];
+            CHECK(plan->y.bit_offset + plan->y.bit_size <= plan->report_bits);
+        } else {
+            CHECK_EQ(layout.count, 0);
+        }
+    }
+}
+
+static const test_case_t cases[] = {
+    TEST_CASE(test_boot_mouse),
+    TEST_CASE(test_16bit_mouse_with_report_id),
+    TEST_CASE(test_packed_12bit_mouse),
+    TEST_CASE(test_composite_keyboard_mouse),
+    TEST_CASE(test_mouse_with_vendor_collection),
+    TEST_CASE(test_absolute_tablet_rejected),
+    TEST_CASE(test_absolute_report_skipped),
+    TEST_CASE(test_absolute_wheel_left_out),
+    TEST_CASE(test_keyboard_rejected),
+    TEST_CASE(test_malformed_rejected),
+    TEST_CASE(test_every_truncation_is_safe),
+    TEST_END
+};
+
+const test_suite_t test_suite_descriptors = { "descriptors", cases };
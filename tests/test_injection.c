@@ -0,0 +1,143 @@
+/*
+ * Injection tests: km.* commands over the KMBox UART to the device endpoint
+ *
+ * Commands arrive through the scripted UART at the real baud rate, so the
+ * frame a command completes in is known and the frame its report goes out
+ * in can be compared against it.
+ */
+
+#include "test.h"
+#include "fake_firmware.h"
+#include "fake_sdk.h"
+#include "fake_tusb.h"
+#include "fake_uart.h"
+#include "usb_hid.h"
+#include "kmbox_commands.h"
+#include "defines.h"
+#include "pico/stdlib.h"
+#include <string.h>
+
+#define MOUSE_DEV       1
+#define LOOP_US         20
+
+static const uint8_t boot_mouse_desc[] = {
+    TUD_HID_REPORT_DESC_MOUSE()
+};
+
+static void setup_idle(bool with_mouse)
+{
+    fake_firmware_init();
+    if (with_mouse) {
+        fake_host_attach(MOUSE_DEV, 0, 0x046D, 0xC077, HID_ITF_PROTOCOL_MOUSE,
+                         boot_mouse_desc, sizeof(boot_mouse_desc));
+    }
+    fake_firmware_run_for(FAKE_FIRMWARE_ATTACH_SETTLE_US, LOOP_US);
+    fake_uart_set_paced(true);
+    fake_usb_clear_reports();
+}
+
+static const fake_usb_report_t* first_mouse_report(void)
+{
+    for (size_t i = 0; i < fake_usb_report_count(); i++) {
+        const fake_usb_report_t* report = fake_usb_report(i);
+        if (report->report_id == REPORT_ID_MOUSE) {
+            return report;
+        }
+    }
+    return NULL;
+}
+
+// Queue a command so its last byte lands phase_us into a frame, and run
+// until it has arrived; returns the frame it completed in
+static uint32_t send_command_at_phase(const char* command, uint32_t phase_us)
+{
+    fake_usb_clear_reports();
+
+    // Start early enough for the line to be done at the requested phase
+    const uint64_t now = time_us_64();
+    const uint64_t byte_us = (10u * 1000000u + fake_uart_baudrate() - 1) / fake_uart_baudrate();
+    const uint64_t wire_us = strlen(command) * byte_us;
+    uint64_t done = now + wire_us + 2 * USB_FRAME_US;
+    done = done - done % USB_FRAME_US + phase_us;
+    fake_firmware_run_until(done - wire_us, LOOP_US);
+
+    CHECK(fake_uart_rx_str(command));
+    CHECK_EQ(fake_uart_rx_done_us(), done);
+    fake_firmware_run_until(done, LOOP_US);
+    return fake_usb_frame_count();
+}
+
+// Frames between the frame a command completed in and the frame whose IN
+// transaction carried its report
+static uint32_t frames_to_wire(const char* command, uint32_t phase_us)
+{
+    const uint32_t arrival_frame = send_command_at_phase(command, phase_us);
+
+    fake_firmware_run_for(5 * USB_FRAME_US, LOOP_US);
+    const fake_usb_report_t* report = first_mouse_report();
+    CHECK(report != NULL);
+    return report->frame - arrival_frame;
+}
+
+static void test_move_without_physical_input_within_one_frame(void)
+{
+    setup_idle(false);
+
+    // No physical mouse at all: the scheduler alone must send the move, in
+    // the frame after the one the command completed in, whatever the phase
+    for (uint32_t phase = 0; phase < USB_FRAME_US; phase += 50) {
+        const uint32_t frames = frames_to_wire("km.move(5,3)\r\n", phase);
+        if (frames > 1) {
+            test_fail(__FILE__, __LINE__, "command done %u us into a frame took %u frames",
+                      (unsigned)phase, (unsigned)frames);
+        }
+    }
+}
+
+static void test_move_report_contents(void)
+{
+    setup_idle(true);
+
+    frames_to_wire("km.move(5,-3)\r\n", 100);
+
+    CHECK_EQ(fake_usb_report_count(), 1);
+    const hid_mouse_report_t* sent = (const hid_mouse_report_t*)first_mouse_report()->data;
+    CHECK_EQ(sent->buttons, 0);
+    CHECK_EQ(sent->x, 5);
+    CHECK_EQ(sent->y, -3);
+}
+
+static void test_move_merges_with_physical_report(void)
+{
+    setup_idle(true);
+
+    // A physical report in the same frame goes out in the same report
+    send_command_at_phase("km.move(5,3)\r\n", 300);
+    const uint8_t physical[] = { 0x00, 2, 1, 0, 0 };
+    fake_host_report(MOUSE_DEV, 0, physical, sizeof(physical));
+    fake_firmware_run_for(5 * USB_FRAME_US, LOOP_US);
+
+    CHECK_EQ(fake_usb_report_count(), 1);
+    const hid_mouse_report_t* sent = (const hid_mouse_report_t*)first_mouse_report()->data;
+    CHECK_EQ(sent->x, 7);
+    CHECK_EQ(sent->y, 4);
+}
+
+static void test_button_press_sent_without_movement(void)
+{
+    setup_idle(false);
+
+    const uint32_t frames = frames_to_wire("km.left(1)\r\n", 500);
+    CHECK(frames <= 1);
+    CHECK_EQ(((const hid_mouse_report_t*)first_mouse_report()->data)->buttons, 1u << KMBOX_BUTTON_LEFT);
+}
+
+static const test_case_t cases[] = {
+    TEST_CASE(test_move_without_physical_input_within_one_frame),
+    TEST_CASE(test_move_report_contents),
+    TEST_CASE(test_move_merges_with_physical_report),
+    TEST_CASE(test_button_press_sent_without_movement),
+    TEST_END
+};
+
+const test_suite_t test_suite_injection = { "injection", cases };
@@ -0,0 +1,101 @@
+/*
+ * Host unit test runner
+ *
+ * Usage: piokmbox_tests [suite [test]]
+ * Runs every test of the selected suites, each in its own process, and
+ * exits non-zero if any failed. ctest runs one suite per test entry.
+ */
+
+#include "test.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static const test_suite_t* const g_suites[] = {
+    &test_suite_passthrough,
+    &test_suite_injection,
+    &test_suite_protocol,
+    &test_suite_parser,
+    &test_suite_movement,
+    &test_suite_trace,
+    &test_suite_descriptors,
+};
+
+#define SUITE_COUNT (sizeof(g_suites) / sizeof(g_suites[0]))
+
+void test_fail(const char* file, int line, const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "%s:%d: check failed: ", file, line);
+    vfprintf(stderr, fmt, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    exit(1);
+}
+
+static bool run_case(const test_suite_t* suite, const test_case_t* tc)
+{
+    fflush(stdout);
+    fflush(stderr);
+
+    const pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return false;
+    }
+    if (pid == 0) {
+        // The firmware logs with printf; keep it out of the results
+        if (freopen("/dev/null", "w", stdout) == NULL) {
+            exit(2);
+        }
+        tc->fn();
+        exit(0);
+    }
+
+    int status = 0;
+    if (waitpid(pid, &status, 0) < 0) {
+        perror("waitpid");
+        return false;
+    }
+    const bool passed = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    if (WIFSIGNALED(status)) {
+        fprintf(stderr, "%s.%s: killed by signal %d\n", suite->name, tc->name, WTERMSIG(status));
+    }
+    printf("%-6s %s.%s\n", passed ? "PASS" : "FAIL", suite->name, tc->name);
+    return passed;
+}
+
+int main(int argc, char** argv)
+{
+    const char* suite_filter = (argc > 1) ? argv[1] : NULL;
+    const char* case_filter = (argc > 2) ? argv[2] : NULL;
+    unsigned run = 0;
+    unsigned failed = 0;
+
+    for (size_t s = 0; s < SUITE_COUNT; s++) {
+        const test_suite_t* suite = g_suites[s];
+        if (suite_filter != NULL && strcmp(suite_filter, suite->name) != 0) {
+            continue;
+        }
+        for (const test_case_t* tc = suite->cases; tc->name != NULL; tc++) {
+            if (case_filter != NULL && strcmp(case_filter, tc->name) != 0) {
+                continue;
+            }
+            run++;
+            if (!run_case(suite, tc)) {
+                failed++;
+            }
+        }
+    }
+
+    if (run == 0) {
+        fprintf(stderr, "no tests matched\n");
+        return 1;
+    }
+    printf("%u tests, %u failed\n", run, failed);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,192 @@
+/*
+ * Movement tests: how commanded and physical X/Y movement share the mouse
+ * report under the drain policies, and how scroll beyond one report drains
+ */
+
+#include "test.h"
+#include "kmbox_commands.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NOW_US          1000000u
+
+//--------------------------------------------------------------------+
+// Helpers
+//--------------------------------------------------------------------+
+
+static void discard_output(const char* data, size_t len)
+{
+    (void)data;
+    (void)len;
+}
+
+static void reset_commands(void)
+{
+    kmbox_commands_init();
+    kmbox_commands_set_output(discard_output);
+    kmbox_set_echo_mode(KMBOX_ECHO_SILENT);
+}
+
+static void send_line(const char* line)
+{
+    const uint32_t commands = kmbox_get_command_count();
+    kmbox_process_serial_data((const uint8_t*)line, strlen(line), NOW_US);
+    CHECK_EQ(kmbox_get_command_count() - commands, 1);
+}
+
+static void next_report(int16_t* x, int16_t* y)
+{
+    kmbox_buttons_t buttons;
+    int16_t wheel, pan;
+    kmbox_get_mouse_report(&buttons, x, y, &wheel, &pan);
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+
+static void test_capped_drain_does_not_limit_physical(void)
+{
+    reset_commands();
+    CHECK(kmbox_set_drain_mode(KMBOX_DRAIN_CAPPED, 4));
+    send_line("km.move(100,-100)\r\n");
+    kmbox_add_mouse_movement(50, -60);
+
+    int16_t x, y;
+    next_report(&x, &y);
+    CHECK_EQ(x, 54);
+    CHECK_EQ(y, -64);
+
+    // The commanded backlog keeps draining at the cap on its own
+    next_report(&x, &y);
+    CHECK_EQ(x, 4);
+    CHECK_EQ(y, -4);
+}
+
+static void test_paced_drain_does_not_limit_physical(void)
+{
+    reset_commands();
+    CHECK(kmbox_set_drain_mode(KMBOX_DRAIN_PACED, 10));
+    send_line("km.move(100,-50)\r\n");
+    kmbox_add_mouse_movement(20, 20);
+
+    int16_t x, y;
+    next_report(&x, &y);
+    CHECK_EQ(x, 30);
+    CHECK_EQ(y, 15);
+
+    int32_t total_x = x - 20;
+    for (int i = 1; i < 10; i++) {
+        next_report(&x, &y);
+        CHECK_EQ(x, 10);
+        total_x += x;
+    }
+    CHECK_EQ(total_x, 100);
+    CHECK(!kmbox_has_pending_report());
+}
+
+static void test_physical_takes_precedence_in_a_full_report(void)
+{
+    reset_commands();
+    send_line("km.move(10,0)\r\n");
+    kmbox_add_mouse_movement(120, 0);
+    kmbox_add_mouse_movement(80, 0);
+
+    // Physical movement fills the 8-bit report first; commanded movement
+    // follows in what is left
+    int16_t x, y;
+    next_report(&x, &y);
+    CHECK_EQ(x, 127);
+    next_report(&x, &y);
+    CHECK_EQ(x, 83);
+    CHECK(!kmbox_has_pending_report());
+}
+
+static void test_no_movement_lost_under_any_policy(void)
+{
+    static const struct {
+        kmbox_drain_mode_t mode;
+        uint16_t param;
+    } policies[] = {
+        { KMBOX_DRAIN_IMMEDIATE, 0 },
+        { KMBOX_DRAIN_CAPPED, 1 },
+        { KMBOX_DRAIN_CAPPED, 127 },
+        { KMBOX_DRAIN_PACED, 3 },
+        { KMBOX_DRAIN_PACED, 50 },
+    };
+
+    for (size_t p = 0; p < sizeof(policies) / sizeof(policies[0]); p++) {
+        reset_commands();
+        CHECK(kmbox_set_drain_mode(policies[p].mode, policies[p].param));
+        srand(1234 + (unsigned)p);
+
+        int64_t added_x = 0, added_y = 0, emitted_x = 0, emitted_y = 0;
+        for (int i = 0; i < 2000; i++) {
+            if (rand() % 4 == 0) {
+                char line[32];
+                const int mx = rand() % 2001 - 1000;
+                const int my = rand() % 2001 - 1000;
+                snprintf(line, sizeof(line), "km.move(%d,%d)\r\n", mx, my);
+                send_line(line);
+                added_x += mx;
+                added_y += my;
+            }
+            const int16_t px = (int16_t)(rand() % 255 - 127);
+            const int16_t py = (int16_t)(rand() % 255 - 127);
+            kmbox_add_mouse_movement(px, py);
+            added_x += px;
+            added_y += py;
+
+            int16_t x, y;
+            next_report(&x, &y);
+            CHECK(x >= INT8_MIN && x <= INT8_MAX);
+            CHECK(y >= INT8_MIN && y <= INT8_MAX);
+            emitted_x += x;
+            emitted_y += y;
+        }
+        for (int i = 0; i < 100000 && kmbox_has_pending_report(); i++) {
+            int16_t x, y;
+            next_report(&x, &y);
+            emitted_x += x;
+            emitted_y += y;
+        }
+        CHECK_EQ(emitted_x, added_x);
+        CHECK_EQ(emitted_y, added_y);
+
+        kmbox_movement_stats_t stats;
+        kmbox_get_movement_stats(&stats);
+        CHECK_EQ(stats.lost_x, 0);
+        CHECK_EQ(stats.lost_y, 0);
+    }
+}
+
+static void test_wheel_beyond_one_report_not_lost(void)
+{
+    reset_commands();
+    send_line("km.wheel(300)\r\n");
+
+    int32_t total = 0;
+    int reports = 0;
+    while (kmbox_has_pending_report() && reports < 16) {
+        kmbox_buttons_t buttons;
+        int16_t x, y, wheel, pan;
+        kmbox_get_mouse_report(&buttons, &x, &y, &wheel, &pan);
+        CHECK(wheel >= 0 && wheel <= INT8_MAX);
+        total += wheel;
+        reports++;
+    }
+    CHECK_EQ(total, 300);
+    CHECK_EQ(reports, 3);
+}
+
+static const test_case_t cases[] = {
+    TEST_CASE(test_capped_drain_does_not_limit_physical),
+    TEST_CASE(test_paced_drain_does_not_limit_physical),
+    TEST_CASE(test_physical_takes_precedence_in_a_full_report),
+    TEST_CASE(test_no_movement_lost_under_any_policy),
+    TEST_CASE(test_wheel_beyond_one_report_not_lost),
+    TEST_END
+};
+
+const test_suite_t test_suite_movement = { "movement", cases };
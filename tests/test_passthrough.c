@@ -0,0 +1,391 @@
+/*
+ * Passthrough tests: host reports through usb_hid.c to the device endpoint
+ */
+
+#include "test.h"
+#include "fake_firmware.h"
+#include "fake_sdk.h"
+#include "fake_tusb.h"
+#include "fake_uart.h"
+#include "usb_hid.h"
+#include "hid_report_parser.h"
+#include "kmbox_commands.h"
+#include "pico/stdlib.h"
+#include <string.h>
+
+#define MOUSE_DEV       1
+#define KEYBOARD_DEV    2
+#define LOOP_US         50
+
+static const uint8_t boot_mouse_desc[] = {
+    TUD_HID_REPORT_DESC_MOUSE()
+};
+
+// Boot layout with all eight bits of the button byte used
+static const uint8_t eight_button_mouse_desc[] = {
+    HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+    HID_USAGE(HID_USAGE_DESKTOP_MOUSE),
+    HID_COLLECTION(HID_COLLECTION_APPLICATION),
+      HID_USAGE(HID_USAGE_DESKTOP_POINTER),
+      HID_COLLECTION(HID_COLLECTION_PHYSICAL),
+        HID_USAGE_PAGE(HID_USAGE_PAGE_BUTTON),
+          HID_USAGE_MIN(1),
+          HID_USAGE_MAX(8),
+          HID_LOGICAL_MIN(0),
+          HID_LOGICAL_MAX(1),
+          HID_REPORT_COUNT(8),
+          HID_REPORT_SIZE(1),
+          HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+        HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+          HID_USAGE(HID_USAGE_DESKTOP_X),
+          HID_USAGE(HID_USAGE_DESKTOP_Y),
+          HID_USAGE(HID_USAGE_DESKTOP_WHEEL),
+          HID_LOGICAL_MIN(0x81),
+          HID_LOGICAL_MAX(0x7f),
+          HID_REPORT_COUNT(3),
+          HID_REPORT_SIZE(8),
+          HID_INPUT(HID_DATA | HID_VARIABLE | HID_RELATIVE),
+      HID_COLLECTION_END,
+    HID_COLLECTION_END
+};
+
+static const uint8_t boot_keyboard_desc[] = {
+    TUD_HID_REPORT_DESC_KEYBOARD()
+};
+
+// Report ID 1, 16-bit X/Y: needs the wide device report
+static const uint8_t wide_mouse_desc[] = {
+    HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+    HID_USAGE(HID_USAGE_DESKTOP_MOUSE),
+    HID_COLLECTION(HID_COLLECTION_APPLICATION),
+      HID_REPORT_ID(1)
+      HID_USAGE_PAGE(HID_USAGE_PAGE_BUTTON),
+        HID_USAGE_MIN(1),
+        HID_USAGE_MAX(8),
+        HID_LOGICAL_MIN(0),
+        HID_LOGICAL_MAX(1),
+        HID_REPORT_COUNT(8),
+        HID_REPORT_SIZE(1),
+        HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+      HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+        HID_USAGE(HID_USAGE_DESKTOP_X),
+        HID_USAGE(HID_USAGE_DESKTOP_Y),
+        HID_LOGICAL_MIN_N(0x8001, 2),
+        HID_LOGICAL_MAX_N(0x7FFF, 2),
+        HID_REPORT_COUNT(2),
+        HID_REPORT_SIZE(16),
+        HID_INPUT(HID_DATA | HID_VARIABLE | HID_RELATIVE),
+    HID_COLLECTION_END
+};
+
+// Absolute X/Y only: no report protocol plan, the boot format is used
+static const uint8_t absolute_pointer_desc[] = {
+    HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+    HID_USAGE(HID_USAGE_DESKTOP_MOUSE),
+    HID_COLLECTION(HID_COLLECTION_APPLICATION),
+      HID_USAGE_PAGE(HID_USAGE_PAGE_BUTTON),
+        HID_USAGE_MIN(1),
+        HID_USAGE_MAX(8),
+        HID_LOGICAL_MIN(0),
+        HID_LOGICAL_MAX(1),
+        HID_REPORT_COUNT(8),
+        HID_REPORT_SIZE(1),
+        HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+      HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+        HID_USAGE(HID_USAGE_DESKTOP_X),
+        HID_USAGE(HID_USAGE_DESKTOP_Y),
+        HID_LOGICAL_MIN(0),
+        HID_LOGICAL_MAX_N(0x7FFF, 2),
+        HID_REPORT_COUNT(2),
+        HID_REPORT_SIZE(16),
+        HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+    HID_COLLECTION_END
+};
+
+// Firmware up, device mounted and a boot-layout mouse attached and settled
+static void setup_with_mouse(void)
+{
+    fake_firmware_init();
+    fake_host_attach(MOUSE_DEV, 0, 0x046D, 0xC077, HID_ITF_PROTOCOL_MOUSE,
+                     boot_mouse_desc, sizeof(boot_mouse_desc));
+    fake_firmware_run_for(FAKE_FIRMWARE_ATTACH_SETTLE_US, LOOP_US);
+    fake_usb_clear_reports();
+}
+
+// Run to just after the next SOF, so input delivered now waits for the
+// send window of this frame
+static void align_to_frame_start(void)
+{
+    const uint64_t now = time_us_64();
+    fake_firmware_run_until(now - now % USB_FRAME_US + USB_FRAME_US + LOOP_US, LOOP_US);
+}
+
+static void test_mouse_report_forwarded(void)
+{
+    setup_with_mouse();
+    align_to_frame_start();
+
+    const uint8_t report[] = { 0x01, 5, (uint8_t)-3, 1, 0 };
+    fake_host_report(MOUSE_DEV, 0, report, sizeof(report));
+    fake_firmware_run_for(3000, LOOP_US);
+
+    CHECK_EQ(fake_usb_report_count(), 1);
+    const fake_usb_report_t* sent = fake_usb_last_report();
+    CHECK_EQ(sent->report_id, REPORT_ID_MOUSE);
+    CHECK_EQ(sent->len, sizeof(hid_mouse_report_t));
+    CHECK_MEM(sent->data, report, sizeof(report));
+}
+
+static void test_extra_buttons_forwarded(void)
+{
+    fake_firmware_init();
+    fake_host_attach(MOUSE_DEV, 0, 0x046D, 0xC077, HID_ITF_PROTOCOL_MOUSE,
+                     eight_button_mouse_desc, sizeof(eight_button_mouse_desc));
+    fake_firmware_run_for(FAKE_FIRMWARE_ATTACH_SETTLE_US, LOOP_US);
+    fake_usb_clear_reports();
+    align_to_frame_start();
+
+    // Buttons 6 to 8 are above the five named ones and follow the mouse
+    const uint8_t report[] = { 0xE1, 2, 0, 0 };
+    fake_host_report(MOUSE_DEV, 0, report, sizeof(report));
+    fake_firmware_run_for(3000, LOOP_US);
+
+    CHECK_EQ(fake_usb_report_count(), 1);
+    const hid_mouse_report_t* sent = (const hid_mouse_report_t*)fake_usb_last_report()->data;
+    CHECK_EQ(sent->buttons, 0xE1 & KMBOX_BUTTONS_ALL);
+    CHECK_EQ(sent->x, 2);
+}
+
+static void test_reports_in_one_frame_are_merged(void)
+{
+    setup_with_mouse();
+    align_to_frame_start();
+
+    for (int8_t x = 1; x <= 3; x++) {
+        const uint8_t report[] = { 0x00, (uint8_t)x, (uint8_t)-x, 0, 0 };
+        fake_host_report(MOUSE_DEV, 0, report, sizeof(report));
+    }
+    fake_firmware_run_for(3000, LOOP_US);
+
+    CHECK_EQ(fake_usb_report_count(), 1);
+    const hid_mouse_report_t* sent = (const hid_mouse_report_t*)fake_usb_last_report()->data;
+    CHECK_EQ(sent->x, 6);
+    CHECK_EQ(sent->y, -6);
+
+    mouse_coalesce_stats_t stats;
+    usb_hid_get_mouse_coalesce_stats(&stats);
+    CHECK_EQ(stats.merged, 2);
+}
+
+static void test_input_while_busy_goes_out_next_frame(void)
+{
+    setup_with_mouse();
+    align_to_frame_start();
+
+    const uint8_t first[] = { 0x00, 10, 0, 0, 0 };
+    fake_host_report(MOUSE_DEV, 0, first, sizeof(first));
+
+    // Armed at the send window, collected at the next SOF; input arriving
+    // in between must not be lost
+    fake_firmware_run_for(USB_FRAME_US - 2 * LOOP_US, LOOP_US);
+    const uint8_t second[] = { 0x00, 7, 0, 0, 0 };
+    fake_host_report(MOUSE_DEV, 0, second, sizeof(second));
+    fake_firmware_run_for(4000, LOOP_US);
+
+    CHECK_EQ(fake_usb_report_count(), 2);
+    CHECK_EQ(((const hid_mouse_report_t*)fake_usb_report(0)->data)->x, 10);
+    CHECK_EQ(((const hid_mouse_report_t*)fake_usb_report(1)->data)->x, 7);
+    CHECK(fake_usb_report(1)->frame > fake_usb_report(0)->frame);
+}
+
+static void test_stale_sof_sends_immediately(void)
+{
+    setup_with_mouse();
+    align_to_frame_start();
+    hid_sof_stats_t before;
+    usb_hid_get_sof_stats(&before);
+
+    // Early in the frame the report waits for the send window
+    const uint8_t report[] = { 0x00, 3, 0, 0, 0 };
+    fake_host_report(MOUSE_DEV, 0, report, sizeof(report));
+    hid_host_task(time_us_64());
+    CHECK(!usb_hid_flush_mouse_report(time_us_64()));
+
+    // A stalled loop: the next SOF has not been delivered by tud_task(), so
+    // the last timestamp is over a frame old and the report goes out at once
+    fake_time_advance_us(USB_FRAME_US + LOOP_US);
+    CHECK(usb_hid_flush_mouse_report(time_us_64()));
+
+    hid_sof_stats_t after;
+    usb_hid_get_sof_stats(&after);
+    CHECK_EQ(after.synced_reports, before.synced_reports);
+    CHECK_EQ(after.unsynced_reports, before.unsynced_reports + 1);
+}
+
+static void test_keyboard_report_forwarded_once(void)
+{
+    fake_firmware_init();
+    fake_host_attach(KEYBOARD_DEV, 0, 0x04D9, 0x1702, HID_ITF_PROTOCOL_KEYBOARD,
+                     boot_keyboard_desc, sizeof(boot_keyboard_desc));
+    fake_firmware_run_for(FAKE_FIRMWARE_ATTACH_SETTLE_US, LOOP_US);
+    fake_usb_clear_reports();
+
+    const uint8_t report[8] = { 0x02, 0, 0x04, 0, 0, 0, 0, 0 };
+    fake_host_report(KEYBOARD_DEV, 0, report, sizeof(report));
+    fake_firmware_run_for(3000, LOOP_US);
+    fake_host_report(KEYBOARD_DEV, 0, report, sizeof(report));
+    fake_firmware_run_for(3000, LOOP_US);
+
+    // Sent on change only: the repeated report is not sent again
+    CHECK_EQ(fake_usb_report_count(), 1);
+    const fake_usb_report_t* sent = fake_usb_last_report();
+    CHECK_EQ(sent->report_id, REPORT_ID_KEYBOARD);
+    CHECK_EQ(sent->len, sizeof(report));
+    CHECK_MEM(sent->data, report, sizeof(report));
+}
+
+static void test_keyboard_stays_in_boot_protocol(void)
+{
+    fake_firmware_init();
+    fake_host_attach(KEYBOARD_DEV, 0, 0x04D9, 0x1702, HID_ITF_PROTOCOL_KEYBOARD,
+                     boot_keyboard_desc, sizeof(boot_keyboard_desc));
+    fake_firmware_run_for(FAKE_FIRMWARE_ATTACH_SETTLE_US, LOOP_US);
+
+    // Keyboard reports are forwarded as 8-byte boot reports
+    CHECK_EQ(fake_host_protocol(KEYBOARD_DEV, 0), HID_PROTOCOL_BOOT);
+    CHECK_EQ(fake_host_set_protocol_count(KEYBOARD_DEV, 0), 0);
+}
+
+static void test_mouse_with_plan_switched_to_report_protocol(void)
+{
+    setup_with_mouse();
+
+    CHECK_EQ(fake_host_protocol(MOUSE_DEV, 0), HID_PROTOCOL_REPORT);
+    CHECK_EQ(fake_host_set_protocol_count(MOUSE_DEV, 0), 1);
+}
+
+static void test_mouse_without_plan_stays_in_boot_protocol(void)
+{
+    fake_firmware_init();
+    fake_host_attach(MOUSE_DEV, 0, 0x056A, 0x0302, HID_ITF_PROTOCOL_MOUSE,
+                     absolute_pointer_desc, sizeof(absolute_pointer_desc));
+    fake_firmware_run_for(FAKE_FIRMWARE_ATTACH_SETTLE_US, LOOP_US);
+    fake_usb_clear_reports();
+    CHECK_EQ(fake_host_protocol(MOUSE_DEV, 0), HID_PROTOCOL_BOOT);
+
+    align_to_frame_start();
+    const uint8_t report[] = { 0x01, 4, (uint8_t)-2 };
+    fake_host_report(MOUSE_DEV, 0, report, sizeof(report));
+    fake_firmware_run_for(3000, LOOP_US);
+
+    CHECK_EQ(fake_usb_report_count(), 1);
+    const hid_mouse_report_t* sent = (const hid_mouse_report_t*)fake_usb_last_report()->data;
+    CHECK_EQ(sent->buttons, 0x01);
+    CHECK_EQ(sent->x, 4);
+    CHECK_EQ(sent->y, -2);
+}
+
+static void test_short_mouse_report_dropped(void)
+{
+    setup_with_mouse();
+
+    const uint8_t report[] = { 0x01, 5 };
+    fake_host_report(MOUSE_DEV, 0, report, sizeof(report));
+    fake_firmware_run_for(3000, LOOP_US);
+
+    CHECK_EQ(fake_usb_report_count(), 0);
+}
+
+static void test_device_descriptor_matches_mouse_format(void)
+{
+    fake_firmware_init();
+
+    // The virtual host read the report descriptor at the length the
+    // configuration descriptor declares; its mouse report is the 8-bit one
+    uint16_t len = 0;
+    const uint8_t* desc = fake_usb_host_report_descriptor(&len);
+    CHECK(len > 0);
+
+    hid_mouse_layout_t layout;
+    CHECK(hid_parser_compile_mouse(desc, len, &layout));
+    CHECK_EQ(layout.count, 1);
+    CHECK_EQ(layout.plans[0].report_id, REPORT_ID_MOUSE);
+    CHECK_EQ(layout.plans[0].x.bit_size, 8);
+    CHECK_EQ(layout.plans[0].button_count, KMBOX_MAX_BUTTONS > 8 ? 8 : KMBOX_MAX_BUTTONS);
+    CHECK_EQ(layout.plans[0].report_bits, 8 * sizeof(hid_mouse_report_t));
+    CHECK(!usb_hid_mouse_is_wide());
+}
+
+static void test_wide_mouse_switches_format_on_core0(void)
+{
+    fake_firmware_init();
+    const uint32_t connects = fake_usb_connect_count();
+
+    // The mount callback runs on core1 and only posts the request
+    fake_host_attach(MOUSE_DEV, 0, 0x046D, 0xC539, HID_ITF_PROTOCOL_MOUSE,
+                     wide_mouse_desc, sizeof(wide_mouse_desc));
+    CHECK(!usb_hid_mouse_is_wide());
+    CHECK_EQ(get_attached_vid(), 0);
+    CHECK_EQ(fake_usb_connect_count(), connects);
+
+    // core0 switches the format and re-enumerates once with the new VID/PID
+    fake_firmware_run_for(FAKE_FIRMWARE_ATTACH_SETTLE_US, LOOP_US);
+    CHECK(usb_hid_mouse_is_wide());
+    CHECK_EQ(get_attached_vid(), 0x046D);
+    CHECK_EQ(get_attached_pid(), 0xC539);
+    CHECK_EQ(fake_usb_connect_count(), connects + 1);
+    CHECK_EQ(fake_usb_core1_call_count(), 0);
+
+    uint16_t len = 0;
+    const uint8_t* desc = fake_usb_host_report_descriptor(&len);
+    hid_mouse_layout_t layout;
+    CHECK(hid_parser_compile_mouse(desc, len, &layout));
+    CHECK_EQ(layout.plans[0].x.bit_size, 16);
+}
+
+static void test_serial_runs_during_reenumeration(void)
+{
+    fake_firmware_init();
+    fake_host_attach(MOUSE_DEV, 0, 0x046D, 0xC539, HID_ITF_PROTOCOL_MOUSE,
+                     wide_mouse_desc, sizeof(wide_mouse_desc));
+    fake_firmware_run_for(10 * LOOP_US, LOOP_US);
+    CHECK(usb_hid_reenumeration_pending());
+    CHECK(!tud_mounted());
+
+    // The loop is not blocked while the device is off the bus: commands are
+    // parsed and answered within a few loop passes
+    const uint64_t start_us = time_us_64();
+    const uint32_t commands = kmbox_get_command_count();
+    fake_uart_tx_clear();
+    CHECK(fake_uart_rx_str("km.move(5,0)\r\n"));
+    fake_firmware_run_for(5000, LOOP_US);
+    CHECK_EQ(kmbox_get_command_count(), commands + 1);
+    CHECK(fake_uart_tx_len() > 0);
+    CHECK(time_us_64() - start_us < 10000);
+    CHECK(usb_hid_reenumeration_pending());
+
+    // Reconnected and enumerated once the disconnect time has passed
+    fake_firmware_run_for(USB_REENUM_DISCONNECT_MS * 1000u, LOOP_US);
+    CHECK(!usb_hid_reenumeration_pending());
+    CHECK(tud_mounted());
+    CHECK(usb_hid_mouse_is_wide());
+}
+
+static const test_case_t cases[] = {
+    TEST_CASE(test_mouse_report_forwarded),
+    TEST_CASE(test_extra_buttons_forwarded),
+    TEST_CASE(test_reports_in_one_frame_are_merged),
+    TEST_CASE(test_input_while_busy_goes_out_next_frame),
+    TEST_CASE(test_stale_sof_sends_immediately),
+    TEST_CASE(test_keyboard_report_forwarded_once),
+    TEST_CASE(test_keyboard_stays_in_boot_protocol),
+    TEST_CASE(test_mouse_with_plan_switched_to_report_protocol),
+    TEST_CASE(test_mouse_without_plan_stays_in_boot_protocol),
+    TEST_CASE(test_short_mouse_report_dropped),
+    TEST_CASE(test_device_descriptor_matches_mouse_format),
+    TEST_CASE(test_wide_mouse_switches_format_on_core0),
+    TEST_CASE(test_serial_runs_during_reenumeration),
+    TEST_END
+};
+
+const test_suite_t test_suite_passthrough = { "passthrough", cases };
@@ -0,0 +1,447 @@
+/*
+ * Binary protocol tests: encoder/decoder round trips and binary frames
+ * through the firmware parser, checked against the km.* text commands they
+ * stand for
+ */
+
+#include "test.h"
+#include "kmbox_commands.h"
+#include "kmbox_protocol.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NOW_US          1000000u
+
+//--------------------------------------------------------------------+
+// Helpers
+//--------------------------------------------------------------------+
+
+static uint8_t g_out[4096];
+static size_t g_out_len;
+
+static void capture_output(const char* data, size_t len)
+{
+    if (len > sizeof(g_out) - g_out_len) {
+        len = sizeof(g_out) - g_out_len;
+    }
+    memcpy(&g_out[g_out_len], data, len);
+    g_out_len += len;
+}
+
+static bool accept_baud(uint32_t baud)
+{
+    (void)baud;
+    return true;
+}
+
+static void reset_parser(void)
+{
+    kmbox_commands_init();
+    kmbox_commands_set_output(capture_output);
+    kmbox_commands_set_baud_handler(accept_baud, 115200);
+    kmbox_set_echo_mode(KMBOX_ECHO_SILENT);
+    g_out_len = 0;
+}
+
+// Decode exactly one frame from buf, which must hold nothing else
+static kmbox_bin_frame_t decode_one(const uint8_t* buf, size_t len)
+{
+    kmbox_bin_decoder_t dec;
+    kmbox_bin_decoder_reset(&dec);
+    for (size_t i = 0; i < len; i++) {
+        const kmbox_bin_result_t result = kmbox_bin_decoder_feed(&dec, buf[i]);
+        if (i + 1 < len) {
+            CHECK_EQ(result, KMBOX_BIN_NEED_MORE);
+        } else {
+            CHECK_EQ(result, KMBOX_BIN_FRAME_READY);
+        }
+    }
+    return dec.frame;
+}
+
+// Output state reachable through the public API
+typedef struct {
+    kmbox_buttons_t buttons;
+    int16_t x, y, wheel, pan;
+    kmbox_buttons_t mask;
+    bool lock_mx, lock_my;
+    uint8_t drain_mode;
+    uint16_t drain_param;
+} snapshot_t;
+
+static snapshot_t take_snapshot(uint64_t now_us)
+{
+    snapshot_t s;
+    memset(&s, 0, sizeof(s));
+    kmbox_update_states(now_us);
+    s.mask = kmbox_get_button_mask();
+    s.lock_mx = kmbox_get_lock_mx();
+    s.lock_my = kmbox_get_lock_my();
+    s.drain_mode = (uint8_t)kmbox_get_drain_mode(&s.drain_param);
+    kmbox_get_mouse_report(&s.buttons, &s.x, &s.y, &s.wheel, &s.pan);
+    return s;
+}
+
+//--------------------------------------------------------------------+
+// Encoder/decoder round trips
+//--------------------------------------------------------------------+
+
+static void test_move_round_trip(void)
+{
+    static const int16_t values[] = { 0, 1, -1, 127, -128, 128, -129, 32767, -32768 };
+    uint8_t seq = 0;
+
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        for (size_t j = 0; j < sizeof(values) / sizeof(values[0]); j++) {
+            uint8_t buf[KMBOX_BIN_MAX_FRAME];
+            const size_t len = kmbox_bin_encode_move(buf, sizeof(buf), ++seq, values[i], values[j]);
+            const kmbox_bin_frame_t frame = decode_one(buf, len);
+            CHECK_EQ(len, KMBOX_BIN_OVERHEAD + frame.len);
+            CHECK_EQ(frame.seq, seq);
+
+            // MOVE8 whenever both deltas fit in a byte
+            if (values[i] >= -128 && values[i] <= 127 && values[j] >= -128 && values[j] <= 127) {
+                CHECK_EQ(frame.op, KMBOX_BIN_OP_MOVE8);
+                CHECK_EQ(frame.len, 2);
+                CHECK_EQ((int8_t)frame.payload[0], values[i]);
+                CHECK_EQ((int8_t)frame.payload[1], values[j]);
+            } else {
+                CHECK_EQ(frame.op, KMBOX_BIN_OP_MOVE);
+                CHECK_EQ(frame.len, 4);
+                CHECK_EQ(kmbox_bin_get_i16(&frame.payload[0]), values[i]);
+                CHECK_EQ(kmbox_bin_get_i16(&frame.payload[2]), values[j]);
+            }
+        }
+    }
+}
+
+static void test_command_encoders_round_trip(void)
+{
+    uint8_t buf[KMBOX_BIN_MAX_FRAME];
+    kmbox_bin_frame_t f;
+
+    f = decode_one(buf, kmbox_bin_encode_wheel(buf, sizeof(buf), 1, -5));
+    CHECK_EQ(f.op, KMBOX_BIN_OP_WHEEL);
+    CHECK_EQ(f.len, 1);
+    CHECK_EQ((int8_t)f.payload[0], -5);
+
+    f = decode_one(buf, kmbox_bin_encode_button(buf, sizeof(buf), 2, KMBOX_BUTTON_SIDE2, true));
+    CHECK_EQ(f.op, KMBOX_BIN_OP_BUTTON);
+    CHECK_EQ(f.len, 2);
+    CHECK_EQ(f.payload[0], KMBOX_BUTTON_SIDE2);
+    CHECK_EQ(f.payload[1], 1);
+
+    f = decode_one(buf, kmbox_bin_encode_click(buf, sizeof(buf), 3, KMBOX_BUTTON_RIGHT, 0));
+    CHECK_EQ(f.op, KMBOX_BIN_OP_CLICK);
+    CHECK_EQ(f.len, 1);
+
+    f = decode_one(buf, kmbox_bin_encode_click(buf, sizeof(buf), 4, KMBOX_BUTTON_RIGHT, 123456));
+    CHECK_EQ(f.len, 5);
+    CHECK_EQ(kmbox_bin_get_u32(&f.payload[1]), 123456);
+
+    f = decode_one(buf, kmbox_bin_encode_lock_axis(buf, sizeof(buf), 5, KMBOX_BIN_AXIS_Y, 1));
+    CHECK_EQ(f.op, KMBOX_BIN_OP_LOCK_AXIS);
+    CHECK_EQ(f.len, 2);
+    CHECK_EQ(f.payload[0], KMBOX_BIN_AXIS_Y);
+    CHECK_EQ(f.payload[1], 1);
+
+    f = decode_one(buf, kmbox_bin_encode_lock_axis(buf, sizeof(buf), 6, KMBOX_BIN_AXIS_X, -1));
+    CHECK_EQ(f.len, 1);
+
+    f = decode_one(buf, kmbox_bin_encode_lock_button(buf, sizeof(buf), 7, KMBOX_BUTTON_MIDDLE, 0));
+    CHECK_EQ(f.op, KMBOX_BIN_OP_LOCK_BUTTON);
+    CHECK_EQ(f.len, 2);
+    CHECK_EQ(f.payload[0], KMBOX_BUTTON_MIDDLE);
+    CHECK_EQ(f.payload[1], 0);
+
+    f = decode_one(buf, kmbox_bin_encode_buttons_cb(buf, sizeof(buf), 8, -1));
+    CHECK_EQ(f.op, KMBOX_BIN_OP_BUTTONS_CB);
+    CHECK_EQ(f.len, 0);
+
+    f = decode_one(buf, kmbox_bin_encode_baud(buf, sizeof(buf), 9, 921600));
+    CHECK_EQ(f.op, KMBOX_BIN_OP_BAUD);
+    CHECK_EQ(f.len, 4);
+    CHECK_EQ(kmbox_bin_get_u32(f.payload), 921600);
+
+    f = decode_one(buf, kmbox_bin_encode_drain(buf, sizeof(buf), 10, KMBOX_DRAIN_PACED, 500));
+    CHECK_EQ(f.op, KMBOX_BIN_OP_DRAIN);
+    CHECK_EQ(f.len, 3);
+    CHECK_EQ(f.payload[0], KMBOX_DRAIN_PACED);
+    CHECK_EQ((uint16_t)kmbox_bin_get_i16(&f.payload[1]), 500);
+
+    f = decode_one(buf, kmbox_bin_encode_drain(buf, sizeof(buf), 11, -1, 0));
+    CHECK_EQ(f.len, 0);
+
+    f = decode_one(buf, kmbox_bin_encode_move_paced(buf, sizeof(buf), 12, -300, 200, 40000));
+    CHECK_EQ(f.op, KMBOX_BIN_OP_MOVE_PACED);
+    CHECK_EQ(f.len, 6);
+    CHECK_EQ(kmbox_bin_get_i16(&f.payload[0]), -300);
+    CHECK_EQ(kmbox_bin_get_i16(&f.payload[2]), 200);
+    CHECK_EQ((uint16_t)kmbox_bin_get_i16(&f.payload[4]), 40000);
+
+    f = decode_one(buf, kmbox_bin_encode_move_cancel(buf, sizeof(buf), 13));
+    CHECK_EQ(f.op, KMBOX_BIN_OP_MOVE_CANCEL);
+    CHECK_EQ(f.len, 0);
+
+    f = decode_one(buf, kmbox_bin_encode_response(buf, sizeof(buf), KMBOX_BIN_OP_DRAIN, 14,
+                                                  KMBOX_BIN_STATUS_OK, 2));
+    CHECK_EQ(f.op, KMBOX_BIN_OP_DRAIN);
+    CHECK_EQ(f.seq, 14);
+    CHECK_EQ(f.len, 2);
+    CHECK_EQ(f.payload[0], KMBOX_BIN_STATUS_OK);
+    CHECK_EQ(f.payload[1], 2);
+}
+
+static void test_encoder_rejects_small_buffer(void)
+{
+    uint8_t buf[KMBOX_BIN_MAX_FRAME];
+    CHECK_EQ(kmbox_bin_encode_move(buf, 5, 0, 1000, 1000), 0);
+    CHECK_EQ(kmbox_bin_encode(buf, sizeof(buf), KMBOX_BIN_OP_MOVE, 0, buf, KMBOX_BIN_MAX_PAYLOAD + 1), 0);
+}
+
+static void test_corrupted_frame_never_decodes(void)
+{
+    uint8_t buf[2 * KMBOX_BIN_MAX_FRAME];
+    const size_t first = kmbox_bin_encode_move(buf, sizeof(buf), 1, 10, 20);
+    const size_t second = kmbox_bin_encode_move(&buf[first], sizeof(buf) - first, 2, 30, 40);
+
+    // No single-bit error in the first frame's header, sequence or payload
+    // lets it decode as sent: it fails the CRC or changes the frame length
+    for (size_t byte = 1; byte < first; byte++) {
+        for (unsigned bit = 0; bit < 8; bit++) {
+            uint8_t stream[sizeof(buf)];
+            memcpy(stream, buf, first + second);
+            stream[byte] ^= (uint8_t)(1u << bit);
+
+            kmbox_bin_decoder_t dec;
+            kmbox_bin_decoder_reset(&dec);
+            for (size_t i = 0; i < first + second; i++) {
+                if (kmbox_bin_decoder_feed(&dec, stream[i]) == KMBOX_BIN_FRAME_READY) {
+                    CHECK(dec.frame.seq != 1 || dec.frame.payload[0] != 10 || dec.frame.payload[1] != 20);
+                }
+            }
+        }
+    }
+
+    // Bytes outside a frame are ignored
+    kmbox_bin_decoder_t dec;
+    kmbox_bin_decoder_reset(&dec);
+    const uint8_t noise[] = { 'x', 0x00, 0xFF, '\n' };
+    for (size_t i = 0; i < sizeof(noise); i++) {
+        CHECK_EQ(kmbox_bin_decoder_feed(&dec, noise[i]), KMBOX_BIN_NEED_MORE);
+    }
+    CHECK(!kmbox_bin_decoder_busy(&dec));
+}
+
+//--------------------------------------------------------------------+
+// Through the firmware parser
+//--------------------------------------------------------------------+
+
+typedef size_t (*encode_fn_t)(uint8_t* out, size_t out_size, uint8_t seq);
+
+static size_t enc_move8(uint8_t* o, size_t n, uint8_t s) { return kmbox_bin_encode_move(o, n, s, -123, 45); }
+static size_t enc_move16(uint8_t* o, size_t n, uint8_t s) { return kmbox_bin_encode_move(o, n, s, 1000, -2000); }
+static size_t enc_wheel(uint8_t* o, size_t n, uint8_t s) { return kmbox_bin_encode_wheel(o, n, s, -3); }
+static size_t enc_button(uint8_t* o, size_t n, uint8_t s) { return kmbox_bin_encode_button(o, n, s, KMBOX_BUTTON_RIGHT, true); }
+static size_t enc_click(uint8_t* o, size_t n, uint8_t s) { return kmbox_bin_encode_click(o, n, s, KMBOX_BUTTON_MIDDLE, 50000); }
+static size_t enc_lock_x(uint8_t* o, size_t n, uint8_t s) { return kmbox_bin_encode_lock_axis(o, n, s, KMBOX_BIN_AXIS_X, 1); }
+static size_t enc_lock_y(uint8_t* o, size_t n, uint8_t s) { return kmbox_bin_encode_lock_axis(o, n, s, KMBOX_BIN_AXIS_Y, 1); }
+static size_t enc_drain(uint8_t* o, size_t n, uint8_t s) { return kmbox_bin_encode_drain(o, n, s, KMBOX_DRAIN_CAPPED, 16); }
+
+// Each binary frame and the text command it encodes must leave the same
+// state behind
+static const struct {
+    const char* text;
+    encode_fn_t encode;
+} equivalents[] = {
+    { "km.move(-123,45)\r\n", enc_move8 },
+    { "km.move(1000,-2000)\r\n", enc_move16 },
+    { "km.wheel(-3)\r\n", enc_wheel },
+    { "km.right(1)\r\n", enc_button },
+    { "km.click(2,50)\r\n", enc_click },
+    { "km.lock_mx(1)\r\n", enc_lock_x },
+    { "km.lock_my(1)\r\n", enc_lock_y },
+    { "km.drain(1,16)\r\n", enc_drain },
+};
+
+#define EQUIVALENT_COUNT (sizeof(equivalents) / sizeof(equivalents[0]))
+
+static void check_same_snapshot(const snapshot_t* a, const snapshot_t* b, const char* text)
+{
+    if (memcmp(a, b, sizeof(*a)) != 0) {
+        test_fail(__FILE__, __LINE__, "binary frame and %s differ: x %d/%d y %d/%d wheel %d/%d buttons %u/%u",
+                  text, a->x, b->x, a->y, b->y, a->wheel, b->wheel, a->buttons, b->buttons);
+    }
+}
+
+static void test_binary_matches_text_commands(void)
+{
+    for (size_t i = 0; i < EQUIVALENT_COUNT; i++) {
+        // Movement ahead of the lock commands shows whether they applied
+        reset_parser();
+        kmbox_process_serial_data((const uint8_t*)equivalents[i].text, strlen(equivalents[i].text), NOW_US);
+        kmbox_add_mouse_movement(7, 9);
+        const snapshot_t text = take_snapshot(NOW_US + 10000);
+
+        reset_parser();
+        uint8_t buf[KMBOX_BIN_MAX_FRAME];
+        const size_t len = equivalents[i].encode(buf, sizeof(buf), (uint8_t)i);
+        kmbox_process_serial_data(buf, len, NOW_US);
+        kmbox_add_mouse_movement(7, 9);
+        const snapshot_t binary = take_snapshot(NOW_US + 10000);
+
+        check_same_snapshot(&binary, &text, equivalents[i].text);
+    }
+}
+
+static void test_every_request_answered_with_its_seq(void)
+{
+    for (size_t i = 0; i < EQUIVALENT_COUNT; i++) {
+        reset_parser();
+        uint8_t buf[KMBOX_BIN_MAX_FRAME];
+        const uint8_t seq = (uint8_t)(0x80 + i);
+        const size_t len = equivalents[i].encode(buf, sizeof(buf), seq);
+        const kmbox_bin_frame_t request = decode_one(buf, len);
+
+        kmbox_process_serial_data(buf, len, NOW_US);
+        const kmbox_bin_frame_t response = decode_one(g_out, g_out_len);
+        CHECK_EQ(response.op, request.op);
+        CHECK_EQ(response.seq, seq);
+        CHECK_EQ(response.len, 1);
+        CHECK_EQ(response.payload[0], KMBOX_BIN_STATUS_OK);
+    }
+}
+
+static void test_query_responses_carry_value(void)
+{
+    reset_parser();
+    uint8_t buf[2 * KMBOX_BIN_MAX_FRAME];
+    size_t len = kmbox_bin_encode_lock_axis(buf, sizeof(buf), 1, KMBOX_BIN_AXIS_Y, 1);
+    len += kmbox_bin_encode_lock_axis(&buf[len], sizeof(buf) - len, 2, KMBOX_BIN_AXIS_Y, -1);
+    kmbox_process_serial_data(buf, len, NOW_US);
+
+    // Two responses back to back; the second one answers the query
+    kmbox_bin_decoder_t dec;
+    kmbox_bin_decoder_reset(&dec);
+    unsigned frames = 0;
+    for (size_t i = 0; i < g_out_len; i++) {
+        if (kmbox_bin_decoder_feed(&dec, g_out[i]) == KMBOX_BIN_FRAME_READY) {
+            frames++;
+        }
+    }
+    CHECK_EQ(frames, 2);
+    CHECK_EQ(dec.frame.seq, 2);
+    CHECK_EQ(dec.frame.len, 2);
+    CHECK_EQ(dec.frame.payload[1], 1);
+}
+
+static void test_bad_args_and_unknown_op(void)
+{
+    reset_parser();
+    uint8_t buf[KMBOX_BIN_MAX_FRAME];
+    kmbox_process_serial_data(buf, kmbox_bin_encode_button(buf, sizeof(buf), 1, KMBOX_BUTTON_COUNT, true), NOW_US);
+    kmbox_bin_frame_t response = decode_one(g_out, g_out_len);
+    CHECK_EQ(response.payload[0], KMBOX_BIN_STATUS_BAD_ARGS);
+    CHECK_EQ(kmbox_get_button_mask(), 0);
+
+    g_out_len = 0;
+    kmbox_process_serial_data(buf, kmbox_bin_encode(buf, sizeof(buf), 0x1F, 2, NULL, 0), NOW_US);
+    response = decode_one(g_out, g_out_len);
+    CHECK_EQ(response.op, 0x1F);
+    CHECK_EQ(response.payload[0], KMBOX_BIN_STATUS_UNKNOWN_OP);
+}
+
+static uint32_t dump_trace(void)
+{
+    return 42;
+}
+
+static void test_trace_without_hook_answers_error(void)
+{
+    // No trace hook is installed: the command is refused, not ignored
+    static const char command[] = "km.trace()\r\n";
+    static const struct {
+        kmbox_echo_mode_t mode;
+        const char* expected;
+    } cases[] = {
+        { KMBOX_ECHO_SILENT, KMBOX_RESP_ERROR "\r\n" },
+        { KMBOX_ECHO_ACK, KMBOX_RESP_ERROR "\r\n" },
+        { KMBOX_ECHO_PROMPT, KMBOX_RESP_ERROR "\r\n>>> " },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        reset_parser();
+        kmbox_set_echo_mode(cases[i].mode);
+        kmbox_process_serial_data((const uint8_t*)command, strlen(command), NOW_US);
+        CHECK_EQ(g_out_len, strlen(cases[i].expected));
+        CHECK_MEM(g_out, cases[i].expected, g_out_len);
+    }
+
+    // With the hook the record count comes back
+    reset_parser();
+    kmbox_set_echo_mode(KMBOX_ECHO_ACK);
+    kmbox_commands_set_trace_handler(dump_trace);
+    kmbox_process_serial_data((const uint8_t*)command, strlen(command), NOW_US);
+    CHECK_EQ(g_out_len, 4);
+    CHECK_MEM(g_out, "42\r\n", 4);
+}
+
+static void test_corrupted_frame_not_executed(void)
+{
+    reset_parser();
+    uint8_t buf[KMBOX_BIN_MAX_FRAME];
+    const size_t len = kmbox_bin_encode_move(buf, sizeof(buf), 1, 10, 20);
+    buf[len - 1] ^= 0x55;
+    kmbox_process_serial_data(buf, len, NOW_US);
+
+    CHECK_EQ(g_out_len, 0);
+    CHECK(!kmbox_has_pending_report());
+    CHECK(kmbox_parser_is_idle());
+}
+
+static void test_frames_and_text_interleaved_in_any_chunking(void)
+{
+    // A text line, a frame, another line and a frame, delivered in every
+    // split into two chunks
+    uint8_t stream[128];
+    size_t len = 0;
+    const char* line1 = "km.move(1,2)\r\n";
+    const char* line2 = "km.wheel(1)\n";
+    memcpy(&stream[len], line1, strlen(line1));
+    len += strlen(line1);
+    len += kmbox_bin_encode_move(&stream[len], sizeof(stream) - len, 1, 300, -400);
+    memcpy(&stream[len], line2, strlen(line2));
+    len += strlen(line2);
+    len += kmbox_bin_encode_move(&stream[len], sizeof(stream) - len, 2, -4, 8);
+
+    for (size_t split = 0; split <= len; split++) {
+        reset_parser();
+        const uint32_t commands = kmbox_get_command_count();
+        kmbox_process_serial_data(stream, split, NOW_US);
+        kmbox_process_serial_data(&stream[split], len - split, NOW_US);
+
+        CHECK_EQ(kmbox_get_command_count() - commands, 4);
+        CHECK(kmbox_parser_is_idle());
+        kmbox_set_wide_reports(true);
+        const snapshot_t s = take_snapshot(NOW_US);
+        CHECK_EQ(s.x, 1 + 300 - 4);
+        CHECK_EQ(s.y, 2 - 400 + 8);
+        CHECK_EQ(s.wheel, 1);
+    }
+}
+
+static const test_case_t cases[] = {
+    TEST_CASE(test_move_round_trip),
+    TEST_CASE(test_command_encoders_round_trip),
+    TEST_CASE(test_encoder_rejects_small_buffer),
+    TEST_CASE(test_corrupted_frame_never_decodes),
+    TEST_CASE(test_binary_matches_text_commands),
+    TEST_CASE(test_every_request_answered_with_its_seq),
+    TEST_CASE(test_query_responses_carry_value),
+    TEST_CASE(test_bad_args_and_unknown_op),
+    TEST_CASE(test_trace_without_hook_answers_error),
+    TEST_CASE(test_corrupted_frame_not_executed),
+    TEST_CASE(test_frames_and_text_interleaved_in_any_chunking),
+    TEST_END
+};
+
+const test_suite_t test_suite_protocol = { "protocol", cases };
@@ -0,0 +1,140 @@
+/*
+ * Trace tests: ring overflow and km.trace() dumps
+ *
+ * Dumps go to stdout, which is redirected to a temporary file while the
+ * dump runs and parsed back the way tools/trace_decode.c would.
+ */
+
+#include "test.h"
+#include "fake_sdk.h"
+#include "trace.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_DUMPED      (2 * TRACE_RING_SIZE)
+
+typedef struct {
+    unsigned core;
+    unsigned long timestamp_us;
+    unsigned long arg1;
+} dumped_t;
+
+static dumped_t g_dumped[MAX_DUMPED];
+static size_t g_dumped_count;
+static unsigned long g_end_count;
+static unsigned long g_end_dropped;
+
+// Request a dump, run trace_task() until it ends and parse the output
+static uint32_t run_dump(void)
+{
+    fflush(stdout);
+    FILE* capture = tmpfile();
+    CHECK(capture != NULL);
+    const int saved = dup(STDOUT_FILENO);
+    dup2(fileno(capture), STDOUT_FILENO);
+
+    const uint32_t requested = trace_request_dump();
+    for (uint32_t i = 0; i < requested / TRACE_DRAIN_BATCH + 2; i++) {
+        trace_task();
+    }
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    g_dumped_count = 0;
+    g_end_count = g_end_dropped = (unsigned long)-1;
+    rewind(capture);
+    char line[128];
+    while (fgets(line, sizeof(line), capture)) {
+        dumped_t d;
+        unsigned event, arg0;
+        unsigned long arg2;
+        if (sscanf(line, TRACE_DUMP_PREFIX " end %lu dropped %lu", &g_end_count, &g_end_dropped) == 2) {
+            continue;
+        }
+        if (sscanf(line, TRACE_DUMP_PREFIX " %u %lx %x %x %lx %lx",
+                   &d.core, &d.timestamp_us, &event, &arg0, &d.arg1, &arg2) == 6) {
+            CHECK(g_dumped_count < MAX_DUMPED);
+            g_dumped[g_dumped_count++] = d;
+        }
+    }
+    fclose(capture);
+    return requested;
+}
+
+//--------------------------------------------------------------------+
+// Tests
+//--------------------------------------------------------------------+
+
+static void test_dump_returns_every_record(void)
+{
+    fake_sdk_reset();
+    for (int32_t i = 0; i < 10; i++) {
+        fake_time_advance_us(5);
+        trace_record(TRACE_EV_MOUSE_MOVE, 0, i, 0);
+    }
+
+    CHECK_EQ(run_dump(), 10);
+    CHECK_EQ(g_dumped_count, 10);
+    CHECK_EQ(g_end_count, 10);
+    CHECK_EQ(g_end_dropped, 0);
+    for (size_t i = 0; i < g_dumped_count; i++) {
+        CHECK_EQ(g_dumped[i].arg1, i);
+    }
+}
+
+static void test_full_ring_keeps_the_newest_records(void)
+{
+    fake_sdk_reset();
+    const int32_t total = 3 * TRACE_RING_SIZE + 7;
+    for (int32_t i = 0; i < total; i++) {
+        fake_time_advance_us(1);
+        trace_record(TRACE_EV_MOUSE_SENT, 0, i, 0);
+    }
+
+    // One slot is kept free, so a lapped ring holds TRACE_RING_SIZE - 1
+    const uint32_t kept = TRACE_RING_SIZE - 1;
+    CHECK_EQ(run_dump(), kept);
+    CHECK_EQ(g_dumped_count, kept);
+    CHECK_EQ(g_end_dropped, (unsigned long)total - kept);
+    for (size_t i = 0; i < g_dumped_count; i++) {
+        CHECK_EQ(g_dumped[i].arg1, total - kept + i);
+    }
+
+    // The ring keeps working after being lapped
+    trace_record(TRACE_EV_MOUSE_SENT, 0, total, 0);
+    CHECK_EQ(run_dump(), 1);
+    CHECK_EQ(g_dumped[0].arg1, total);
+}
+
+static void test_dump_merges_cores_in_time_order(void)
+{
+    fake_sdk_reset();
+    const int32_t total = 2 * TRACE_RING_SIZE;
+    for (int32_t i = 0; i < total; i++) {
+        fake_set_core_num((unsigned)i & 1u);
+        fake_time_advance_us(3);
+        trace_record(TRACE_EV_HOST_QUEUE_DROP, 0, i, 0);
+    }
+    fake_set_core_num(0);
+
+    // Each core lapped its own ring and kept its newest records
+    CHECK_EQ(run_dump(), 2 * (TRACE_RING_SIZE - 1));
+    CHECK_EQ(g_dumped_count, 2 * (TRACE_RING_SIZE - 1));
+    for (size_t i = 1; i < g_dumped_count; i++) {
+        CHECK(g_dumped[i].timestamp_us > g_dumped[i - 1].timestamp_us);
+        CHECK_EQ(g_dumped[i].arg1, g_dumped[i - 1].arg1 + 1);
+        CHECK_EQ(g_dumped[i].core, g_dumped[i].arg1 & 1u);
+    }
+    CHECK_EQ(g_dumped[g_dumped_count - 1].arg1, total - 1);
+}
+
+static const test_case_t cases[] = {
+    TEST_CASE(test_dump_returns_every_record),
+    TEST_CASE(test_full_ring_keeps_the_newest_records),
+    TEST_CASE(test_dump_merges_cores_in_time_order),
+    TEST_END
+};
+
+const test_suite_t test_suite_trace = { "trace", cases };
@@ -0,0 +1,564 @@
+/*
+ * PIOKMbox injection latency simulator
+ *
+ * Runs the core0 firmware logic (usb_hid.c, kmbox_serial_handler.c and the
+ * kmbox-commands library) on a virtual microsecond clock against the host
+ * fakes in tests/fakes: km.* commands are replayed over a UART at a chosen
+ * baud rate, a host mouse reports at a chosen polling rate, and every report
+ * the device endpoint hands to the USB host is recorded with its frame
+ * number. Prints per-command latency histograms and lost movement, and can
+ * fail on thresholds so performance changes can be gated on the numbers.
+ *
+ * Built with the host configuration (PIOKMBOX_HOST):
+ *
+ *   ./kmbox_sim [options] [script]
+ *
+ * Script lines are km.* commands, sent with a \r\n terminator:
+ *
+ *   @<ms> command   queue the command at <ms> after the start
+ *   +<ms> command   queue it <ms> after the previous line's time
+ *   command         queue it right behind the previous line
+ *
+ * Lines starting with '#' are comments. Without a script a built-in
+ * scenario of moves, wheel steps and button presses is replayed.
+ */
+
+#include "fake_firmware.h"
+#include "fake_sdk.h"
+#include "fake_tusb.h"
+#include "fake_uart.h"
+#include "kmbox_serial_handler.h"
+#include "kmbox_commands.h"
+#include "usb_hid.h"
+#include "defines.h"
+#include "pico/stdlib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SIM_MAX_EVENTS          16384
+#define SIM_MAX_LINE            KMBOX_CMD_BUFFER_SIZE
+#define SIM_DRAIN_US            100000  // Idle time after the script so queued movement drains
+#define SIM_MOUSE_DEV           1
+
+#define FRAME_BUCKETS           5       // 0, 1, 2, 3, 4+ frames
+#define US_BUCKETS              KMBOX_LATENCY_BUCKETS
+
+//--------------------------------------------------------------------+
+// Options and script
+//--------------------------------------------------------------------+
+
+typedef struct {
+    uint32_t baud;
+    uint32_t poll_hz;           // Host mouse polling rate, 0 for no mouse
+    int phys_dx;                // Movement per host mouse report
+    int phys_dy;
+    uint32_t duration_ms;       // Length of the built-in scenario
+    uint32_t loop_us;           // Main loop period
+    uint32_t poll_offset_us;    // IN token delay after each SOF
+    bool print_reports;
+    bool verbose;
+    long max_frames;            // Fail if any command takes more frames, <0 off
+    long max_lost;              // Fail if more movement than this is lost, <0 off
+    const char* script;
+} sim_options_t;
+
+typedef struct {
+    uint64_t at_us;             // Queued on the UART at (relative to the start)
+    char text[SIM_MAX_LINE];
+} sim_event_t;
+
+static sim_event_t g_events[SIM_MAX_EVENTS];
+static size_t g_event_count;
+
+static bool add_event(uint64_t at_us, const char* text)
+{
+    if (g_event_count >= SIM_MAX_EVENTS || strlen(text) >= SIM_MAX_LINE) {
+        return false;
+    }
+    g_events[g_event_count].at_us = at_us;
+    snprintf(g_events[g_event_count].text, SIM_MAX_LINE, "%s", text);
+    g_event_count++;
+    return true;
+}
+
+static bool load_script(const char* path)
+{
+    FILE* f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+
+    char line[256];
+    uint64_t at_us = 0;
+    unsigned line_no = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), f) != NULL) {
+        line_no++;
+        line[strcspn(line, "\r\n")] = '\0';
+        char* p = line;
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+        if (*p == '\0' || *p == '#') {
+            continue;
+        }
+
+        if (*p == '@' || *p == '+') {
+            char* end;
+            const double ms = strtod(p + 1, &end);
+            if (end == p + 1 || ms < 0) {
+                fprintf(stderr, "%s:%u: bad time\n", path, line_no);
+                ok = false;
+                break;
+            }
+            at_us = (*p == '@') ? (uint64_t)(ms * 1000.0) : at_us + (uint64_t)(ms * 1000.0);
+            p = end;
+            while (*p == ' ' || *p == '\t') {
+                p++;
+            }
+        }
+        if (!add_event(at_us, p)) {
+            fprintf(stderr, "%s:%u: command too long or too many commands\n", path, line_no);
+            ok = false;
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+// Moves at a period that is not a multiple of the frame, so they complete
+// at every phase of a frame, with wheel steps and button presses mixed in
+static void build_default_scenario(uint32_t duration_ms)
+{
+    const uint64_t end_us = (uint64_t)duration_ms * 1000u;
+    bool pressed = false;
+
+    for (uint64_t t = 0; t < end_us; t += 3300) {
+        // X is never 0: km.move(0,0) would send nothing
+        const int n = (int)(t / 3300);
+        const int x = (n % 10 < 5) ? n % 10 - 5 : n % 10 - 4;
+        char text[SIM_MAX_LINE];
+        snprintf(text, sizeof(text), "km.move(%d,%d)", x, n % 7 - 3);
+        add_event(t, text);
+
+        if (t % 26400 == 0) {
+            add_event(t + 1100, "km.wheel(1)");
+        }
+        if (t % 39600 == 0) {
+            pressed = !pressed;
+            add_event(t + 2200, pressed ? "km.left(1)" : "km.left(0)");
+        }
+    }
+    if (pressed) {
+        add_event(end_us, "km.left(0)");
+    }
+}
+
+//--------------------------------------------------------------------+
+// Latency and movement accounting
+//--------------------------------------------------------------------+
+
+// Commands whose effect shows up in the next mouse report; others (queries,
+// settings) are replayed but not timed
+static const char* const timed_commands[] = {
+    "move", "wheel", "left", "right", "middle", "side1", "side2", "click",
+};
+
+#define TIMED_COUNT (sizeof(timed_commands) / sizeof(timed_commands[0]))
+
+typedef struct {
+    uint32_t count;
+    uint64_t total_us;
+    uint32_t max_us;
+    uint32_t max_frames;
+    uint32_t frames[FRAME_BUCKETS];
+    uint32_t us[US_BUCKETS];
+} latency_hist_t;
+
+typedef struct {
+    uint8_t kind;               // Index into timed_commands
+    uint64_t done_us;           // Terminator received
+    uint32_t done_frame;        // Frame it was received in
+} pending_cmd_t;
+
+static latency_hist_t g_hist[TIMED_COUNT];
+static pending_cmd_t g_pending[SIM_MAX_EVENTS];
+static size_t g_pending_head;
+static size_t g_pending_count;
+
+static int64_t g_commanded_x, g_commanded_y, g_commanded_wheel;
+static int64_t g_physical_x, g_physical_y;
+static int64_t g_emitted_x, g_emitted_y, g_emitted_wheel;
+static uint32_t g_mouse_reports, g_other_reports;
+static bool g_print_reports;
+
+static int timed_kind(const char* text)
+{
+    if (strncmp(text, "km.", 3) != 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < TIMED_COUNT; i++) {
+        const size_t n = strlen(timed_commands[i]);
+        // Button commands only change state with an argument
+        if (strncmp(text + 3, timed_commands[i], n) == 0 && text[3 + n] == '(' && text[4 + n] != ')') {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static int clamp_int(long value, long min, long max)
+{
+    return (int)((value < min) ? min : (value > max) ? max : value);
+}
+
+static void account_command(const char* text)
+{
+    int x, y;
+    if (sscanf(text, "km.move(%d,%d", &x, &y) == 2) {
+        g_commanded_x += clamp_int(x, INT16_MIN, INT16_MAX);
+        g_commanded_y += clamp_int(y, INT16_MIN, INT16_MAX);
+    } else if (sscanf(text, "km.wheel(%d", &x) == 1) {
+        g_commanded_wheel += clamp_int(x, INT8_MIN, INT8_MAX);
+    }
+}
+
+static void record_latency(const pending_cmd_t* cmd, const fake_usb_report_t* report)
+{
+    latency_hist_t* h = &g_hist[cmd->kind];
+    const uint32_t latency_us = (uint32_t)(report->sent_us - cmd->done_us);
+    const uint32_t frames = report->frame - cmd->done_frame;
+
+    h->count++;
+    h->total_us += latency_us;
+    if (latency_us > h->max_us) {
+        h->max_us = latency_us;
+    }
+    if (frames > h->max_frames) {
+        h->max_frames = frames;
+    }
+    h->frames[(frames < FRAME_BUCKETS) ? frames : FRAME_BUCKETS - 1]++;
+
+    uint32_t bucket = 0;
+    while (bucket < US_BUCKETS - 1 && latency_us >= ((uint32_t)KMBOX_LATENCY_BUCKET_BASE_US << bucket)) {
+        bucket++;
+    }
+    h->us[bucket]++;
+}
+
+// Every report the virtual host collects from the device endpoint
+static void on_report(const fake_usb_report_t* report)
+{
+    if (g_print_reports) {
+        printf("frame %6lu  %10llu us  id %u:", (unsigned long)report->frame,
+               (unsigned long long)report->sent_us, report->report_id);
+        for (unsigned i = 0; i < report->len; i++) {
+            printf(" %02x", report->data[i]);
+        }
+        printf("\n");
+    }
+
+    if (report->report_id != REPORT_ID_MOUSE) {
+        g_other_reports++;
+        return;
+    }
+    g_mouse_reports++;
+
+    if (report->len >= sizeof(hid_mouse_report_wide_t)) {
+        hid_mouse_report_wide_t wide;
+        memcpy(&wide, report->data, sizeof(wide));
+        g_emitted_x += wide.x;
+        g_emitted_y += wide.y;
+        g_emitted_wheel += wide.wheel;
+    } else if (report->len >= 4) {
+        g_emitted_x += (int8_t)report->data[1];
+        g_emitted_y += (int8_t)report->data[2];
+        g_emitted_wheel += (int8_t)report->data[3];
+    }
+
+    // A command is carried by the first report armed after it arrived
+    while (g_pending_count > 0) {
+        const pending_cmd_t* cmd = &g_pending[g_pending_head];
+        if (report->submit_us < cmd->done_us) {
+            break;
+        }
+        record_latency(cmd, report);
+        g_pending_head = (g_pending_head + 1) % SIM_MAX_EVENTS;
+        g_pending_count--;
+    }
+}
+
+//--------------------------------------------------------------------+
+// Simulation
+//--------------------------------------------------------------------+
+
+static const uint8_t boot_mouse_desc[] = {
+    TUD_HID_REPORT_DESC_MOUSE()
+};
+
+static void simulate(const sim_options_t* opt)
+{
+    fake_firmware_init();
+    fake_usb_set_poll_offset_us(opt->poll_offset_us);
+    if (opt->poll_hz > 0) {
+        fake_host_attach(SIM_MOUSE_DEV, 0, 0x046D, 0xC077, HID_ITF_PROTOCOL_MOUSE,
+                         boot_mouse_desc, sizeof(boot_mouse_desc));
+    }
+    fake_firmware_run_for(FAKE_FIRMWARE_ATTACH_SETTLE_US, opt->loop_us);
+
+    // Switch the link to the simulated rate the way the firmware does it
+    if (opt->baud != fake_uart_baudrate()) {
+        char line[SIM_MAX_LINE];
+        snprintf(line, sizeof(line), "km.baud(%lu)\r\n", (unsigned long)opt->baud);
+        fake_uart_rx_str(line);
+        fake_firmware_run_for(20000, opt->loop_us);
+        fake_uart_rx_str("km.echo(3)\r\n");
+        fake_firmware_run_for(20000, opt->loop_us);
+    }
+    fake_uart_set_paced(true);
+    fake_usb_set_report_hook(on_report);
+
+    const uint64_t start_us = time_us_64();
+    const uint64_t script_end_us = start_us + (g_event_count > 0 ? g_events[g_event_count - 1].at_us : 0);
+    const uint64_t poll_us = (opt->poll_hz > 0) ? 1000000u / opt->poll_hz : 0;
+    uint64_t next_poll_us = start_us;
+    size_t next_event = 0;
+
+    for (;;) {
+        const uint64_t now = time_us_64();
+
+        while (next_event < g_event_count && start_us + g_events[next_event].at_us <= now) {
+            const sim_event_t* ev = &g_events[next_event++];
+            char line[SIM_MAX_LINE + 2];
+            snprintf(line, sizeof(line), "%s\r\n", ev->text);
+            if (!fake_uart_rx_str(line)) {
+                fprintf(stderr, "UART script full at %s\n", ev->text);
+                continue;
+            }
+            account_command(ev->text);
+
+            const int kind = timed_kind(ev->text);
+            if (kind >= 0 && g_pending_count < SIM_MAX_EVENTS) {
+                pending_cmd_t* cmd = &g_pending[(g_pending_head + g_pending_count) % SIM_MAX_EVENTS];
+                cmd->kind = (uint8_t)kind;
+                // Complete when its \r is in; the \n follows one character later
+                cmd->done_us = fake_uart_rx_done_us() - (10u * 1000000u + opt->baud - 1) / opt->baud;
+                // A frame starts at every USB_FRAME_US boundary
+                cmd->done_frame = fake_usb_frame_count() +
+                                  (uint32_t)(cmd->done_us / USB_FRAME_US - now / USB_FRAME_US);
+                g_pending_count++;
+            }
+        }
+
+        if (poll_us > 0 && now >= next_poll_us && now < script_end_us) {
+            const uint8_t report[] = { 0x00, (uint8_t)(int8_t)opt->phys_dx, (uint8_t)(int8_t)opt->phys_dy, 0, 0 };
+            fake_host_report(SIM_MOUSE_DEV, 0, report, sizeof(report));
+            g_physical_x += (int8_t)opt->phys_dx;
+            g_physical_y += (int8_t)opt->phys_dy;
+            next_poll_us += poll_us;
+        }
+
+        if (next_event >= g_event_count && fake_uart_rx_pending() == 0 &&
+            now >= script_end_us + SIM_DRAIN_US) {
+            break;
+        }
+        fake_firmware_run_for(opt->loop_us, opt->loop_us);
+    }
+}
+
+//--------------------------------------------------------------------+
+// Output
+//--------------------------------------------------------------------+
+
+static int print_results(const sim_options_t* opt)
+{
+    int status = 0;
+
+    printf("Simulated %zu commands at %lu baud, host mouse %lu Hz (%d,%d per report), "
+           "loop %lu us, IN token %lu us after SOF\n",
+           g_event_count, (unsigned long)opt->baud, (unsigned long)opt->poll_hz,
+           opt->phys_dx, opt->phys_dy, (unsigned long)opt->loop_us, (unsigned long)opt->poll_offset_us);
+    printf("Reports: %lu mouse (%s), %lu other, %lu frames\n",
+           (unsigned long)g_mouse_reports, usb_hid_mouse_is_wide() ? "16-bit" : "8-bit",
+           (unsigned long)g_other_reports, (unsigned long)fake_usb_frame_count());
+
+    printf("\nCommand latency, line terminator received to report collected by the host:\n");
+    printf("%-8s %7s %9s %9s  frames:", "command", "count", "avg us", "max us");
+    for (unsigned i = 0; i < FRAME_BUCKETS; i++) {
+        char label[8];
+        snprintf(label, sizeof(label), (i == FRAME_BUCKETS - 1) ? "%u+" : "%u", i);
+        printf(" %6s", label);
+    }
+    printf("  us:");
+    for (unsigned i = 0; i < US_BUCKETS; i++) {
+        char label[16];
+        if (i < US_BUCKETS - 1) {
+            snprintf(label, sizeof(label), "<%u", KMBOX_LATENCY_BUCKET_BASE_US << i);
+        } else {
+            snprintf(label, sizeof(label), "more");
+        }
+        printf(" %7s", label);
+    }
+    printf("\n");
+
+    for (size_t k = 0; k < TIMED_COUNT; k++) {
+        const latency_hist_t* h = &g_hist[k];
+        if (h->count == 0) {
+            continue;
+        }
+        printf("%-8s %7lu %9.1f %9lu         ", timed_commands[k], (unsigned long)h->count,
+               (double)h->total_us / h->count, (unsigned long)h->max_us);
+        for (unsigned i = 0; i < FRAME_BUCKETS; i++) {
+            printf(" %6lu", (unsigned long)h->frames[i]);
+        }
+        printf("     ");
+        for (unsigned i = 0; i < US_BUCKETS; i++) {
+            printf(" %7lu", (unsigned long)h->us[i]);
+        }
+        printf("\n");
+
+        if (opt->max_frames >= 0 && h->max_frames > (uint32_t)opt->max_frames) {
+            printf("FAIL: %s took %lu frames, limit %ld\n", timed_commands[k],
+                   (unsigned long)h->max_frames, opt->max_frames);
+            status = 1;
+        }
+    }
+    if (g_pending_count > 0) {
+        printf("%lu commands never reached a report\n", (unsigned long)g_pending_count);
+        if (opt->max_frames >= 0) {
+            status = 1;
+        }
+    }
+
+    const int64_t lost_x = g_commanded_x + g_physical_x - g_emitted_x;
+    const int64_t lost_y = g_commanded_y + g_physical_y - g_emitted_y;
+    const int64_t lost_wheel = g_commanded_wheel - g_emitted_wheel;
+    printf("\nMovement: commanded x %lld y %lld wheel %lld, physical x %lld y %lld, "
+           "emitted x %lld y %lld wheel %lld\n",
+           (long long)g_commanded_x, (long long)g_commanded_y, (long long)g_commanded_wheel,
+           (long long)g_physical_x, (long long)g_physical_y,
+           (long long)g_emitted_x, (long long)g_emitted_y, (long long)g_emitted_wheel);
+    printf("Lost: x %lld y %lld wheel %lld\n", (long long)lost_x, (long long)lost_y, (long long)lost_wheel);
+
+    const int64_t lost = llabs(lost_x) + llabs(lost_y) + llabs(lost_wheel);
+    if (opt->max_lost >= 0 && lost > opt->max_lost) {
+        printf("FAIL: %lld counts lost, limit %ld\n", (long long)lost, opt->max_lost);
+        status = 1;
+    }
+
+    printf("\nFirmware statistics:\n");
+    fflush(stdout);
+    kmbox_serial_print_stats();
+    return status;
+}
+
+static void usage(const char* argv0)
+{
+    fprintf(stderr,
+            "usage: %s [options] [script]\n"
+            "  --baud N            UART rate for the script (default %d)\n"
+            "  --poll-hz N         host mouse polling rate, 0 for no mouse (default 1000)\n"
+            "  --phys X,Y          host mouse movement per report (default 1,0)\n"
+            "  --duration-ms N     length of the built-in scenario (default 500)\n"
+            "  --loop-us N         main loop period (default 10)\n"
+            "  --poll-offset-us N  IN token delay after each SOF (default 0)\n"
+            "  --max-frames N      fail if a command takes more than N frames\n"
+            "  --max-lost N        fail if more than N counts of movement are lost\n"
+            "  --reports           print every report the host collects\n"
+            "  --verbose           keep the firmware's log output\n",
+            argv0, KMBOX_UART_BAUDRATE);
+}
+
+int main(int argc, char** argv)
+{
+    sim_options_t opt = {
+        .baud = KMBOX_UART_BAUDRATE,
+        .poll_hz = 1000,
+        .phys_dx = 1,
+        .phys_dy = 0,
+        .duration_ms = 500,
+        .loop_us = 10,
+        .poll_offset_us = 0,
+        .max_frames = -1,
+        .max_lost = -1,
+    };
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--reports") == 0) {
+            opt.print_reports = true;
+        } else if (strcmp(arg, "--verbose") == 0) {
+            opt.verbose = true;
+        } else if (arg[0] == '-' && arg[1] == '-' && value == NULL) {
+            usage(argv[0]);
+            return 2;
+        } else if (strcmp(arg, "--baud") == 0) {
+            opt.baud = (uint32_t)strtoul(value, NULL, 0);
+            i++;
+        } else if (strcmp(arg, "--poll-hz") == 0) {
+            opt.poll_hz = (uint32_t)strtoul(value, NULL, 0);
+            i++;
+        } else if (strcmp(arg, "--phys") == 0) {
+            if (sscanf(value, "%d,%d", &opt.phys_dx, &opt.phys_dy) != 2) {
+                usage(argv[0]);
+                return 2;
+            }
+            i++;
+        } else if (strcmp(arg, "--duration-ms") == 0) {
+            opt.duration_ms = (uint32_t)strtoul(value, NULL, 0);
+            i++;
+        } else if (strcmp(arg, "--loop-us") == 0) {
+            opt.loop_us = (uint32_t)strtoul(value, NULL, 0);
+            i++;
+        } else if (strcmp(arg, "--poll-offset-us") == 0) {
+            opt.poll_offset_us = (uint32_t)strtoul(value, NULL, 0);
+            i++;
+        } else if (strcmp(arg, "--max-frames") == 0) {
+            opt.max_frames = strtol(value, NULL, 0);
+            i++;
+        } else if (strcmp(arg, "--max-lost") == 0) {
+            opt.max_lost = strtol(value, NULL, 0);
+            i++;
+        } else if (arg[0] == '-') {
+            usage(argv[0]);
+            return 2;
+        } else {
+            opt.script = arg;
+        }
+    }
+
+    if (opt.baud < KMBOX_BAUD_MIN || opt.baud > KMBOX_BAUD_MAX || opt.loop_us == 0 ||
+        opt.poll_hz > 1000000) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (opt.script != NULL) {
+        if (!load_script(opt.script)) {
+            return 2;
+        }
+    } else {
+        build_default_scenario(opt.duration_ms);
+    }
+    g_print_reports = opt.print_reports;
+
+    // The firmware logs to stdout; keep only the simulator's output
+    fflush(stdout);
+    const int saved_stdout = dup(STDOUT_FILENO);
+    if (!opt.verbose && !opt.print_reports) {
+        if (freopen("/dev/null", "w", stdout) == NULL) {
+            return 2;
+        }
+    }
+
+    simulate(&opt);
+
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+    clearerr(stdout);
+    return print_results(&opt);
+}
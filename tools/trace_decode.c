@@ -0,0 +1,85 @@
+/*
+ * PIOKMbox trace decoder
+ *
+ * Turns the "TRC ..." lines written by km.trace() on the debug UART back into
+ * readable events. Other lines in the capture are ignored, so a raw serial
+ * log can be fed in directly:
+ *
+ *   cc -std=c11 -I. -o trace_decode tools/trace_decode.c
+ *   ./trace_decode debug_uart.log
+ */
+
+#include "trace.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char* const trace_names[TRACE_EV_COUNT] = {
+#define TRACE_EVENT_NAME(id, desc, fmt) desc,
+    TRACE_EVENT_LIST(TRACE_EVENT_NAME)
+#undef TRACE_EVENT_NAME
+};
+
+static const char* const trace_formats[TRACE_EV_COUNT] = {
+#define TRACE_EVENT_FORMAT(id, desc, fmt) fmt,
+    TRACE_EVENT_LIST(TRACE_EVENT_FORMAT)
+#undef TRACE_EVENT_FORMAT
+};
+
+static void decode_line(const char* line, uint32_t* first_us, bool* have_first)
+{
+    unsigned core, event, arg0;
+    unsigned long timestamp, arg1, arg2;
+
+    if (strncmp(line, TRACE_DUMP_PREFIX " ", sizeof(TRACE_DUMP_PREFIX)) != 0) {
+        return;
+    }
+    line += sizeof(TRACE_DUMP_PREFIX);
+
+    if (strncmp(line, "end", 3) == 0) {
+        printf("-- %s", line + 4);
+        return;
+    }
+
+    if (sscanf(line, "%u %lx %x %x %lx %lx", &core, &timestamp, &event, &arg0, &arg1, &arg2) != 6) {
+        fprintf(stderr, "malformed trace line: %s", line);
+        return;
+    }
+
+    if (!*have_first) {
+        *first_us = (uint32_t)timestamp;
+        *have_first = true;
+    }
+
+    printf("%10lu us  +%9lu us  core%u  ", (unsigned long)timestamp,
+           (unsigned long)(uint32_t)((uint32_t)timestamp - *first_us), core);
+    if (event >= TRACE_EV_COUNT) {
+        printf("unknown event 0x%02x: %u %lu %lu\n", event, arg0, arg1, arg2);
+        return;
+    }
+
+    printf("%-24s ", trace_names[event]);
+    printf(trace_formats[event], (long)(int16_t)arg0, (long)(int32_t)arg1, (long)(int32_t)arg2);
+    printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+    FILE* in = stdin;
+    char line[256];
+    uint32_t first_us = 0;
+    bool have_first = false;
+
+    if (argc > 1 && (in = fopen(argv[1], "r")) == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    while (fgets(line, sizeof(line), in) != NULL) {
+        decode_line(line, &first_us, &have_first);
+    }
+
+    if (in != stdin) {
+        fclose(in);
+    }
+    return 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * Event Trace for PIOKMbox
+ */
+
+#include "trace.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include <stdio.h>
+
+#define TRACE_RING_MASK (TRACE_RING_SIZE - 1)
+_Static_assert((TRACE_RING_SIZE & TRACE_RING_MASK) == 0, "TRACE_RING_SIZE must be a power of two");
+_Static_assert(sizeof(trace_record_t) == 16, "trace records are 16 bytes");
+
+// One ring per core. head is advanced only by the owning core, tail only by
+// the core0 drain, so no lock is needed between the cores. Interrupts are
+// masked around the slot write so IRQ handlers may trace too.
+//
+// The writer never waits for the reader: when the ring is full it overwrites
+// the oldest record, so the ring always holds the latest history. The reader
+// notices from head - tail that it was lapped, skips the overwritten records
+// and counts them in dropped.
+typedef struct {
+    trace_record_t records[TRACE_RING_SIZE];
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    uint32_t dropped;       // Written by the core0 drain only
+} trace_ring_t;
+
+static trace_ring_t g_trace_rings[NUM_CORES];
+
+#if TRACE_LIVE_OUTPUT
+static const char* const g_trace_names[TRACE_EV_COUNT] = {
+#define TRACE_EVENT_NAME(id, desc, fmt) desc,
+    TRACE_EVENT_LIST(TRACE_EVENT_NAME)
+#undef TRACE_EVENT_NAME
+};
+
+static const char* const g_trace_formats[TRACE_EV_COUNT] = {
+#define TRACE_EVENT_FORMAT(id, desc, fmt) fmt,
+    TRACE_EVENT_LIST(TRACE_EVENT_FORMAT)
+#undef TRACE_EVENT_FORMAT
+};
+#endif
+
+void trace_record(trace_event_t event, int32_t arg0, int32_t arg1, int32_t arg2)
+{
+    uint32_t core = get_core_num();
+    trace_ring_t* ring = &g_trace_rings[core];
+
+    uint32_t irq_state = save_and_disable_interrupts();
+    uint32_t head = ring->head;
+    trace_record_t* rec = &ring->records[head & TRACE_RING_MASK];
+    rec->timestamp_us = time_us_32();
+    rec->event = (uint8_t)event;
+    rec->core = (uint8_t)core;
+    rec->arg0 = (int16_t)arg0;
+    rec->arg1 = arg1;
+    rec->arg2 = arg2;
+    __dmb(); // Publish the record before the index
+    ring->head = head + 1;
+    restore_interrupts(irq_state);
+}
+
+// Skip records the writer has overwritten or may be overwriting. The slot
+// at tail is safe to read while head - tail < TRACE_RING_SIZE, since the
+// writer only starts on it once head reaches tail + TRACE_RING_SIZE.
+static uint32_t trace_resync(trace_ring_t* ring)
+{
+    uint32_t tail = ring->tail;
+    uint32_t pending = ring->head - tail;
+    if (pending >= TRACE_RING_SIZE) {
+        const uint32_t lost = pending - (TRACE_RING_SIZE - 1);
+        ring->dropped += lost;
+        tail += lost;
+        ring->tail = tail;
+    }
+    return tail;
+}
+
+// Pop the oldest record of either core (core0 only)
+static bool trace_pop(trace_record_t* out)
+{
+    for (;;) {
+        trace_ring_t* oldest = NULL;
+
+        for (uint32_t core = 0; core < NUM_CORES; core++) {
+            trace_ring_t* ring = &g_trace_rings[core];
+            uint32_t tail = trace_resync(ring);
+            if (tail == ring->head) {
+                continue;
+            }
+            __dmb(); // Read the record only after observing the index
+            if (oldest == NULL ||
+                (int32_t)(ring->records[tail & TRACE_RING_MASK].timestamp_us -
+                          oldest->records[oldest->tail & TRACE_RING_MASK].timestamp_us) < 0) {
+                oldest = ring;
+            }
+        }
+
+        if (oldest == NULL) {
+            return false;
+        }
+
+        const uint32_t tail = oldest->tail;
+        *out = oldest->records[tail & TRACE_RING_MASK];
+        __dmb(); // Copy the slot before checking it was not overwritten meanwhile
+        if (oldest->head - tail < TRACE_RING_SIZE) {
+            oldest->tail = tail + 1;
+            return true;
+        }
+        // Lapped during the copy: the next resync drops the record
+    }
+}
+
+// Records still to be written for the last km.trace() request
+static uint32_t g_dump_remaining = 0;
+static uint32_t g_dump_count = 0;
+
+static void trace_dump_record(const trace_record_t* rec)
+{
+    printf(TRACE_DUMP_PREFIX " %u %08lx %02x %04x %08lx %08lx\n",
+           rec->core, (unsigned long)rec->timestamp_us, rec->event, (uint16_t)rec->arg0,
+           (unsigned long)(uint32_t)rec->arg1, (unsigned long)(uint32_t)rec->arg2);
+}
+
+void trace_task(void)
+{
+    trace_record_t rec;
+
+    // A dump is paced at TRACE_DRAIN_BATCH lines per call so it fits the
+    // non-blocking debug output instead of overflowing it
+    if (g_dump_remaining > 0) {
+        for (uint32_t i = 0; i < TRACE_DRAIN_BATCH && g_dump_remaining > 0; i++) {
+            g_dump_remaining--;
+            if (!trace_pop(&rec)) {
+                g_dump_remaining = 0;
+                break;
+            }
+            trace_dump_record(&rec);
+            g_dump_count++;
+        }
+        if (g_dump_remaining == 0) {
+            printf(TRACE_DUMP_PREFIX " end %lu dropped %lu\n", (unsigned long)g_dump_count,
+                   (unsigned long)trace_get_dropped());
+        }
+        return;
+    }
+
+#if TRACE_LIVE_OUTPUT
+    for (uint32_t i = 0; i < TRACE_DRAIN_BATCH && trace_pop(&rec); i++) {
+        if (rec.event >= TRACE_EV_COUNT) {
+            continue;
+        }
+        printf("[%lu us] core%u %s: ", (unsigned long)rec.timestamp_us, rec.core,
+               g_trace_names[rec.event]);
+        printf(g_trace_formats[rec.event], (long)rec.arg0, (long)rec.arg1, (long)rec.arg2);
+        printf("\n");
+    }
+#endif
+}
+
+uint32_t trace_request_dump(void)
+{
+    uint32_t pending = 0;
+    for (uint32_t core = 0; core < NUM_CORES; core++) {
+        trace_ring_t* ring = &g_trace_rings[core];
+        pending += ring->head - trace_resync(ring);
+    }
+
+    // Records arriving after the request are left for the next dump
+    g_dump_remaining = pending;
+    g_dump_count = 0;
+    if (pending == 0) {
+        printf(TRACE_DUMP_PREFIX " end 0 dropped %lu\n", (unsigned long)trace_get_dropped());
+    }
+    return pending;
+}
+
+uint32_t trace_get_dropped(void)
+{
+    uint32_t dropped = 0;
+    for (uint32_t core = 0; core < NUM_CORES; core++) {
+        dropped += g_trace_rings[core].dropped;
+    }
+    return dropped;
+}
@@ -0,0 +1,111 @@
+/*
+ * Event Trace for PIOKMbox
+ *
+ * Hot paths record fixed-size binary events into a per-core RAM ring instead
+ * of calling printf. Each core writes only its own ring, so recording is a
+ * timestamp read, a 16-byte store and an index update. Records are drained on
+ * core0: formatted as text by trace_task() when live output is enabled, or
+ * dumped in a compact hex form by km.trace() for tools/trace_decode.c.
+ *
+ * This header is shared with the host-side decoder and must stay free of
+ * Pico SDK dependencies.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//--------------------------------------------------------------------+
+// TRACE CONFIGURATION
+//--------------------------------------------------------------------+
+
+#define TRACE_LEVEL_OFF                 0
+#define TRACE_LEVEL_ERROR               1
+#define TRACE_LEVEL_WARN                2
+#define TRACE_LEVEL_INFO                3
+#define TRACE_LEVEL_DEBUG               4       // Per-report events
+
+// Events above this level compile to nothing
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL                     TRACE_LEVEL_DEBUG
+#endif
+
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE                 256     // Records per core (power of two)
+#endif
+
+// Format records on the debug UART from trace_task() as they arrive. Off by
+// default: records stay in RAM until km.trace() dumps them.
+#ifndef TRACE_LIVE_OUTPUT
+#define TRACE_LIVE_OUTPUT               0
+#endif
+
+#define TRACE_DRAIN_BATCH               8       // Records formatted per trace_task() call
+
+//--------------------------------------------------------------------+
+// TRACE EVENTS
+//--------------------------------------------------------------------+
+
+// X(id, description, argument format). The format receives arg0..arg2 as
+// three long values; unused trailing arguments are ignored.
+#define TRACE_EVENT_LIST(X) \
+    X(MOUSE_MOVE,        "mouse movement",         "x=%ld y=%ld wheel=%ld") \
+    X(MOUSE_SENT,        "mouse report sent",      "buttons=0x%02lx x=%ld y=%ld") \
+    X(MOUSE_SEND_FAIL,   "mouse report failed",    "buttons=0x%02lx x=%ld y=%ld") \
+    X(MOUSE_NOT_READY,   "mouse report dropped",   "mounted=%ld ready=%ld hid_ready=%ld") \
+    X(KBD_SEND_FAIL,     "keyboard report failed", "modifier=0x%02lx key0=0x%02lx") \
+    X(HOST_QUEUE_DROP,   "host report dropped",    "type=%ld dropped=%ld")
+
+typedef enum {
+#define TRACE_EVENT_ENUM(id, desc, fmt) TRACE_EV_##id,
+    TRACE_EVENT_LIST(TRACE_EVENT_ENUM)
+#undef TRACE_EVENT_ENUM
+    TRACE_EV_COUNT
+} trace_event_t;
+
+// 16-byte record as stored in the ring
+typedef struct {
+    uint32_t timestamp_us;
+    uint8_t event;          // trace_event_t
+    uint8_t core;
+    int16_t arg0;
+    int32_t arg1;
+    int32_t arg2;
+} trace_record_t;
+
+// Dump line format written by trace_task() and parsed by the decoder:
+// "TRC <core> <timestamp_us hex> <event hex> <arg0 hex> <arg1 hex> <arg2 hex>"
+#define TRACE_DUMP_PREFIX               "TRC"
+
+//--------------------------------------------------------------------+
+// TRACE API
+//--------------------------------------------------------------------+
+
+// Record an event from the calling core. Never blocks; if the ring is full
+// the oldest record is overwritten and counted as dropped when the drain
+// gets to it.
+void trace_record(trace_event_t event, int32_t arg0, int32_t arg1, int32_t arg2);
+
+// Record an event if its level is enabled at compile time, e.g.
+// TRACE(TRACE_LEVEL_DEBUG, MOUSE_SENT, buttons, x, y)
+#define TRACE(level, id, a0, a1, a2) \
+    do { \
+        if ((level) <= TRACE_LEVEL) { \
+            trace_record(TRACE_EV_##id, (int32_t)(a0), (int32_t)(a1), (int32_t)(a2)); \
+        } \
+    } while (0)
+
+// Low-priority drain, call from the core0 main loop. Writes requested dumps
+// a batch at a time, otherwise formats records if TRACE_LIVE_OUTPUT is set.
+void trace_task(void);
+
+// Start dumping the records pending now to stdio; returns how many will be
+// written. A "TRC end" line follows the last one.
+uint32_t trace_request_dump(void);
+
+// Records overwritten before they were drained
+uint32_t trace_get_dropped(void);
+
+#endif // TRACE_H
@@ -8,9 +8,12 @@
 #include "lib/kmbox-commands/kmbox_commands.h"
 #include "pico/stdlib.h"
 #include "pico/unique_id.h"
+#include "hardware/sync.h"
 #include "kmbox_serial_handler.h" // Include the header for serial handling
 #include "state_management.h"   // Include the header for state management
 #include "watchdog.h"           // Include the header for watchdog management
+#include "trace.h"              // Binary event trace for the report hot path
+#include "hid_report_parser.h"  // Compiled host mouse report layouts
 #include <string.h>             // For strcpy, strlen, memset
 
 uint16_t attached_vid = 0;
@@ -60,22 +63,42 @@ void set_attached_device_vid_pid(uint16_t vid, uint16_t pid) {
     }
 }
 
-void force_usb_reenumeration() {
-    printf("Forcing USB re-enumeration with new descriptor...\\n");
-    
-    // Disconnect from USB host
+// Re-enumeration (core0). The device disconnects, stays off the bus for
+// USB_REENUM_DISCONNECT_MS so the host notices, then reconnects; the main
+// loop keeps running tud_task() and the serial task throughout.
+static bool reenum_pending = false;
+static uint64_t reenum_reconnect_us = 0;   // 0 until the next loop pass arms it
+
+void force_usb_reenumeration(void) {
+    printf("Forcing USB re-enumeration with new descriptor...\n");
+
+    // Disconnect from USB host; a request while already disconnected
+    // restarts the wait
     tud_disconnect();
-    
-    // Wait for host to recognize disconnection (250ms minimum for Windows/macOS)
-    sleep_ms(500);
-    
-    // Reconnect with new descriptor
+    reenum_pending = true;
+    reenum_reconnect_us = 0;
+}
+
+bool usb_hid_reenumeration_pending(void) {
+    return reenum_pending;
+}
+
+static void reenumeration_task(uint64_t now_us) {
+    if (!reenum_pending) {
+        return;
+    }
+    if (reenum_reconnect_us == 0) {
+        reenum_reconnect_us = now_us + (uint64_t)USB_REENUM_DISCONNECT_MS * 1000u;
+        return;
+    }
+    if (now_us < reenum_reconnect_us) {
+        return;
+    }
+
+    // Reconnect with new descriptor; tud_task() runs the enumeration
+    reenum_pending = false;
     tud_connect();
-    
-    // Wait for reconnection
-    sleep_ms(250);
-    
-    printf("USB re-enumeration complete\\n");
+    printf("USB re-enumeration: reconnected\n");
 }
 
 // Function to fetch string descriptors from attached device
@@ -188,6 +211,104 @@ static usb_error_tracker_t usb_error_tracker = {0};
 static bool usb_device_initialized = false;
 static bool usb_host_initialized = false;
 
+// Cross-core host report queue. tuh_hid_report_received_cb() runs inside
+// tuh_task() on core1 and only parses and queues; core0 owns the kmbox state
+// and the TinyUSB device stack and does all merging in hid_host_task().
+// Single producer (core1), single consumer (core0): each index is written by
+// one core only, and a memory barrier orders the slot data against the index.
+typedef enum
+{
+    HOST_REPORT_MOUSE = 0,
+    HOST_REPORT_KEYBOARD
+} host_report_type_t;
+
+typedef struct
+{
+    uint8_t type;
+    uint64_t timestamp_us;      // time_us_64() when core1 received it
+    union
+    {
+        hid_mouse_report_wide_t mouse;
+        hid_keyboard_report_t keyboard;
+    };
+} host_report_entry_t;
+
+#define HOST_REPORT_QUEUE_MASK (HOST_REPORT_QUEUE_SIZE - 1)
+_Static_assert((HOST_REPORT_QUEUE_SIZE & HOST_REPORT_QUEUE_MASK) == 0,
+               "HOST_REPORT_QUEUE_SIZE must be a power of two");
+
+typedef struct
+{
+    host_report_entry_t slots[HOST_REPORT_QUEUE_SIZE];
+    volatile uint32_t head;     // Written by core1 only
+    volatile uint32_t tail;     // Written by core0 only
+    volatile uint32_t dropped;  // Written by core1 only
+    uint32_t high_water;        // core0 statistics
+    uint32_t max_latency_us;
+    uint32_t total_latency_us;
+} host_report_queue_t;
+
+static host_report_queue_t host_report_queue = {0};
+
+// Mouse report coalescing (core0). Host reports only feed the kmbox
+// accumulators; one merged report is sent whenever the IN endpoint is free,
+// either straight away or from tud_hid_report_complete_cb(). Button edges
+// are tracked against the last sent report so none is merged away.
+typedef struct
+{
+    kmbox_buttons_t applied; // Physical buttons handed to kmbox
+    kmbox_buttons_t sent;    // Physical buttons as of the last sent report
+    kmbox_buttons_t next;    // Held-back physical buttons (valid if deferred)
+    bool deferred;          // next would undo an edge not sent yet
+    bool pending;           // Host input merged since the last sent report
+    uint32_t reports_sent;
+    uint32_t merged;
+    uint32_t dropped;
+} mouse_coalescer_t;
+
+static mouse_coalescer_t mouse_coalescer = {0};
+
+// Start-of-frame timing (core0). tud_sof_cb() runs from tud_task() at the
+// top of the main loop, so the timestamp trails the SOF by at most the time
+// since the last tud_task() pass. It is only trusted for one frame: after
+// that a later SOF is already waiting in the TinyUSB event queue.
+typedef struct
+{
+    uint64_t sof_time_us;       // When the last SOF was seen, 0 if none
+    uint64_t pending_since_us;  // First input not yet submitted, 0 if none
+    uint16_t send_ahead_us;
+    hid_sof_stats_t stats;
+} sof_sync_t;
+
+static sof_sync_t sof_sync = {
+    .send_ahead_us = HID_SOF_SEND_AHEAD_US
+};
+
+// Device report arbiter (core0). The single HID IN endpoint is shared by all
+// report IDs; each keeps its latest content and a dirty flag, and whenever
+// the endpoint is free the highest-priority dirty report goes out (mouse >
+// keyboard > consumer). Nothing is sent while nothing changed. The mouse is
+// dirty while kmbox has a report pending and is sent by the coalescer.
+typedef struct
+{
+    uint8_t report_id;
+    uint8_t len;
+    bool dirty;
+    uint64_t dirty_since_us;
+    uint8_t data[sizeof(hid_keyboard_report_t)];
+    uint8_t sent_data[sizeof(hid_keyboard_report_t)];
+} arbiter_slot_t;
+
+// Lower-priority slots, in priority order
+static arbiter_slot_t arbiter_slots[] = {
+    { .report_id = REPORT_ID_KEYBOARD, .len = sizeof(hid_keyboard_report_t) },
+    { .report_id = REPORT_ID_CONSUMER_CONTROL, .len = HID_CONSUMER_CONTROL_SIZE }
+};
+
+#define ARBITER_SLOT_COUNT (sizeof(arbiter_slots) / sizeof(arbiter_slots[0]))
+
+static hid_arbiter_stats_t arbiter_stats = {0};
+
 // Initialization helpers
 static bool generate_serial_string(void);
 static bool init_gpio_pins(void);
@@ -197,83 +318,255 @@ static void handle_device_disconnection(uint8_t dev_addr);
 static void handle_hid_device_connection(uint8_t dev_addr, uint8_t itf_protocol);
 
 // Report processing helpers
-static bool process_keyboard_report_internal(const hid_keyboard_report_t *report);
-static bool process_mouse_report_internal(const hid_mouse_report_t *report);
+static bool process_keyboard_report_internal(const hid_keyboard_report_t *report, uint64_t now_us);
+static bool process_mouse_report_internal(const hid_mouse_report_wide_t *report, uint64_t now_us);
+
+// Device report arbitration
+static void report_arbiter_run(uint64_t now_us);
 
 // Debug and logging helpers
 static void print_device_info(uint8_t dev_addr, const tusb_desc_device_t *desc);
 
-// --- Runtime HID descriptor mirroring storage & helpers ---
+// --- Runtime HID report descriptor ---
 #define HID_DESC_BUF_SIZE 256
 
 static const uint8_t desc_hid_keyboard[] = {
     TUD_HID_REPORT_DESC_KEYBOARD(HID_REPORT_ID(REPORT_ID_KEYBOARD))};
 
+// Buttons declared by the device mouse report: the first eight in the 8-bit
+// (boot layout) report, all KMBOX_MAX_BUTTONS in the 16-bit field of the
+// wide report
+#if KMBOX_MAX_BUTTONS > 8
+#define DEVICE_MOUSE_BUTTONS_8BIT 8
+#else
+#define DEVICE_MOUSE_BUTTONS_8BIT KMBOX_MAX_BUTTONS
+#endif
+#define DEVICE_MOUSE_BUTTONS_WIDE KMBOX_MAX_BUTTONS
+
+// Boot layout: button byte, X, Y, wheel and pan as int8
 static const uint8_t desc_hid_mouse_default[] = {
-    TUD_HID_REPORT_DESC_MOUSE(HID_REPORT_ID(REPORT_ID_MOUSE))};
+    HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+    HID_USAGE(HID_USAGE_DESKTOP_MOUSE),
+    HID_COLLECTION(HID_COLLECTION_APPLICATION),
+      HID_REPORT_ID(REPORT_ID_MOUSE)
+      HID_USAGE(HID_USAGE_DESKTOP_POINTER),
+      HID_COLLECTION(HID_COLLECTION_PHYSICAL),
+        HID_USAGE_PAGE(HID_USAGE_PAGE_BUTTON),
+          HID_USAGE_MIN(1),
+          HID_USAGE_MAX(DEVICE_MOUSE_BUTTONS_8BIT),
+          HID_LOGICAL_MIN(0),
+          HID_LOGICAL_MAX(1),
+          HID_REPORT_COUNT(DEVICE_MOUSE_BUTTONS_8BIT),
+          HID_REPORT_SIZE(1),
+          HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+#if DEVICE_MOUSE_BUTTONS_8BIT < 8
+          HID_REPORT_COUNT(1),
+          HID_REPORT_SIZE(8 - DEVICE_MOUSE_BUTTONS_8BIT),
+          HID_INPUT(HID_CONSTANT),
+#endif
+        HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+          HID_USAGE(HID_USAGE_DESKTOP_X),
+          HID_USAGE(HID_USAGE_DESKTOP_Y),
+          HID_USAGE(HID_USAGE_DESKTOP_WHEEL),
+          HID_LOGICAL_MIN(0x81),
+          HID_LOGICAL_MAX(0x7f),
+          HID_REPORT_COUNT(3),
+          HID_REPORT_SIZE(8),
+          HID_INPUT(HID_DATA | HID_VARIABLE | HID_RELATIVE),
+        HID_USAGE_PAGE(HID_USAGE_PAGE_CONSUMER),
+          HID_USAGE_N(HID_USAGE_CONSUMER_AC_PAN, 2),
+          HID_LOGICAL_MIN(0x81),
+          HID_LOGICAL_MAX(0x7f),
+          HID_REPORT_COUNT(1),
+          HID_REPORT_SIZE(8),
+          HID_INPUT(HID_DATA | HID_VARIABLE | HID_RELATIVE),
+      HID_COLLECTION_END,
+    HID_COLLECTION_END};
+
+// 16-bit buttons, X/Y, wheel and pan in the layout of
+// hid_mouse_report_wide_t
+static const uint8_t desc_hid_mouse_wide[] = {
+    HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+    HID_USAGE(HID_USAGE_DESKTOP_MOUSE),
+    HID_COLLECTION(HID_COLLECTION_APPLICATION),
+      HID_REPORT_ID(REPORT_ID_MOUSE)
+      HID_USAGE(HID_USAGE_DESKTOP_POINTER),
+      HID_COLLECTION(HID_COLLECTION_PHYSICAL),
+        HID_USAGE_PAGE(HID_USAGE_PAGE_BUTTON),
+          HID_USAGE_MIN(1),
+          HID_USAGE_MAX(DEVICE_MOUSE_BUTTONS_WIDE),
+          HID_LOGICAL_MIN(0),
+          HID_LOGICAL_MAX(1),
+          HID_REPORT_COUNT(DEVICE_MOUSE_BUTTONS_WIDE),
+          HID_REPORT_SIZE(1),
+          HID_INPUT(HID_DATA | HID_VARIABLE | HID_ABSOLUTE),
+#if DEVICE_MOUSE_BUTTONS_WIDE < 16
+          HID_REPORT_COUNT(1),
+          HID_REPORT_SIZE(16 - DEVICE_MOUSE_BUTTONS_WIDE),
+          HID_INPUT(HID_CONSTANT),
+#endif
+        HID_USAGE_PAGE(HID_USAGE_PAGE_DESKTOP),
+          HID_USAGE(HID_USAGE_DESKTOP_X),
+          HID_USAGE(HID_USAGE_DESKTOP_Y),
+          HID_USAGE(HID_USAGE_DESKTOP_WHEEL),
+          HID_LOGICAL_MIN_N(0x8001, 2),
+          HID_LOGICAL_MAX_N(0x7FFF, 2),
+          HID_REPORT_COUNT(3),
+          HID_REPORT_SIZE(16),
+          HID_INPUT(HID_DATA | HID_VARIABLE | HID_RELATIVE),
+        HID_USAGE_PAGE(HID_USAGE_PAGE_CONSUMER),
+          HID_USAGE_N(HID_USAGE_CONSUMER_AC_PAN, 2),
+          HID_LOGICAL_MIN_N(0x8001, 2),
+          HID_LOGICAL_MAX_N(0x7FFF, 2),
+          HID_REPORT_COUNT(1),
+          HID_REPORT_SIZE(16),
+          HID_INPUT(HID_DATA | HID_VARIABLE | HID_RELATIVE),
+      HID_COLLECTION_END,
+    HID_COLLECTION_END};
 
 static const uint8_t desc_hid_consumer[] = {
     TUD_HID_REPORT_DESC_CONSUMER(HID_REPORT_ID(REPORT_ID_CONSUMER_CONTROL))};
 
-// Static fallback concatenated descriptor (used by config descriptor sizeof)
-const uint8_t desc_hid_report[] = {
-    TUD_HID_REPORT_DESC_KEYBOARD(HID_REPORT_ID(REPORT_ID_KEYBOARD)),
-    TUD_HID_REPORT_DESC_MOUSE(HID_REPORT_ID(REPORT_ID_MOUSE)),
-    TUD_HID_REPORT_DESC_CONSUMER(HID_REPORT_ID(REPORT_ID_CONSUMER_CONTROL))};
+_Static_assert(sizeof(desc_hid_keyboard) + sizeof(desc_hid_mouse_wide) + sizeof(desc_hid_consumer) <= HID_DESC_BUF_SIZE,
+               "HID_DESC_BUF_SIZE too small for the runtime HID report descriptor");
 
 static uint8_t desc_hid_report_runtime[HID_DESC_BUF_SIZE];
-static size_t desc_hid_runtime_len = 0;
-static bool desc_hid_runtime_valid = false;
+static uint16_t desc_hid_runtime_len = 0;
 
-static uint8_t host_mouse_desc[HID_DESC_BUF_SIZE];
-static size_t host_mouse_desc_len = 0;
-static bool host_mouse_has_report_id = false;
-static uint8_t host_mouse_report_id = 0;
+// Device mouse report format. Written and read on core0 only.
+static bool device_mouse_wide = false;
 
-static void build_runtime_hid_report_with_mouse(const uint8_t *mouse_desc, size_t mouse_len)
+// Device identity and mouse format wanted for the attached device. Posted by
+// core1 when a device mounts and applied by core0 in hid_host_task(), which
+// owns the runtime descriptors and the device stack. The request always
+// carries the whole wanted state, so a later mount (e.g. the keyboard
+// interface of a composite device) cannot undo an earlier one that core0
+// has not seen yet. seq is odd while core1 writes the fields.
+typedef struct
 {
-    // Concatenate keyboard + mouse_desc (or default) + consumer into runtime buffer
-    size_t pos = 0;
+    volatile uint32_t seq;      // Written by core1 only
+    volatile uint16_t vid;
+    volatile uint16_t pid;
+    volatile bool wide_mouse;
+} device_change_request_t;
 
-    // Copy keyboard
-    size_t klen = sizeof(desc_hid_keyboard);
-    if (pos + klen >= HID_DESC_BUF_SIZE)
-        return;
-    memcpy(&desc_hid_report_runtime[pos], desc_hid_keyboard, klen);
-    pos += klen;
+static device_change_request_t device_change_request = {
+    .wide_mouse = (USB_MOUSE_WIDE_REPORTS == USB_MOUSE_WIDE_ALWAYS)};
+static uint32_t device_change_applied = 0; // Last seq applied by core0
+
+// Report layouts compiled from the host report descriptors at mount, per
+// HID instance. Written and read on core1 only.
+static hid_mouse_layout_t host_mouse_layouts[CFG_TUH_HID];
+
+static int16_t clamp_axis(int32_t value, int32_t min, int32_t max)
+{
+    if (value > max)
+        return (int16_t)max;
+    if (value < min)
+        return (int16_t)min;
+    return (int16_t)value;
+}
+
+static void append_desc(size_t *pos, const uint8_t *desc, size_t len)
+{
+    memcpy(&desc_hid_report_runtime[*pos], desc, len);
+    *pos += len;
+}
+
+// Concatenate keyboard + mouse (8-bit or wide) + consumer into the runtime
+// buffer. The configuration descriptor reports exactly this length.
+static void build_runtime_hid_report(bool wide_mouse)
+{
+    size_t pos = 0;
 
-    // Copy mouse (provided) or default
-    if (mouse_desc != NULL && mouse_len > 0)
+    append_desc(&pos, desc_hid_keyboard, sizeof(desc_hid_keyboard));
+    if (wide_mouse)
     {
-        if (pos + mouse_len >= HID_DESC_BUF_SIZE)
-            return;
-        memcpy(&desc_hid_report_runtime[pos], mouse_desc, mouse_len);
-        pos += mouse_len;
+        append_desc(&pos, desc_hid_mouse_wide, sizeof(desc_hid_mouse_wide));
     }
     else
     {
-        size_t dlen = sizeof(desc_hid_mouse_default);
-        if (pos + dlen >= HID_DESC_BUF_SIZE)
-            return;
-        memcpy(&desc_hid_report_runtime[pos], desc_hid_mouse_default, dlen);
-        pos += dlen;
+        append_desc(&pos, desc_hid_mouse_default, sizeof(desc_hid_mouse_default));
     }
+    append_desc(&pos, desc_hid_consumer, sizeof(desc_hid_consumer));
 
-    // Copy consumer
-    size_t clen = sizeof(desc_hid_consumer);
-    if (pos + clen >= HID_DESC_BUF_SIZE)
+    desc_hid_runtime_len = (uint16_t)pos;
+    device_mouse_wide = wide_mouse;
+}
+
+// Device mouse format for a newly mounted mouse layout: true if it needs the
+// 16-bit report. Outside auto mode the format stays as configured.
+static bool layout_needs_wide_mouse(const hid_mouse_layout_t *layout, bool current)
+{
+#if USB_MOUSE_WIDE_REPORTS == USB_MOUSE_WIDE_AUTO
+    (void)current;
+    for (uint8_t i = 0; i < layout->count; i++)
+    {
+        const hid_mouse_plan_t *plan = &layout->plans[i];
+        if (plan->x.bit_size > 8 || plan->y.bit_size > 8 ||
+            plan->wheel.bit_size > 8 || plan->pan.bit_size > 8 ||
+            (plan->button_count > DEVICE_MOUSE_BUTTONS_8BIT && DEVICE_MOUSE_BUTTONS_WIDE > DEVICE_MOUSE_BUTTONS_8BIT))
+        {
+            return true;
+        }
+    }
+    return false;
+#else
+    (void)layout;
+    return current;
+#endif
+}
+
+// core1: post the wanted device state for core0
+static void post_device_change_request(uint16_t vid, uint16_t pid, bool wide_mouse)
+{
+    const uint32_t seq = device_change_request.seq;
+    device_change_request.seq = seq + 1;
+    __dmb(); // Mark the request busy before touching the fields
+    device_change_request.vid = vid;
+    device_change_request.pid = pid;
+    device_change_request.wide_mouse = wide_mouse;
+    __dmb(); // Publish the fields before the sequence number
+    device_change_request.seq = seq + 2;
+}
+
+// core0: apply the latest request from core1. A request that is being
+// rewritten is picked up on a later pass.
+static void apply_device_change_request(void)
+{
+    const uint32_t seq = device_change_request.seq;
+    if (seq == device_change_applied || (seq & 1u) != 0)
+    {
         return;
-    memcpy(&desc_hid_report_runtime[pos], desc_hid_consumer, clen);
-    pos += clen;
+    }
+    __dmb(); // Read the fields only after observing the sequence number
+    const uint16_t vid = device_change_request.vid;
+    const uint16_t pid = device_change_request.pid;
+    const bool wide = device_change_request.wide_mouse;
+    __dmb();
+    if (device_change_request.seq != seq)
+    {
+        return;
+    }
+    device_change_applied = seq;
 
-    // Pad remainder with END_COLLECTION (0xC0) which is a safe terminator
-    for (; pos < HID_DESC_BUF_SIZE; ++pos)
+    bool format_changed = false;
+    if (wide != device_mouse_wide)
     {
-        desc_hid_report_runtime[pos] = 0xC0;
+        build_runtime_hid_report(wide);
+        printf("Device mouse report switched to %s\n", wide ? "16-bit axes and buttons" : "8-bit axes");
+        format_changed = true;
     }
 
-    desc_hid_runtime_len = HID_DESC_BUF_SIZE;
-    desc_hid_runtime_valid = true;
+    // A new VID/PID re-enumerates, which also publishes the new format
+    if (vid != attached_vid || pid != attached_pid)
+    {
+        set_attached_device_vid_pid(vid, pid);
+    }
+    else if (format_changed)
+    {
+        force_usb_reenumeration();
+    }
 }
 
 bool usb_hid_init(void)
@@ -293,8 +586,10 @@ bool usb_hid_init(void)
     // Initialize connection state
     memset(&connection_state, 0, sizeof(connection_state));
 
-    // Build default runtime HID report descriptor (keyboard + default mouse + consumer)
-    build_runtime_hid_report_with_mouse(NULL, 0);
+    // Build the runtime HID report descriptor (keyboard + mouse + consumer);
+    // in auto mode the mouse switches to 16-bit axes once a mouse that
+    // needs them is attached
+    build_runtime_hid_report(USB_MOUSE_WIDE_REPORTS == USB_MOUSE_WIDE_ALWAYS);
 
     (void)0; // suppressed init log
     return true;
@@ -427,28 +722,19 @@ static void handle_hid_device_connection(uint8_t dev_addr, uint8_t itf_protocol)
     neopixel_update_status();
 }
 
-static bool process_keyboard_report_internal(const hid_keyboard_report_t *report)
+static bool process_keyboard_report_internal(const hid_keyboard_report_t *report, uint64_t now_us)
 {
     if (report == NULL)
     {
         return false;
     }
 
-    // Fast path: skip ready check for maximum performance
-    // TinyUSB will handle the queuing internally
-    bool success = tud_hid_report(REPORT_ID_KEYBOARD, report, sizeof(hid_keyboard_report_t));
-    if (success)
-    {
-        // Skip error counter reset for performance
-        return true;
-    }
-    else
-    {
-        return false;
-    }
+    // Queued for the arbiter; a report that cannot go out now is replaced by
+    // a newer one instead of being dropped
+    return usb_hid_queue_report(REPORT_ID_KEYBOARD, report, sizeof(hid_keyboard_report_t), now_us);
 }
 
-static bool process_mouse_report_internal(const hid_mouse_report_t *report)
+static bool process_mouse_report_internal(const hid_mouse_report_wide_t *report, uint64_t now_us)
 {
     if (report == NULL)
     {
@@ -458,61 +744,194 @@ static bool process_mouse_report_internal(const hid_mouse_report_t *report)
     // Check if USB device is ready to send reports
     if (!tud_mounted() || !tud_ready())
     {
-        printf("Mouse report dropped: USB device not ready (mounted=%d, ready=%d)\\n", 
-               tud_mounted(), tud_ready());
+        TRACE(TRACE_LEVEL_WARN, MOUSE_NOT_READY, tud_mounted(), tud_ready(), 0);
+        mouse_coalescer.dropped++;
         return false;
     }
 
-    // Fast button validation using bitwise AND
-    uint8_t valid_buttons = report->buttons & 0x1F; // Keep first 5 bits (L/R/M/S1/S2 buttons)
+    // Buttons beyond KMBOX_MAX_BUTTONS are not tracked
+    const kmbox_buttons_t valid_buttons = (kmbox_buttons_t)(report->buttons & KMBOX_BUTTONS_ALL);
 
-    // Update physical button states in kmbox (for lock functionality)
-    kmbox_update_physical_buttons(valid_buttons);
+    // A report is already waiting for the endpoint: this one is merged into it
+    if (mouse_coalescer.pending)
+    {
+        mouse_coalescer.merged++;
+    }
+    mouse_coalescer.pending = true;
+
+    // Update physical button states in kmbox (for lock functionality). A
+    // change that would undo an edge not sent yet is held back until that
+    // edge is out, so a click shorter than a frame still reaches the host.
+    const kmbox_buttons_t unsent_edges = mouse_coalescer.applied ^ mouse_coalescer.sent;
+    if (mouse_coalescer.deferred || ((valid_buttons ^ mouse_coalescer.applied) & unsent_edges))
+    {
+        // Replacing a deferred state loses the edges it held
+        if (mouse_coalescer.deferred &&
+            ((valid_buttons ^ mouse_coalescer.next) & (mouse_coalescer.next ^ mouse_coalescer.applied)))
+        {
+            mouse_coalescer.dropped++;
+        }
+        mouse_coalescer.next = valid_buttons;
+        mouse_coalescer.deferred = true;
+    }
+    else
+    {
+        mouse_coalescer.applied = valid_buttons;
+        kmbox_update_physical_buttons(valid_buttons);
+    }
 
     // Add physical mouse movement to kmbox accumulators (respecting axis locks)
     if (report->x != 0 || report->y != 0)
     {
         kmbox_add_mouse_movement(report->x, report->y);
-        printf("Mouse movement: x=%d, y=%d\\n", report->x, report->y);
+        TRACE(TRACE_LEVEL_DEBUG, MOUSE_MOVE, report->x, report->y, report->wheel);
     }
 
-    // Add physical wheel movement
+    // Add physical wheel and horizontal scroll movement
     if (report->wheel != 0)
     {
         kmbox_add_wheel_movement(report->wheel);
     }
+    if (report->pan != 0)
+    {
+        kmbox_add_pan_movement(report->pan);
+    }
+
+    // Send now if the endpoint is free; otherwise the movement stays in the
+    // kmbox accumulators and goes out from tud_hid_report_complete_cb()
+    return usb_hid_flush_mouse_report(now_us);
+}
+
+// True once the report should be submitted for the next frame. Without an
+// SOF in the current frame there is no frame timing to align to and reports
+// go out immediately: the last timestamp is stale when tud_task() has not
+// yet delivered the next SOF, or when the bus is suspended.
+static bool sof_send_window_open(uint64_t now_us, bool *synced)
+{
+    *synced = false;
+#if HID_SOF_SYNC_ENABLED
+    const uint64_t since_sof = now_us - sof_sync.sof_time_us;
+    if (sof_sync.sof_time_us != 0 && since_sof < USB_FRAME_US)
+    {
+        *synced = true;
+        return since_sof >= (uint64_t)(USB_FRAME_US - sof_sync.send_ahead_us);
+    }
+#else
+    (void)now_us;
+#endif
+    return true;
+}
 
-    // Now get the final movement and button values from kmbox which include
-    // both any previously queued command movement and the newly added
-    // physical movement.
-    uint8_t buttons_to_send;
-    int8_t x, y, wheel, pan;
-    kmbox_get_mouse_report(&buttons_to_send, &x, &y, &wheel, &pan);
+bool usb_hid_flush_mouse_report(uint64_t now_us)
+{
+    if (!tud_mounted())
+    {
+        sof_sync.pending_since_us = 0;
+        return false;
+    }
 
-    int8_t final_x = x;
-    int8_t final_y = y;
-    int8_t final_wheel = wheel;
+    if (sof_sync.pending_since_us == 0)
+    {
+        sof_sync.pending_since_us = now_us;
+    }
 
-    // Check if HID interface is ready
+    // The accumulators are only drained once the endpoint can take the
+    // report, so nothing is lost while it is busy
     if (!tud_hid_ready())
     {
-        printf("Mouse report dropped: HID interface not ready\\n");
         return false;
     }
 
-    // Fast path: skip ready check for maximum performance
-    bool success = tud_hid_mouse_report(REPORT_ID_MOUSE, buttons_to_send, final_x, final_y, final_wheel, pan);
-    if (success)
+    // Hold the report until just before the host's next poll so it carries
+    // everything that arrives in between
+    bool synced;
+    if (!sof_send_window_open(now_us, &synced))
     {
-        printf("Mouse report sent: buttons=0x%02x, x=%d, y=%d, wheel=%d\\n", 
-               buttons_to_send, final_x, final_y, final_wheel);
-        return true;
+        return false;
+    }
+
+    // Final movement and button values from kmbox: queued command movement
+    // plus all physical movement merged since the last report
+    kmbox_buttons_t buttons_to_send;
+    int16_t final_x, final_y, final_wheel, pan;
+    kmbox_get_mouse_report(&buttons_to_send, &final_x, &final_y, &final_wheel, &pan);
+
+    bool success = usb_hid_send_mouse_report(buttons_to_send, final_x, final_y, final_wheel, pan);
+    if (!success)
+    {
+        TRACE(TRACE_LEVEL_WARN, MOUSE_SEND_FAIL, buttons_to_send, final_x, final_y);
+        return false;
+    }
+
+    TRACE(TRACE_LEVEL_DEBUG, MOUSE_SENT, buttons_to_send, final_x, final_y);
+    kmbox_serial_report_sent(now_us);
+    mouse_coalescer.reports_sent++;
+
+    const uint32_t wait_us = (uint32_t)(now_us - sof_sync.pending_since_us);
+    sof_sync.pending_since_us = 0;
+    sof_sync.stats.total_wait_us += wait_us;
+    if (wait_us > sof_sync.stats.max_wait_us)
+    {
+        sof_sync.stats.max_wait_us = wait_us;
+    }
+    if (synced)
+    {
+        sof_sync.stats.synced_reports++;
     }
     else
     {
-        printf("Mouse report FAILED to send\\n");
+        sof_sync.stats.unsynced_reports++;
+    }
+
+    mouse_coalescer.pending = false;
+    mouse_coalescer.sent = mouse_coalescer.applied;
+
+    // The held-back button state goes out with the next report
+    if (mouse_coalescer.deferred)
+    {
+        mouse_coalescer.deferred = false;
+        mouse_coalescer.applied = mouse_coalescer.next;
+        kmbox_update_physical_buttons(mouse_coalescer.next);
+        mouse_coalescer.pending = true;
+    }
+    return true;
+}
+
+bool usb_hid_set_sof_send_ahead_us(uint16_t send_ahead_us)
+{
+    if (send_ahead_us > USB_FRAME_US)
+    {
         return false;
     }
+    sof_sync.send_ahead_us = send_ahead_us;
+    return true;
+}
+
+uint16_t usb_hid_get_sof_send_ahead_us(void)
+{
+    return sof_sync.send_ahead_us;
+}
+
+void usb_hid_get_sof_stats(hid_sof_stats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    *stats = sof_sync.stats;
+}
+
+void usb_hid_get_mouse_coalesce_stats(mouse_coalesce_stats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    stats->reports_sent = mouse_coalescer.reports_sent;
+    stats->merged = mouse_coalescer.merged;
+    stats->dropped = mouse_coalescer.dropped;
 }
 
 static void print_device_info(uint8_t dev_addr, const tusb_desc_device_t *desc)
@@ -527,7 +946,7 @@ static void print_device_info(uint8_t dev_addr, const tusb_desc_device_t *desc)
     (void)desc; // suppressed detailed device info logging
 }
 
-void process_kbd_report(const hid_keyboard_report_t *report)
+void process_kbd_report(const hid_keyboard_report_t *report, uint64_t now_us)
 {
     if (report == NULL)
     {
@@ -541,13 +960,13 @@ void process_kbd_report(const hid_keyboard_report_t *report)
     }
 
     // Fast forward the report
-    if (process_keyboard_report_internal(report))
+    if (process_keyboard_report_internal(report, now_us))
     {
         // Report processed successfully
     }
 }
 
-void process_mouse_report(const hid_mouse_report_t *report)
+void process_mouse_report(const hid_mouse_report_wide_t *report, uint64_t now_us)
 {
     if (report == NULL)
     {
@@ -561,7 +980,7 @@ void process_mouse_report(const hid_mouse_report_t *report)
     }
 
     // Fast forward the report
-    if (process_mouse_report_internal(report))
+    if (process_mouse_report_internal(report, now_us))
     {
         // Report processed successfully  
     }
@@ -573,6 +992,32 @@ void process_mouse_report(const hid_mouse_report_t *report)
     }
 }
 
+bool usb_hid_send_mouse_report(uint16_t buttons, int16_t x, int16_t y, int16_t wheel, int16_t pan)
+{
+    if (device_mouse_wide)
+    {
+        const hid_mouse_report_wide_t report = {
+            .buttons = buttons,
+            .x = x,
+            .y = y,
+            .wheel = wheel,
+            .pan = pan
+        };
+        return tud_hid_report(REPORT_ID_MOUSE, &report, sizeof(report));
+    }
+
+    return tud_hid_mouse_report(REPORT_ID_MOUSE, (uint8_t)buttons,
+                                (int8_t)clamp_axis(x, INT8_MIN, INT8_MAX),
+                                (int8_t)clamp_axis(y, INT8_MIN, INT8_MAX),
+                                (int8_t)clamp_axis(wheel, INT8_MIN, INT8_MAX),
+                                (int8_t)clamp_axis(pan, INT8_MIN, INT8_MAX));
+}
+
+bool usb_hid_mouse_is_wide(void)
+{
+    return device_mouse_wide;
+}
+
 bool find_key_in_report(const hid_keyboard_report_t *report, uint8_t keycode)
 {
     if (report == NULL)
@@ -591,17 +1036,26 @@ bool find_key_in_report(const hid_keyboard_report_t *report, uint8_t keycode)
     return false;
 }
 
-void hid_device_task(void)
+void hid_device_task(uint64_t now_us)
 {
-    // Optimized polling: 16ms for better performance (60 FPS equivalent)
-    static uint32_t start_ms = 0;
-    uint32_t current_ms = to_ms_since_boot(get_absolute_time());
+    // Reconnect once a re-enumeration has been off the bus long enough
+    reenumeration_task(now_us);
 
-    if (current_ms - start_ms < HID_DEVICE_TASK_INTERVAL_MS)
+    // Reports are only sent on change; give the endpoint to the most
+    // important dirty report whenever it is free
+    if (tud_mounted() && tud_ready())
+    {
+        report_arbiter_run(now_us);
+    }
+
+    // The button is sampled at a fixed interval
+    static uint64_t start_us = 0;
+
+    if (now_us - start_us < (uint64_t)HID_DEVICE_TASK_INTERVAL_MS * 1000u)
     {
         return; // Not enough time elapsed
     }
-    start_ms = current_ms;
+    start_us = now_us;
 
     // Remote wakeup handling
     if (tud_suspended() && !gpio_get(PIN_BUTTON))
@@ -611,114 +1065,218 @@ void hid_device_task(void)
         return;
     }
 
-    // Only send reports when USB device is properly mounted and ready
-    if (!tud_mounted() || !tud_ready())
+    // Button-based mouse movement while no devices are connected (avoid
+    // conflicts): movement up while the button is held (active low), queued
+    // like any other movement so nothing is sent while it is released
+    if (!connection_state.mouse_connected && !connection_state.keyboard_connected &&
+        tud_mounted() && !gpio_get(PIN_BUTTON))
     {
-        return; // Don't send reports if device is not properly mounted
+        kmbox_add_mouse_movement(MOUSE_NO_MOVEMENT, MOUSE_BUTTON_MOVEMENT_DELTA);
     }
+}
 
-    // Only send reports when devices are not connected (avoid conflicts)
-    if (!connection_state.mouse_connected && !connection_state.keyboard_connected)
-    {
-        send_hid_report(REPORT_ID_MOUSE);
-    }
-    else
+bool usb_hid_queue_report(uint8_t report_id, const void *data, uint8_t len, uint64_t now_us)
+{
+    for (size_t i = 0; i < ARBITER_SLOT_COUNT; i++)
     {
-        // Send empty consumer control report to maintain connection
-        send_hid_report(REPORT_ID_CONSUMER_CONTROL);
+        arbiter_slot_t *slot = &arbiter_slots[i];
+        if (slot->report_id != report_id)
+        {
+            continue;
+        }
+        if (data == NULL || len != slot->len)
+        {
+            return false;
+        }
+
+        if (slot->dirty)
+        {
+            arbiter_stats.replaced++;
+        }
+        memcpy(slot->data, data, len);
+
+        // Only a change from what the host last received needs sending
+        const bool changed = memcmp(slot->data, slot->sent_data, len) != 0;
+        if (changed && !slot->dirty)
+        {
+            slot->dirty_since_us = now_us;
+        }
+        slot->dirty = changed;
+
+        if (tud_mounted() && tud_ready())
+        {
+            report_arbiter_run(now_us);
+        }
+        return true;
     }
+    return false;
 }
 
-void send_hid_report(uint8_t report_id)
+static void report_arbiter_run(uint64_t now_us)
 {
-    // CRITICAL: Multiple checks to prevent endpoint allocation conflicts
-    if (!tud_mounted() || !tud_ready())
+    if (!tud_hid_ready())
     {
-        return; // Prevent endpoint conflicts by not sending reports when device isn't ready
+        return;
     }
 
-    // CRITICAL: Additional check to ensure device stack is stable
-    static uint32_t last_mount_check = 0;
-    uint32_t current_time = to_ms_since_boot(get_absolute_time());
-    if (current_time - last_mount_check > 1000)
-    { // Check every second
-        if (!tud_mounted())
-        {
-            return; // Device was unmounted, don't send reports
-        }
-        last_mount_check = current_time;
+    // The mouse goes first. Its report may still be held for the SOF send
+    // window; lower-priority reports then wait too, so the endpoint is free
+    // when the window opens, unless they have waited too long already.
+    const bool mouse_dirty = kmbox_has_pending_report();
+    if (mouse_dirty && usb_hid_flush_mouse_report(now_us))
+    {
+        return;
     }
 
-    switch (report_id)
+    for (size_t i = 0; i < ARBITER_SLOT_COUNT; i++)
     {
-    case REPORT_ID_KEYBOARD:
-        if (!connection_state.keyboard_connected)
+        arbiter_slot_t *slot = &arbiter_slots[i];
+        if (!slot->dirty)
         {
-            // CRITICAL: Check device readiness before each report
-            if (tud_hid_ready())
-            {
-                // Use static array to avoid stack allocation overhead
-                static const uint8_t empty_keycode[HID_KEYBOARD_KEYCODE_COUNT] = {0};
-                tud_hid_keyboard_report(REPORT_ID_KEYBOARD, 0, empty_keycode);
-            }
+            continue;
+        }
+        if (mouse_dirty && now_us - slot->dirty_since_us < HID_ARBITER_MAX_DEFER_US)
+        {
+            return;
         }
-        break;
 
-    case REPORT_ID_MOUSE:
-        // Only send button-based mouse movement if no mouse is connected
-        if (!connection_state.mouse_connected)
+        if (tud_hid_report(slot->report_id, slot->data, slot->len))
         {
-            // CRITICAL: Check device readiness before each report
-            if (tud_hid_ready())
+            memcpy(slot->sent_data, slot->data, slot->len);
+            slot->dirty = false;
+            if (slot->report_id == REPORT_ID_KEYBOARD)
             {
-                static bool prev_button_state = true; // true = not pressed (active low)
-                bool current_button_state = gpio_get(PIN_BUTTON);
-
-                if (!current_button_state)
-                { // button pressed (active low)
-                    // Mouse move up (negative Y direction)
-                    tud_hid_mouse_report(REPORT_ID_MOUSE, MOUSE_BUTTON_NONE,
-                                         MOUSE_NO_MOVEMENT, MOUSE_BUTTON_MOVEMENT_DELTA,
-                                         MOUSE_NO_MOVEMENT, MOUSE_NO_MOVEMENT);
-                }
-                else if (prev_button_state != current_button_state)
-                {
-                    // Send stop movement when button is released
-                    tud_hid_mouse_report(REPORT_ID_MOUSE, MOUSE_BUTTON_NONE,
-                                         MOUSE_NO_MOVEMENT, MOUSE_NO_MOVEMENT,
-                                         MOUSE_NO_MOVEMENT, MOUSE_NO_MOVEMENT);
-                }
-
-                prev_button_state = current_button_state;
+                arbiter_stats.keyboard_sent++;
+            }
+            else
+            {
+                arbiter_stats.consumer_sent++;
             }
         }
-        break;
+        else if (slot->report_id == REPORT_ID_KEYBOARD)
+        {
+            const hid_keyboard_report_t *kbd = (const hid_keyboard_report_t *)slot->data;
+            TRACE(TRACE_LEVEL_WARN, KBD_SEND_FAIL, kbd->modifier, kbd->keycode[0], 0);
+        }
+        return;
+    }
+}
 
-    case REPORT_ID_CONSUMER_CONTROL:
+void usb_hid_get_arbiter_stats(hid_arbiter_stats_t *stats)
+{
+    if (stats == NULL)
     {
-        // CRITICAL: Check device readiness before each report
-        if (tud_hid_ready())
+        return;
+    }
+
+    *stats = arbiter_stats;
+    stats->mouse_sent = mouse_coalescer.reports_sent;
+    stats->frames = sof_sync.stats.frames;
+}
+
+//--------------------------------------------------------------------+
+// CROSS-CORE HOST REPORT QUEUE
+//--------------------------------------------------------------------+
+
+// Producer side (core1). Returns false and counts the report as dropped if
+// core0 has fallen a whole queue behind.
+static bool host_report_queue_push(const host_report_entry_t *entry)
+{
+    uint32_t head = host_report_queue.head;
+    if (head - host_report_queue.tail >= HOST_REPORT_QUEUE_SIZE)
+    {
+        host_report_queue.dropped++;
+        TRACE(TRACE_LEVEL_WARN, HOST_QUEUE_DROP, entry->type, host_report_queue.dropped, 0);
+        return false;
+    }
+
+    host_report_queue.slots[head & HOST_REPORT_QUEUE_MASK] = *entry;
+    __dmb(); // Publish the slot before the index
+    host_report_queue.head = head + 1;
+    return true;
+}
+
+void hid_host_task(uint64_t now_us)
+{
+    // Apply the device identity and mouse format core1 asked for at mount,
+    // then drain kmbox movement in the range the device mouse report can
+    // carry
+    apply_device_change_request();
+    kmbox_set_wide_reports(device_mouse_wide);
+
+    // Consumer side (core0): merge every report core1 has queued. The USB host
+    // task itself runs on core1 in PIOKMbox.c.
+    uint32_t tail = host_report_queue.tail;
+    uint32_t head = host_report_queue.head;
+    __dmb(); // Read the slots only after observing the index
+
+    uint32_t depth = head - tail;
+    if (depth == 0)
+    {
+        return;
+    }
+    if (depth > host_report_queue.high_water)
+    {
+        host_report_queue.high_water = depth;
+    }
+
+    while (tail != head)
+    {
+        const host_report_entry_t *entry = &host_report_queue.slots[tail & HOST_REPORT_QUEUE_MASK];
+
+        // Entries pushed after the loop sampled now_us count as no wait
+        uint32_t latency_us = (entry->timestamp_us < now_us) ? (uint32_t)(now_us - entry->timestamp_us) : 0;
+        if (latency_us > host_report_queue.max_latency_us)
         {
-            static const uint16_t empty_key = 0;
-            tud_hid_report(REPORT_ID_CONSUMER_CONTROL, &empty_key, HID_CONSUMER_CONTROL_SIZE);
+            host_report_queue.max_latency_us = latency_us;
         }
-        break;
-    }
+        host_report_queue.total_latency_us += latency_us;
 
-    default:
-        break;
+        if (entry->type == HOST_REPORT_KEYBOARD)
+        {
+            process_kbd_report(&entry->keyboard, now_us);
+        }
+        else
+        {
+            process_mouse_report(&entry->mouse, now_us);
+        }
+
+        tail++;
+        __dmb(); // Finish with the slot before handing it back to core1
+        host_report_queue.tail = tail;
     }
 }
 
-void hid_host_task(void)
+void hid_host_get_queue_stats(host_report_queue_stats_t *stats)
 {
-    // This function can be called from core0 if needed for additional host processing
-    // The main host task runs on core1 in PIOKMbox.c
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    uint32_t head = host_report_queue.head;
+    uint32_t tail = host_report_queue.tail;
+    stats->dropped = host_report_queue.dropped;
+    stats->pushed = head;
+    stats->popped = tail;
+    stats->depth = head - tail;
+    stats->high_water = host_report_queue.high_water;
+    stats->max_latency_us = host_report_queue.max_latency_us;
+    stats->total_latency_us = host_report_queue.total_latency_us;
 }
 
 // Device callbacks with improved error handling
 void tud_mount_cb(void)
 {
+    // A newly configured host starts from empty reports
+    for (size_t i = 0; i < ARBITER_SLOT_COUNT; i++)
+    {
+        arbiter_slot_t *slot = &arbiter_slots[i];
+        memset(slot->sent_data, 0, sizeof(slot->sent_data));
+        slot->dirty = memcmp(slot->data, slot->sent_data, slot->len) != 0;
+        slot->dirty_since_us = time_us_64();
+    }
+
     led_set_blink_interval(LED_BLINK_MOUNTED_MS);
     neopixel_update_status();
 }
@@ -790,41 +1348,42 @@ void tuh_hid_mount_cb(uint8_t dev_addr, uint8_t instance, const uint8_t *desc_re
     
     // Fetch string descriptors from the attached device
     fetch_device_string_descriptors(dev_addr);
-    
-    set_attached_device_vid_pid(vid, pid);
 
-    // Capture host report descriptor for later mirroring
-    host_mouse_has_report_id = false;
-    host_mouse_report_id = 0;
-    if (desc_report != NULL && desc_len > 0)
+    // Compile the mouse report layout once; the report callback then
+    // extracts fields with the plan instead of guessing the format. The
+    // device mouse report follows the layout's resolution; core0 applies
+    // it together with the VID/PID so one re-enumeration publishes both.
+    bool wide_mouse = device_change_request.wide_mouse;
+    if (instance < CFG_TUH_HID)
     {
-        size_t copy_len = desc_len;
-        if (copy_len > sizeof(host_mouse_desc))
-            copy_len = sizeof(host_mouse_desc);
-        memcpy(host_mouse_desc, desc_report, copy_len);
-        host_mouse_desc_len = copy_len;
-
-        // Simple scan for Report ID (tag 0x85) in the descriptor to detect if report IDs are used
-        for (size_t i = 0; i + 1 < host_mouse_desc_len; ++i)
+        hid_mouse_layout_t *layout = &host_mouse_layouts[instance];
+        if (hid_parser_compile_mouse(desc_report, desc_len, layout))
         {
-            if (host_mouse_desc[i] == 0x85)
-            {
-                host_mouse_has_report_id = true;
-                host_mouse_report_id = host_mouse_desc[i + 1];
-                break;
-            }
+            const hid_mouse_plan_t *plan = &layout->plans[0];
+            printf("Mouse report %u: %u buttons, X %u-bit, Y %u-bit, wheel %u-bit, pan %u-bit\n",
+                   plan->report_id, plan->button_count, plan->x.bit_size, plan->y.bit_size,
+                   plan->wheel.bit_size, plan->pan.bit_size);
+            wide_mouse = layout_needs_wide_mouse(layout, wide_mouse);
         }
-
-    // Rebuild runtime HID report descriptor referencing the host mouse descriptor
-    build_runtime_hid_report_with_mouse(host_mouse_desc, host_mouse_desc_len);
-    }
-    else
-    {
-        host_mouse_desc_len = 0;
     }
+    post_device_change_request(vid, pid, wide_mouse);
 
     uint8_t const itf_protocol = tuh_hid_interface_protocol(dev_addr, instance);
 
+    // Boot mice are enumerated in boot protocol. One with a compiled layout
+    // is switched to report protocol; one without stays in (or is returned
+    // to) boot protocol, the only format it can be decoded in. Keyboards
+    // stay in boot protocol.
+    if (itf_protocol == HID_ITF_PROTOCOL_MOUSE && instance < CFG_TUH_HID)
+    {
+        const uint8_t protocol = (host_mouse_layouts[instance].count > 0) ? HID_PROTOCOL_REPORT : HID_PROTOCOL_BOOT;
+        if (tuh_hid_get_protocol(dev_addr, instance) != protocol &&
+            !tuh_hid_set_protocol(dev_addr, instance, protocol))
+        {
+            printf("HID %u:%u: SET_PROTOCOL failed\n", dev_addr, instance);
+        }
+    }
+
     // Indicate HID mount via LED and update internal state; avoid console prints
 
     // Handle HID device connection
@@ -846,7 +1405,10 @@ void tuh_hid_mount_cb(uint8_t dev_addr, uint8_t instance, const uint8_t *desc_re
 
 void tuh_hid_umount_cb(uint8_t dev_addr, uint8_t instance)
 {
-    (void)instance; // Suppress unused parameter warning
+    if (instance < CFG_TUH_HID)
+    {
+        memset(&host_mouse_layouts[instance], 0, sizeof(host_mouse_layouts[instance]));
+    }
 
     // Reset string descriptors when device is disconnected
     reset_device_string_descriptors();
@@ -859,6 +1421,60 @@ void tuh_hid_umount_cb(uint8_t dev_addr, uint8_t instance)
     neopixel_update_status();
 }
 
+// Decode a mouse report from the host stack. Report protocol reports are
+// decoded with the layout compiled at mount and dropped if there is none;
+// boot protocol reports use the fixed boot format. Interfaces without boot
+// support are always in report protocol. Only bytes below len are read;
+// returns false if the report is too short to carry buttons and both axes.
+static bool decode_host_mouse_report(uint8_t dev_addr, uint8_t instance, const uint8_t *report, uint16_t len,
+                                     hid_mouse_report_wide_t *out)
+{
+    if (report == NULL || instance >= CFG_TUH_HID)
+    {
+        return false;
+    }
+
+    memset(out, 0, sizeof(*out));
+
+    if (tuh_hid_interface_protocol(dev_addr, instance) == HID_ITF_PROTOCOL_NONE ||
+        tuh_hid_get_protocol(dev_addr, instance) == HID_PROTOCOL_REPORT)
+    {
+        if (host_mouse_layouts[instance].count == 0)
+        {
+            return false;
+        }
+        hid_mouse_values_t values;
+        if (!hid_parser_decode_mouse(&host_mouse_layouts[instance], report, len, &values))
+        {
+            return false;
+        }
+        out->buttons = values.buttons;
+        out->x = clamp_axis(values.x, INT16_MIN, INT16_MAX);
+        out->y = clamp_axis(values.y, INT16_MIN, INT16_MAX);
+        out->wheel = clamp_axis(values.wheel, INT16_MIN, INT16_MAX);
+        out->pan = clamp_axis(values.pan, INT16_MIN, INT16_MAX);
+        return true;
+    }
+
+    // Boot format: buttons, X, Y and optional wheel/pan bytes; shorter
+    // reports leave the missing bytes at zero
+    if (len < 3)
+    {
+        return false;
+    }
+    hid_mouse_report_t boot = {0};
+    size_t copy_sz = len;
+    if (copy_sz > sizeof(boot))
+        copy_sz = sizeof(boot);
+    memcpy(&boot, report, copy_sz);
+    out->buttons = boot.buttons;
+    out->x = boot.x;
+    out->y = boot.y;
+    out->wheel = boot.wheel;
+    out->pan = boot.pan;
+    return true;
+}
+
 void tuh_hid_report_received_cb(uint8_t dev_addr, uint8_t instance, const uint8_t *report, uint16_t len)
 {
     // Fast path: minimal validation for performance
@@ -870,7 +1486,8 @@ void tuh_hid_report_received_cb(uint8_t dev_addr, uint8_t instance, const uint8_
 
     uint8_t const itf_protocol = tuh_hid_interface_protocol(dev_addr, instance);
 
-    // Direct processing without extra copying for better performance
+    // Parse only: core0 owns the kmbox state and the device stack, so
+    // reports are queued for hid_host_task() instead of processed here
     switch (itf_protocol)
     {
     case HID_ITF_PROTOCOL_KEYBOARD:
@@ -879,68 +1496,47 @@ void tuh_hid_report_received_cb(uint8_t dev_addr, uint8_t instance, const uint8_
         // the USB buffer.
         if (len >= (int)sizeof(hid_keyboard_report_t))
         {
-            hid_keyboard_report_t kbd_report;
-            memcpy(&kbd_report, report, sizeof(kbd_report));
-            process_kbd_report(&kbd_report);
+            host_report_entry_t entry = {
+                .type = HOST_REPORT_KEYBOARD,
+                .timestamp_us = time_us_64()
+            };
+            memcpy(&entry.keyboard, report, sizeof(entry.keyboard));
+            host_report_queue_push(&entry);
         }
         break;
 
     case HID_ITF_PROTOCOL_MOUSE:
-        // Process mouse reports through kmbox system instead of raw forwarding
-        if (len > 0)
+    {
+        // Process mouse reports through kmbox system instead of raw forwarding.
+        // Reports too short to decode are dropped rather than zero-filled.
+        host_report_entry_t entry = {
+            .type = HOST_REPORT_MOUSE,
+            .timestamp_us = time_us_64()
+        };
+        if (decode_host_mouse_report(dev_addr, instance, report, len, &entry.mouse))
         {
-            // Handle different mouse report formats
-            hid_mouse_report_t mouse_report_local = {0};
-            
-            if (len == 8) {
-                // This is a 16-bit coordinate mouse (8-byte report)
-                // Format: [buttons] [pad] [pad] [pad] [x_low] [x_high] [y_low] [y_high]
-                mouse_report_local.buttons = report[0];
-                
-                // Extract 16-bit X and Y coordinates and convert to 8-bit with scaling
-                int16_t x16 = (int16_t)(report[4] | (report[5] << 8));
-                int16_t y16 = (int16_t)(report[6] | (report[7] << 8));
-                
-                // Scale down the 16-bit coordinates for smoother movement
-                // Right shift by 2 bits (divide by 4) to reduce sensitivity and prevent overflow
-                x16 >>= 2;
-                y16 >>= 2;
-                
-                // Clamp to 8-bit range 
-                if (x16 > 127) mouse_report_local.x = 127;
-                else if (x16 < -128) mouse_report_local.x = -128;
-                else mouse_report_local.x = (int8_t)x16;
-                
-                if (y16 > 127) mouse_report_local.y = 127;
-                else if (y16 < -128) mouse_report_local.y = -128;
-                else mouse_report_local.y = (int8_t)y16;
-                
-                // Try different positions for scroll wheel - check all possible bytes
-                // Most likely candidates are bytes 1, 2, or 3 (after buttons)
-                int8_t wheel_candidate = 0;
-                if (report[1] != 0) wheel_candidate = (int8_t)report[1];
-                else if (report[2] != 0) wheel_candidate = (int8_t)report[2];
-                else if (report[3] != 0) wheel_candidate = (int8_t)report[3];
-                
-                mouse_report_local.wheel = wheel_candidate;
-                mouse_report_local.pan = 0;
-                
-            } else {
-                // Standard 5-byte mouse report format
-                size_t copy_sz = len;
-                if (copy_sz > sizeof(mouse_report_local))
-                    copy_sz = sizeof(mouse_report_local);
-                memcpy(&mouse_report_local, report, copy_sz);
-            }
-
-            // Process through kmbox system (this handles movement accumulation,
-            // axis locks, and generates the final report to send)
-            process_mouse_report(&mouse_report_local);
+            // Hand over to core0, which runs it through the kmbox system
+            // (movement accumulation, axis locks, final report) in
+            // hid_host_task()
+            host_report_queue_push(&entry);
         }
         break;
+    }
 
     default:
-        // Unknown HID protocol - ignore
+        // Non-boot interfaces (e.g. a gaming mouse's secondary interface)
+        // are forwarded when their descriptor compiled to a mouse layout
+        if (instance < CFG_TUH_HID && host_mouse_layouts[instance].count > 0)
+        {
+            host_report_entry_t entry = {
+                .type = HOST_REPORT_MOUSE,
+                .timestamp_us = time_us_64()
+            };
+            if (decode_host_mouse_report(dev_addr, instance, report, len, &entry.mouse))
+            {
+                host_report_queue_push(&entry);
+            }
+        }
         break;
     }
 
@@ -988,6 +1584,17 @@ void tud_hid_report_complete_cb(uint8_t instance, const uint8_t *report, uint16_
     (void)instance;
     (void)len;
     (void)report;
+
+    // The endpoint is free again: send what was merged or queued while it
+    // was busy
+    report_arbiter_run(time_us_64());
+}
+
+void tud_sof_cb(uint32_t frame_count)
+{
+    (void)frame_count;
+    sof_sync.sof_time_us = time_us_64();
+    sof_sync.stats.frames++;
 }
 
 bool usb_device_stack_reset(void)
@@ -1158,12 +1765,7 @@ uint8_t const * tud_descriptor_device_cb(void)
 uint8_t const *tud_hid_descriptor_report_cb(uint8_t instance)
 {
     (void)instance;
-    if (desc_hid_runtime_valid)
-    {
-        return desc_hid_report_runtime;
-    }
-    // Fallback to static concatenation if runtime descriptor not ready
-    return desc_hid_report_runtime; // still points to buffer (may contain defaults)
+    return desc_hid_report_runtime;
 }
 
 // Configuration Descriptor
@@ -1173,18 +1775,26 @@ enum
     ITF_NUM_TOTAL
 };
 
-uint8_t const desc_configuration[] =
+// The report descriptor length (0 here) is patched with the runtime length
+// when the descriptor is requested
+static uint8_t desc_configuration[] =
     {
         // Config number, interface count, string index, total length, attribute, power in mA
         TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, USB_CONFIG_POWER_MA),
 
         // Interface number, string index, protocol, report descriptor len, EP In address, size & polling interval
-        TUD_HID_DESCRIPTOR(ITF_NUM_HID, 0, HID_ITF_PROTOCOL_NONE, sizeof(desc_hid_report), EPNUM_HID, CFG_TUD_HID_EP_BUFSIZE, HID_POLLING_INTERVAL_MS)};
+        TUD_HID_DESCRIPTOR(ITF_NUM_HID, 0, HID_ITF_PROTOCOL_NONE, 0, EPNUM_HID, CFG_TUD_HID_EP_BUFSIZE, HID_POLLING_INTERVAL_MS)};
+
+// wDescriptorLength of the report descriptor: after the configuration and
+// interface descriptors, at offset 7 of the HID descriptor
+#define DESC_HID_REPORT_LEN_OFFSET (TUD_CONFIG_DESC_LEN + 9 + 7)
 
 // Invoked when received GET CONFIGURATION DESCRIPTOR
 uint8_t const *tud_descriptor_configuration_cb(uint8_t index)
 {
     (void)index; // for multiple configurations
+    desc_configuration[DESC_HID_REPORT_LEN_OFFSET] = (uint8_t)(desc_hid_runtime_len & 0xFF);
+    desc_configuration[DESC_HID_REPORT_LEN_OFFSET + 1] = (uint8_t)(desc_hid_runtime_len >> 8);
     return desc_configuration;
 }
 
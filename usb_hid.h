@@ -25,20 +25,102 @@ enum {
   REPORT_ID_COUNT
 };
 
+// Mouse report with 16 button bits and 16-bit axes. Used on the wire for
+// the wide device mouse report (after REPORT_ID_MOUSE) and for host reports
+// decoded at the attached mouse's resolution.
+typedef struct TU_ATTR_PACKED {
+  uint16_t buttons;
+  int16_t x;
+  int16_t y;
+  int16_t wheel;
+  int16_t pan;
+} hid_mouse_report_wide_t;
+
 //--------------------------------------------------------------------+
 // FUNCTION PROTOTYPES
 //--------------------------------------------------------------------+
 
 // Device mode functions
-void hid_device_task(void);
-void send_hid_report(uint8_t report_id);
+void hid_device_task(uint64_t now_us);
+
+// Queue the latest keyboard or consumer control report. It is sent by the
+// report arbiter when it differs from what the host last received and the
+// endpoint is free; a newer report replaces one still waiting. Returns false
+// for an unknown report ID or wrong length.
+bool usb_hid_queue_report(uint8_t report_id, const void *data, uint8_t len, uint64_t now_us);
+
+// Endpoint utilization. Reports are only sent on change, so frames without
+// a report are idle.
+typedef struct {
+    uint32_t frames;            // SOFs seen
+    uint32_t mouse_sent;
+    uint32_t keyboard_sent;
+    uint32_t consumer_sent;
+    uint32_t replaced;          // Queued reports replaced by a newer one before sending
+} hid_arbiter_stats_t;
+
+void usb_hid_get_arbiter_stats(hid_arbiter_stats_t *stats);
+
+// Send a mouse report in the format the current device descriptor declares
+// (8-bit boot layout or 16-bit wide layout, see USB_MOUSE_WIDE_REPORTS).
+// Values beyond the 8-bit range are clamped and buttons above the eighth
+// dropped in the 8-bit format.
+bool usb_hid_send_mouse_report(uint16_t buttons, int16_t x, int16_t y, int16_t wheel, int16_t pan);
+
+// True while the device descriptor declares the wide mouse report
+bool usb_hid_mouse_is_wide(void);
+
+// Send one mouse report with everything merged since the last one (queued
+// commands and physical input) if the IN endpoint is free. Returns false,
+// leaving the movement queued, while it is busy. now_us is the caller's
+// time_us_64() sample.
+bool usb_hid_flush_mouse_report(uint64_t now_us);
+
+// Mouse report coalescing statistics
+typedef struct {
+    uint32_t reports_sent;      // Mouse reports submitted to the endpoint
+    uint32_t merged;            // Host reports merged into a later report
+    uint32_t dropped;           // Host reports whose button edges were lost
+} mouse_coalesce_stats_t;
+
+void usb_hid_get_mouse_coalesce_stats(mouse_coalesce_stats_t *stats);
+
+// Start-of-frame synchronization. Reports are held until send_ahead_us
+// before the next expected SOF (0..USB_FRAME_US, see HID_SOF_SEND_AHEAD_US).
+// Returns false for an out-of-range value.
+bool usb_hid_set_sof_send_ahead_us(uint16_t send_ahead_us);
+uint16_t usb_hid_get_sof_send_ahead_us(void);
+
+typedef struct {
+    uint32_t frames;            // SOFs seen
+    uint32_t synced_reports;    // Mouse reports submitted in the send window
+    uint32_t unsynced_reports;  // Sent immediately because no SOF was seen in the current frame
+    uint32_t total_wait_us;     // Sum of input-to-submit waits (average = total / reports)
+    uint32_t max_wait_us;       // Longest time merged input waited for submission
+} hid_sof_stats_t;
+
+void usb_hid_get_sof_stats(hid_sof_stats_t *stats);
 
 // Host mode functions
-void hid_host_task(void);
+// Drains the host report queue filled by core1; call from the core0 loop
+void hid_host_task(uint64_t now_us);
+
+// Cross-core host report queue statistics
+typedef struct {
+    uint32_t pushed;            // Reports queued by core1
+    uint32_t popped;            // Reports processed on core0
+    uint32_t dropped;           // Reports lost because the queue was full
+    uint32_t depth;             // Current queue depth
+    uint32_t high_water;        // Maximum queue depth seen
+    uint32_t max_latency_us;    // Longest time a report waited in the queue
+    uint32_t total_latency_us;  // Sum of queue waits (average = total / popped)
+} host_report_queue_stats_t;
+
+void hid_host_get_queue_stats(host_report_queue_stats_t *stats);
 
 // Report processing functions
-void process_kbd_report(hid_keyboard_report_t const *report);
-void process_mouse_report(hid_mouse_report_t const *report);
+void process_kbd_report(hid_keyboard_report_t const *report, uint64_t now_us);
+void process_mouse_report(hid_mouse_report_wide_t const *report, uint64_t now_us);
 
 // Utility functions
 bool find_key_in_report(hid_keyboard_report_t const *report, uint8_t keycode);
@@ -64,15 +146,9 @@ void usb_stack_error_check(void);
 // USB DESCRIPTORS
 //--------------------------------------------------------------------+
 
-// HID report descriptor for device mode
-extern uint8_t const desc_hid_report[];
-
 // Device descriptor
 extern tusb_desc_device_t const desc_device;
 
-// Configuration descriptor
-extern uint8_t const desc_configuration[];
-
 // String descriptors
 extern char const* string_desc_arr[];
 
@@ -90,6 +166,7 @@ void tud_resume_cb(void);
 uint16_t tud_hid_get_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t* buffer, uint16_t reqlen);
 void tud_hid_set_report_cb(uint8_t instance, uint8_t report_id, hid_report_type_t report_type, uint8_t const* buffer, uint16_t bufsize);
 void tud_hid_report_complete_cb(uint8_t instance, uint8_t const* report, uint16_t len);
+void tud_sof_cb(uint32_t frame_count);
 
 // HID host callbacks
 extern uint16_t attached_vid;
@@ -107,9 +184,13 @@ void set_attached_device_vid_pid(uint16_t vid, uint16_t pid);
 // Function to get dynamic serial string
 const char* get_dynamic_serial_string(void);
 
-// Function to force USB re-enumeration
+// Disconnect and re-enumerate with the current descriptors. Returns at once;
+// hid_device_task() reconnects after USB_REENUM_DISCONNECT_MS.
 void force_usb_reenumeration(void);
 
+// True while a re-enumeration is waiting to reconnect
+bool usb_hid_reenumeration_pending(void);
+
 // TinyUSB Host callbacks
 void tuh_hid_mount_cb(uint8_t dev_addr, uint8_t instance, uint8_t const* desc_report, uint16_t desc_len);
 void tuh_hid_umount_cb(uint8_t dev_addr, uint8_t instance);
@@ -5,6 +5,7 @@
 
 #include "watchdog.h"
 #include "defines.h"
+#include "debug_stdio.h"
 #include "pico/stdlib.h"
 #include "hardware/watchdog.h"
 #include "hardware/gpio.h"
@@ -320,6 +321,9 @@ void watchdog_force_reset(void) {
            g_watchdog_status.core0_heartbeat_count, g_watchdog_status.core1_heartbeat_count);
     printf("Watchdog: Timeout warnings: %lu\n", g_watchdog_status.timeout_warnings);
     
+    // Debug output is queued for DMA; get it onto the wire before the reset
+    debug_stdio_flush();
+    
     // Force immediate reset by causing hardware watchdog timeout
     if (WATCHDOG_ENABLE_HARDWARE) {
         // Stop updating the hardware watchdog and wait for reset